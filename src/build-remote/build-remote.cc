@@ -20,6 +20,7 @@
 #include "nix/util/strings.hh"
 #include "nix/store/derivations.hh"
 #include "nix/store/local-store.hh"
+#include "nix/store/legacy-ssh-store.hh"
 #include "nix/cmd/legacy.hh"
 #include "nix/util/experimental-features.hh"
 
@@ -233,6 +234,11 @@ static int main_build_remote(int argc, char * * argv)
 
                 lock = -1;
 
+                printMsg(lvlChatty,
+                    "dispatching to '%s' (slots used %d/%d, speed factor %.1f, system '%s')",
+                    bestMachine->storeUri.render(), bestLoad, bestMachine->maxJobs,
+                    bestMachine->speedFactor, neededSystem);
+
                 try {
                     storeUri = bestMachine->storeUri.render();
 
@@ -240,6 +246,12 @@ static int main_build_remote(int argc, char * * argv)
 
                     sshStore = bestMachine->openStore();
                     sshStore->connect();
+
+                    /* Log the builder's own load, for tuning
+                       placement (see the QueryLoad serve command). */
+                    if (auto legacySSHStore = sshStore.dynamic_pointer_cast<LegacySSHStore>())
+                        if (auto load = legacySSHStore->queryLoad())
+                            printMsg(lvlChatty, "builder '%s' reports load average %.2f", storeUri, *load);
                 } catch (std::exception & e) {
                     auto msg = chomp(drainFD(5, false));
                     printError("cannot build on '%s': %s%s",
@@ -278,22 +290,37 @@ connected:
             }
         }
 
-        {
-            Activity act(*logger, lvlTalkative, actUnknown, fmt("waiting for the upload lock to '%s'", storeUri));
-
-            auto old = signal(SIGALRM, handleAlarm);
-            alarm(15 * 60);
-            if (!lockFile(uploadLock.get(), ltWrite, true))
-                printError("somebody is hogging the upload lock for '%s', continuing...");
-            alarm(0);
-            signal(SIGALRM, old);
+        auto substitute = settings.buildersUseSubstitutes ? Substitute : NoSubstitute;
+
+        /* Ask the builder (in one batched query) which of the inputs
+           it is missing, so that builds whose closure is already
+           present skip the upload lock entirely instead of queuing
+           behind another build's transfer. */
+        auto inputPaths = store->parseStorePathSet(inputs);
+        auto missingInputs = inputPaths;
+        try {
+            for (auto & path : sshStore->queryValidPaths(inputPaths))
+                missingInputs.erase(path);
+        } catch (Error &) {
+            /* Conservatively copy everything. */
         }
 
-        auto substitute = settings.buildersUseSubstitutes ? Substitute : NoSubstitute;
+        if (!missingInputs.empty()) {
+            {
+                Activity act(*logger, lvlTalkative, actUnknown, fmt("waiting for the upload lock to '%s'", storeUri));
+
+                auto old = signal(SIGALRM, handleAlarm);
+                alarm(15 * 60);
+                if (!lockFile(uploadLock.get(), ltWrite, true))
+                    printError("somebody is hogging the upload lock for '%s', continuing...");
+                alarm(0);
+                signal(SIGALRM, old);
+            }
 
-        {
             Activity act(*logger, lvlTalkative, actUnknown, fmt("copying dependencies to '%s'", storeUri));
-            copyPaths(*store, *sshStore, store->parseStorePathSet(inputs), NoRepair, NoCheckSigs, substitute);
+            /* Note: the set may have shrunk further while we waited
+               for the lock; copyPaths re-checks. */
+            copyPaths(*store, *sshStore, missingInputs, NoRepair, NoCheckSigs, substitute);
         }
 
         uploadLock = -1;
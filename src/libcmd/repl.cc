@@ -87,6 +87,15 @@ struct NixRepl
     void initEnv() override;
 
     virtual StringSet completePrefix(const std::string & prefix) override;
+
+    /**
+     * Attribute names per completed expression, memoised because
+     * readline invokes the completer several times per keystroke
+     * and the first evaluation of e.g. `pkgs` can take seconds.
+     * Invalidated whenever a line is processed, since any input can
+     * change the scope.
+     */
+    std::map<std::string, StringSet> completionCache;
     StorePath getDerivationPath(Value & v);
     ProcessLineResult processLine(std::string line);
 
@@ -112,6 +121,9 @@ struct NixRepl
             .force = true,
             .derivationPaths = true,
             .maxDepth = maxDepth,
+            /* Keep the repl responsive even when a huge value is
+               printed by accident. */
+            .maxBytes = 1024 * 1024,
             .prettyIndent = 2,
             .errors = ErrorPrintBehavior::ThrowTopLevel,
         });
@@ -276,13 +288,20 @@ StringSet NixRepl::completePrefix(const std::string & prefix)
             auto expr = cur.substr(0, dot);
             auto cur2 = cur.substr(dot + 1);
 
-            Expr * e = parseString(expr);
-            Value v;
-            e->eval(*state, *env, v);
-            state->forceAttrs(v, noPos, "while evaluating an attrset for the purpose of completion (this error should not be displayed; file an issue?)");
+            auto cached = completionCache.find(expr);
+            if (cached == completionCache.end()) {
+                Expr * e = parseString(expr);
+                Value v;
+                e->eval(*state, *env, v);
+                state->forceAttrs(v, noPos, "while evaluating an attrset for the purpose of completion (this error should not be displayed; file an issue?)");
+
+                StringSet names;
+                for (auto & i : *v.attrs())
+                    names.insert(std::string(state->symbols[i.name]));
+                cached = completionCache.emplace(expr, std::move(names)).first;
+            }
 
-            for (auto & i : *v.attrs()) {
-                std::string_view name = state->symbols[i.name];
+            for (auto & name : cached->second) {
                 if (name.substr(0, cur2.size()) != cur2) continue;
                 completions.insert(concatStrings(prev, expr, ".", name));
             }
@@ -346,6 +365,9 @@ void NixRepl::loadDebugTraceEnv(DebugTrace & dt)
 
 ProcessLineResult NixRepl::processLine(std::string line)
 {
+    /* Any input can change the scope or the values behind it. */
+    completionCache.clear();
+
     line = trim(line);
     if (line.empty())
         return ProcessLineResult::PromptAgain;
@@ -0,0 +1,112 @@
+/**
+ * @file
+ *
+ * Microbenchmarks for the hot paths of the evaluator. Run with
+ * `--benchmark_format=json` to produce output suitable for CI
+ * regression gating.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "nix/expr/eval.hh"
+#include "nix/expr/eval-inline.hh"
+#include "nix/expr/eval-gc.hh"
+#include "nix/expr/eval-settings.hh"
+#include "nix/fetchers/fetch-settings.hh"
+#include "nix/store/store-open.hh"
+#include "nix/store/globals.hh"
+
+using namespace nix;
+
+/* Shared evaluator state. Benchmarks are single-threaded, so one
+   state is fine, and constructing it per iteration would swamp the
+   numbers. */
+static EvalState & evalState()
+{
+    static bool readOnlyMode = true;
+    static fetchers::Settings fetchSettings;
+    static EvalSettings evalSettings{readOnlyMode};
+    static auto state = []() -> std::unique_ptr<EvalState> {
+        initLibStore(false);
+        initGC();
+        evalSettings.nixPath = {};
+        auto store = openStore({
+            .variant = StoreReference::Specified{.scheme = "dummy"},
+            .params = {},
+        });
+        return std::make_unique<EvalState>(LookupPath(), store, fetchSettings, evalSettings, nullptr);
+    }();
+    return *state;
+}
+
+static Expr * parse(EvalState & state, const std::string & input)
+{
+    return state.parseExprFromString(input, state.rootPath(CanonPath::root));
+}
+
+/* Evaluate an expression string once per iteration (including thunk
+   forcing, excluding parsing). */
+static void evalExpr(benchmark::State & bmState, const std::string & input)
+{
+    auto & state = evalState();
+    auto e = parse(state, input);
+    for (auto _ : bmState) {
+        Value v;
+        state.eval(e, v);
+        state.forceValue(v, noPos);
+        benchmark::DoNotOptimize(v);
+    }
+}
+
+static void bm_parse(benchmark::State & bmState)
+{
+    auto & state = evalState();
+    /* A representative mix of constructs. */
+    std::string corpus = "let f = { a ? 1, b ? 2, ... }@args: a + b; in f { a = 3; c = [ 1 2 3 ./p \"s${toString 4}\" ]; }";
+    for (auto _ : bmState)
+        benchmark::DoNotOptimize(parse(state, corpus));
+    bmState.SetBytesProcessed(bmState.iterations() * corpus.size());
+}
+BENCHMARK(bm_parse);
+
+static void bm_forceValueThunks(benchmark::State & bmState)
+{
+    /* A list of thunks forced by elem lookup. */
+    evalExpr(bmState, "builtins.length (map (x: x + 1) (builtins.genList (x: x) 1000))");
+}
+BENCHMARK(bm_forceValueThunks);
+
+static void bm_bindingsLookup(benchmark::State & bmState)
+{
+    evalExpr(bmState,
+        "let s = builtins.listToAttrs (map (x: { name = \"a${toString x}\"; value = x; }) (builtins.genList (x: x) 200)); "
+        "in builtins.foldl' (acc: x: acc + s.\"a${toString x}\") 0 (builtins.genList (x: x) 200)");
+}
+BENCHMARK(bm_bindingsLookup);
+
+static void bm_stringConcat(benchmark::State & bmState)
+{
+    evalExpr(bmState, "builtins.stringLength (builtins.concatStringsSep \"\" (builtins.genList (x: \"chunk${toString x}\") 500))");
+}
+BENCHMARK(bm_stringConcat);
+
+static void bm_fix(benchmark::State & bmState)
+{
+    /* lib.fix-style fixpoint with self-references. */
+    evalExpr(bmState,
+        "let fix = f: let x = f x; in x; "
+        "in (fix (self: { a = 1; b = self.a + 1; c = self.b + 1; d = self.c + 1; })).d");
+}
+BENCHMARK(bm_fix);
+
+static void bm_attrsetMerge(benchmark::State & bmState)
+{
+    /* Deep // chains over largely-overlapping sets, as in the module
+       system. */
+    evalExpr(bmState,
+        "let base = builtins.listToAttrs (map (x: { name = \"a${toString x}\"; value = x; }) (builtins.genList (x: x) 100)); "
+        "in builtins.attrNames (builtins.foldl' (acc: x: acc // base // { \"x${toString x}\" = x; }) {} (builtins.genList (x: x) 50))");
+}
+BENCHMARK(bm_attrsetMerge);
+
+BENCHMARK_MAIN();
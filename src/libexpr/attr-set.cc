@@ -19,7 +19,28 @@ Bindings * EvalState::allocBindings(size_t capacity)
         throw Error("attribute set of size %d is too big", capacity);
     nrAttrsets++;
     nrAttrsInAttrsets += capacity;
-    return new (allocBytes(sizeof(Bindings) + sizeof(Attr) * capacity)) Bindings((Bindings::size_t) capacity);
+
+#if NIX_USE_BOEHMGC
+    /* Batch the allocation of the two dominant attribute set sizes,
+       as allocValue does for values (see there for an explanation of
+       the free list returned by GC_malloc_many). */
+    if (!arena && capacity <= 2) {
+        auto & cache = capacity == 1 ? bindings1AllocCache : bindings2AllocCache;
+        if (!*cache) {
+            *cache = GC_malloc_many(sizeof(Bindings) + sizeof(Attr) * capacity);
+            if (!*cache) throw std::bad_alloc();
+        }
+        void * p = *cache;
+        *cache = GC_NEXT(p);
+        GC_NEXT(p) = nullptr;
+        return new (p) Bindings((Bindings::size_t) capacity);
+    }
+#endif
+
+    auto p = arena
+        ? arena->alloc(sizeof(Bindings) + sizeof(Attr) * capacity)
+        : allocBytes(sizeof(Bindings) + sizeof(Attr) * capacity);
+    return new (p) Bindings((Bindings::size_t) capacity);
 }
 
 
@@ -39,7 +60,28 @@ Value & BindingsBuilder::alloc(std::string_view name, PosIdx pos)
 
 void Bindings::sort()
 {
-    if (size_) std::sort(begin(), end());
+    if (size_ < 2) return;
+
+    /* Attribute sets are very often built in sorted order (the
+       parser keeps attributes in sorted maps), so check first. */
+    if (std::is_sorted(begin(), end())) return;
+
+    /* Most remaining sets are tiny; a straight insertion sort beats
+       std::sort's dispatch for them. */
+    if (size_ <= 8) {
+        for (size_t i = 1; i < size_; ++i) {
+            Attr key = attrs[i];
+            size_t j = i;
+            while (j > 0 && key < attrs[j - 1]) {
+                attrs[j] = attrs[j - 1];
+                --j;
+            }
+            attrs[j] = key;
+        }
+        return;
+    }
+
+    std::sort(begin(), end());
 }
 
 
@@ -1,6 +1,10 @@
 #include "nix/util/users.hh"
 #include "nix/expr/eval-cache.hh"
 #include "nix/store/sqlite.hh"
+#include "nix/store/filetransfer.hh"
+#include "nix/util/file-system.hh"
+
+#include <filesystem>
 #include "nix/expr/eval.hh"
 #include "nix/expr/eval-inline.hh"
 #include "nix/store/store-api.hh"
@@ -53,6 +57,16 @@ struct AttrDb
         SQLiteStmt queryAttribute;
         SQLiteStmt queryAttributes;
         std::unique_ptr<SQLiteTxn> txn;
+
+        /**
+         * Negative lookup cache: keys known to be absent from the
+         * database, so repeated probes of nonexistent attributes
+         * (completion, sparse `nix flake show`) skip the statement
+         * round trip. Invalidated wholesale when anything is
+         * written (see `writeCount`).
+         */
+        std::set<AttrKey> absent;
+        uint64_t absentGeneration = 0;
     };
 
     std::unique_ptr<Sync<State>> _state;
@@ -62,7 +76,8 @@ struct AttrDb
     AttrDb(
         const StoreDirConfig & cfg,
         const Hash & fingerprint,
-        SymbolTable & symbols)
+        SymbolTable & symbols,
+        const std::string & upstream)
         : cfg(cfg)
         , _state(std::make_unique<Sync<State>>())
         , symbols(symbols)
@@ -74,6 +89,23 @@ struct AttrDb
 
         Path dbPath = cacheDir + "/" + fingerprint.to_string(HashFormat::Base16, false) + ".sqlite";
 
+        /* Cold cache: try to seed it from the shared upstream, so a
+           fingerprint evaluated anywhere in the fleet is warm here.
+           Failures just mean evaluating locally, as before. */
+        if (upstream != "" && !pathExists(dbPath)) {
+            try {
+                FileTransferRequest request(
+                    upstream + "/" + fingerprint.to_string(HashFormat::Base16, false) + ".sqlite");
+                auto res = getFileTransfer()->download(request);
+                auto tmpPath = dbPath + ".tmp." + std::to_string(getpid());
+                writeFile(tmpPath, res.data);
+                std::filesystem::rename(tmpPath, dbPath);
+                debug("seeded eval cache for '%s' from '%s'", fingerprint.to_string(HashFormat::Base16, false), upstream);
+            } catch (FileTransferError & e) {
+                debug("upstream eval cache unavailable: %s", e.what());
+            }
+        }
+
         state->db = SQLite(dbPath);
         state->db.isCache();
         state->db.exec(schema);
@@ -105,10 +137,16 @@ struct AttrDb
         }
     }
 
+    /**
+     * Bumped on every write, to invalidate `State::absent`.
+     */
+    std::atomic<uint64_t> writeCount{0};
+
     template<typename F>
     AttrId doSQLite(F && fun)
     {
         if (failed) return 0;
+        writeCount++;
         try {
             return fun();
         } catch (SQLiteError &) {
@@ -301,8 +339,17 @@ struct AttrDb
     {
         auto state(_state->lock());
 
+        if (state->absentGeneration != writeCount) {
+            state->absent.clear();
+            state->absentGeneration = writeCount;
+        }
+        if (state->absent.count(key)) return {};
+
         auto queryAttribute(state->queryAttribute.use()(key.first)(symbols[key.second]));
-        if (!queryAttribute.next()) return {};
+        if (!queryAttribute.next()) {
+            state->absent.insert(key);
+            return {};
+        }
 
         auto rowId = (AttrId) queryAttribute.getInt(0);
         auto type = (AttrType) queryAttribute.getInt(1);
@@ -346,10 +393,11 @@ struct AttrDb
 static std::shared_ptr<AttrDb> makeAttrDb(
     const StoreDirConfig & cfg,
     const Hash & fingerprint,
-    SymbolTable & symbols)
+    SymbolTable & symbols,
+    const std::string & upstream)
 {
     try {
-        return std::make_shared<AttrDb>(cfg, fingerprint, symbols);
+        return std::make_shared<AttrDb>(cfg, fingerprint, symbols, upstream);
     } catch (SQLiteError &) {
         ignoreExceptionExceptInterrupt();
         return nullptr;
@@ -360,7 +408,7 @@ EvalCache::EvalCache(
     std::optional<std::reference_wrapper<const Hash>> useCache,
     EvalState & state,
     RootLoader rootLoader)
-    : db(useCache ? makeAttrDb(*state.store, *useCache, state.symbols) : nullptr)
+    : db(useCache ? makeAttrDb(*state.store, *useCache, state.symbols, state.settings.evalCacheUpstream) : nullptr)
     , state(state)
     , rootLoader(rootLoader)
 {
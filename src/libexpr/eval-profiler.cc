@@ -1,4 +1,11 @@
 #include "nix/expr/eval-profiler.hh"
+#include "nix/expr/eval.hh"
+#include "nix/util/util.hh"
+
+#include <algorithm>
+#include <fstream>
+
+#include <nlohmann/json.hpp>
 #include "nix/expr/nixexpr.hh"
 
 namespace nix {
@@ -45,4 +52,158 @@ void MultiEvalProfiler::addProfiler(ref<EvalProfiler> profiler)
     invalidateNeededHooks();
 }
 
+
+uint32_t SpeedscopeProfiler::getFrameIdx(const EvalState & state, const Value & v)
+{
+    const void * key;
+    if (v.isLambda())
+        key = v.payload.lambda.fun;
+    else if (v.isPrimOp())
+        key = v.primOp();
+    else
+        key = nullptr;
+
+    if (auto i = frameIdx.find(key); i != frameIdx.end())
+        return i->second;
+
+    Frame frame;
+    if (v.isLambda()) {
+        auto fun = v.payload.lambda.fun;
+        frame.name = fun->name ? std::string(state.symbols[fun->name]) : "λ";
+        frame.pos = fun->getPos();
+    } else if (v.isPrimOp())
+        frame.name = std::string(v.primOp()->name);
+    else
+        frame.name = "«applied»";
+
+    auto idx = (uint32_t) frames.size();
+    frames.push_back(std::move(frame));
+    frameIdx.emplace(key, idx);
+    return idx;
+}
+
+void SpeedscopeProfiler::preFunctionCallHook(
+    const EvalState & state, const Value & v, std::span<Value *> args, const PosIdx pos)
+{
+    this->state = &state;
+    auto frame = getFrameIdx(state, v);
+    events.push_back({frame, true, now()});
+    stack.push_back(frame);
+}
+
+void SpeedscopeProfiler::postFunctionCallHook(
+    const EvalState & state, const Value & v, std::span<Value *> args, const PosIdx pos)
+{
+    if (stack.empty()) return;
+    events.push_back({stack.back(), false, now()});
+    stack.pop_back();
+}
+
+SpeedscopeProfiler::~SpeedscopeProfiler()
+{
+    try {
+        if (!state) return;
+
+        /* Close any frames still open at shutdown so the event stream
+           stays balanced, as the format requires. */
+        auto end = now();
+        while (!stack.empty()) {
+            events.push_back({stack.back(), false, end});
+            stack.pop_back();
+        }
+
+        auto framesJson = nlohmann::json::array();
+        for (auto & frame : frames) {
+            nlohmann::json f{{"name", frame.name}};
+            if (frame.pos) {
+                auto pos = state->positions[frame.pos];
+                if (auto path = std::get_if<SourcePath>(&pos.origin))
+                    f["file"] = path->to_string();
+                f["line"] = pos.line;
+                f["col"] = pos.column;
+            }
+            framesJson.push_back(std::move(f));
+        }
+
+        auto eventsJson = nlohmann::json::array();
+        for (auto & ev : events)
+            eventsJson.push_back({
+                {"type", ev.open ? "O" : "C"},
+                {"frame", ev.frame},
+                {"at", ev.us},
+            });
+
+        nlohmann::json json{
+            {"$schema", "https://www.speedscope.app/file-format-schema.json"},
+            {"shared", {{"frames", std::move(framesJson)}}},
+            {"profiles", nlohmann::json::array({{
+                {"type", "evented"},
+                {"name", "nix eval"},
+                {"unit", "microseconds"},
+                {"startValue", 0},
+                {"endValue", end},
+                {"events", std::move(eventsJson)},
+            }})},
+            {"exporter", "nix"},
+        };
+
+        std::ofstream fs(outPath);
+        fs << json.dump() << "\n";
+    } catch (...) {
+        ignoreExceptionInDestructor();
+    }
+}
+
+
+void MemoryProfiler::charge()
+{
+    auto counters = state->getAllocationCounters();
+    auto & c = perSite[stack.empty() ? noPos : stack.back()];
+    c.values += counters.values - last.values;
+    c.envs += counters.envs - last.envs;
+    c.attrsets += counters.attrsets - last.attrsets;
+    last = { counters.values, counters.envs, counters.attrsets };
+}
+
+void MemoryProfiler::preFunctionCallHook(
+    const EvalState & state, const Value & v, std::span<Value *> args, const PosIdx pos)
+{
+    this->state = &state;
+    charge();
+    stack.push_back(pos);
+}
+
+void MemoryProfiler::postFunctionCallHook(
+    const EvalState & state, const Value & v, std::span<Value *> args, const PosIdx pos)
+{
+    charge();
+    if (!stack.empty()) stack.pop_back();
+}
+
+MemoryProfiler::~MemoryProfiler()
+{
+    try {
+        if (!state) return;
+
+        /* Sort the call sites by number of values allocated. */
+        std::vector<std::pair<PosIdx, Counts>> sites(perSite.begin(), perSite.end());
+        std::sort(sites.begin(), sites.end(),
+            [](const auto & a, const auto & b) { return a.second.values > b.second.values; });
+
+        auto json = nlohmann::json::array();
+        for (auto & [pos, counts] : sites)
+            json.push_back({
+                {"pos", pos ? fmt("%s", state->positions[pos]) : "(top level)"},
+                {"values", counts.values},
+                {"envs", counts.envs},
+                {"attrsets", counts.attrsets},
+            });
+
+        std::ofstream fs(outPath);
+        fs << json.dump(2) << "\n";
+    } catch (...) {
+        ignoreExceptionInDestructor();
+    }
+}
+
 }
@@ -5,12 +5,15 @@
 #include "nix/util/exit.hh"
 #include "nix/util/types.hh"
 #include "nix/util/util.hh"
+#include "nix/util/sync.hh"
 #include "nix/store/store-api.hh"
 #include "nix/store/derivations.hh"
 #include "nix/store/downstream-placeholder.hh"
 #include "nix/expr/eval-inline.hh"
 #include "nix/store/filetransfer.hh"
 #include "nix/expr/function-trace.hh"
+#include "nix/expr/parallel-eval.hh"
+#include "nix/expr/file-eval-cache.hh"
 #include "nix/store/profiles.hh"
 #include "nix/expr/print.hh"
 #include "nix/fetchers/filtering-source-accessor.hh"
@@ -55,6 +58,45 @@ static char * allocString(size_t size)
 }
 
 
+/* Strings up to this size are deduplicated through an interning
+   table: a nixpkgs evaluation produces millions of copies of short
+   strings like "x86_64-linux" or "out". */
+static constexpr size_t maxInternedStringSize = 64;
+
+/* Bound on the interning table, so that evaluations producing huge
+   numbers of distinct short strings don't pin them all in memory
+   (interned strings are never collected). */
+static constexpr size_t maxInternedStrings = 1 << 18;
+
+static const char * internString(std::string_view s)
+{
+    /* The table nodes are allocated from traceable (uncollectable
+       but scanned) memory, so the interned strings they point to
+       stay alive for the lifetime of the process. */
+    static Sync<std::unordered_map<
+        std::string_view,
+        const char *,
+        std::hash<std::string_view>,
+        std::equal_to<std::string_view>,
+        traceable_allocator<std::pair<const std::string_view, const char *>>>> interned_;
+
+    auto interned(interned_.lock());
+
+    if (auto i = interned->find(s); i != interned->end())
+        return i->second;
+
+    auto t = allocString(s.size() + 1);
+    memcpy(t, s.data(), s.size());
+    t[s.size()] = '\0';
+
+    if (interned->size() < maxInternedStrings)
+        /* Key the entry on the copy, which lives as long as the
+           table does. */
+        interned->emplace(std::string_view(t, s.size()), t);
+
+    return t;
+}
+
 // When there's no need to write to the string, we can optimize away empty
 // string allocations.
 // This function handles makeImmutableString(std::string_view()) by returning
@@ -64,6 +106,8 @@ static const char * makeImmutableString(std::string_view s)
     const size_t size = s.size();
     if (size == 0)
         return "";
+    if (size <= maxInternedStringSize)
+        return internString(s);
     auto t = allocString(size + 1);
     memcpy(t, s.data(), size);
     t[size] = '\0';
@@ -315,10 +359,13 @@ EvalState::EvalState(
     , debugRepl(nullptr)
     , debugStop(false)
     , trylevel(0)
+    , executor(make_ref<Executor>(settings))
     , regexCache(makeRegexCache())
 #if NIX_USE_BOEHMGC
     , valueAllocCache(std::allocate_shared<void *>(traceable_allocator<void *>(), nullptr))
     , env1AllocCache(std::allocate_shared<void *>(traceable_allocator<void *>(), nullptr))
+    , bindings1AllocCache(std::allocate_shared<void *>(traceable_allocator<void *>(), nullptr))
+    , bindings2AllocCache(std::allocate_shared<void *>(traceable_allocator<void *>(), nullptr))
     , baseEnvP(std::allocate_shared<Env *>(traceable_allocator<Env *>(), &allocEnv(BASE_ENV_SIZE)))
     , baseEnv(**baseEnvP)
 #else
@@ -331,6 +378,18 @@ EvalState::EvalState(
 
     countCalls = getEnv("NIX_COUNT_CALLS").value_or("0") != "0";
 
+    if (settings.useFileEvalCache)
+        fileEvalCacheDb = makePersistentFileEvalCache();
+
+    if (settings.useArenaAllocator) {
+        arena = std::make_unique<EvalArena>();
+#if NIX_USE_BOEHMGC
+        /* Values allocated from the arena are invisible to the
+           collector, so collections must not run at all. */
+        GC_disable();
+#endif
+    }
+
     assertGCInitialized();
 
     static_assert(sizeof(Env) <= 16, "environment must be <= 16 bytes");
@@ -339,6 +398,9 @@ EvalState::EvalState(
     vNull.mkNull();
     vTrue.mkBool(true);
     vFalse.mkBool(false);
+    for (size_t n = 0; n < sizeof(vSmallInts) / sizeof(*vSmallInts); ++n)
+        vSmallInts[n].mkInt(NixInt::Inner(n));
+
     vStringRegular.mkString("regular");
     vStringDirectory.mkString("directory");
     vStringSymlink.mkString("symlink");
@@ -376,6 +438,14 @@ EvalState::EvalState(
     /* Register function call tracer. */
     if (settings.traceFunctionCalls)
         profiler.addProfiler(make_ref<FunctionCallTrace>());
+
+    /* Register the allocation profiler. */
+    if (settings.evalMemoryProfile != "")
+        profiler.addProfiler(make_ref<MemoryProfiler>(settings.evalMemoryProfile));
+
+    /* Register the speedscope profiler. */
+    if (settings.evalProfile != "")
+        profiler.addProfiler(make_ref<SpeedscopeProfiler>(settings.evalProfile));
 }
 
 
@@ -507,6 +577,9 @@ void PrimOp::check()
     if (arity > maxPrimOpArity) {
         throw Error("primop arity must not exceed %1%", maxPrimOpArity);
     }
+
+    if (auto target = fun.target<PrimOpFun *>())
+        rawFun = *target;
 }
 
 
@@ -916,6 +989,21 @@ void Value::mkPath(const SourcePath & path)
 }
 
 
+/* The number of garbage collections so far. Expr nodes are not
+   scanned by the collector, so their inline caches cannot keep a
+   `Bindings` alive; a cached pointer is trustworthy only if no
+   collection has run since it was stored (otherwise the address may
+   have been reused by a different set). Without the GC nothing is
+   ever freed and the epoch is constant. */
+static inline size_t gcEpoch()
+{
+#if NIX_USE_BOEHMGC
+    return static_cast<size_t>(GC_get_gc_no());
+#else
+    return 0;
+#endif
+}
+
 inline Value * EvalState::lookupVar(Env * env, const ExprVar & var, bool noEval)
 {
     for (auto l = var.level; l; --l, env = env->up) ;
@@ -930,8 +1018,23 @@ inline Value * EvalState::lookupVar(Env * env, const ExprVar & var, bool noEval)
     auto * fromWith = var.fromWith;
     while (1) {
         forceAttrs(*env->values[0], fromWith->pos, "while evaluating the first subexpression of a with expression");
-        if (auto j = env->values[0]->attrs()->get(var.name)) {
+        auto * attrs = env->values[0]->attrs();
+        /* Sampled after the force: evaluating the with-body can
+           trigger a collection, and a cached pointer must not
+           survive one (see gcEpoch()). */
+        auto epoch = gcEpoch();
+        /* `with pkgs; ...` resolves thousands of variables in the
+           same (immutable) attribute set; remember the last hit to
+           skip the binary search. */
+        if (attrs == var.cachedFromBindings && var.cachedFromEpoch == epoch) {
+            if (countCalls) attrSelects[var.cachedFromAttr->pos]++;
+            return var.cachedFromAttr->value;
+        }
+        if (auto j = attrs->get(var.name)) {
             if (countCalls) attrSelects[j->pos]++;
+            var.cachedFromBindings = attrs;
+            var.cachedFromAttr = j;
+            var.cachedFromEpoch = epoch;
             return j->value;
         }
         if (!fromWith->parentWith)
@@ -1104,6 +1207,8 @@ Value * ExprPath::maybeThunk(EvalState & state, Env & env)
 
 void EvalState::evalFile(const SourcePath & path, Value & v, bool mustBeTrivial)
 {
+    nrExternalFileReads++;
+
     FileEvalCache::iterator i;
     if ((i = fileEvalCache.find(path)) != fileEvalCache.end()) {
         v = i->second;
@@ -1116,7 +1221,40 @@ void EvalState::evalFile(const SourcePath & path, Value & v, bool mustBeTrivial)
         return;
     }
 
+    /* Check the on-disk evaluation cache, keyed on the file contents
+       and the settings that can influence the result of evaluation.
+       Only pure evaluation makes content-addressed caching sound: in
+       impure mode even a literal result can depend on getEnv,
+       currentTime or NIX_PATH, none of which are in the key. */
+    std::optional<Hash> cacheKey;
+    if (fileEvalCacheDb && !mustBeTrivial && settings.pureEval) {
+        /* Note: mustBeTrivial enforces a *syntactic* restriction, so
+           it has to see the parsed expression. */
+        try {
+            cacheKey = hashString(HashAlgorithm::SHA256,
+                fmt("%s;%d;%d;%s",
+                    hashString(HashAlgorithm::SHA256, resolvedPath.readFile()).to_string(HashFormat::Base16, false),
+                    settings.pureEval.get(),
+                    settings.restrictEval.get(),
+                    settings.getCurrentSystem()));
+        } catch (Error &) {
+            /* Unreadable files are diagnosed by the parser below. */
+        }
+        if (cacheKey && fileEvalCacheDb->lookup(*cacheKey, *this, v)) {
+            fileEvalCache.emplace(resolvedPath, v);
+            if (path != resolvedPath) fileEvalCache.emplace(path, v);
+            return;
+        }
+    }
+
     printTalkative("evaluating file '%1%'", resolvedPath);
+
+    /* If evaluating this file reads any other file (an import, a
+       readFile, ...), the result depends on contents the cache key
+       doesn't cover, and caching it would go stale when those files
+       change. Detect that and refuse to cache. */
+    auto externalReadsBefore = nrExternalFileReads;
+
     Expr * e = nullptr;
 
     auto j = fileParseCache.find(resolvedPath);
@@ -1149,11 +1287,52 @@ void EvalState::evalFile(const SourcePath & path, Value & v, bool mustBeTrivial)
         throw;
     }
 
+    if (cacheKey && nrExternalFileReads == externalReadsBefore)
+        fileEvalCacheDb->insert(*cacheKey, *this, v);
+
     fileEvalCache.emplace(resolvedPath, v);
     if (path != resolvedPath) fileEvalCache.emplace(path, v);
 }
 
 
+void EvalState::flushPendingDerivations()
+{
+    if (pendingDrvWrites.empty()) return;
+
+    debug("writing %d deferred derivations", pendingDrvWrites.size());
+
+    /* A .drv references its input derivations, and registering a
+       path requires its references to be valid already - so inputs
+       must be written before their referrers. The map is in store
+       path (i.e. hash) order, which guarantees nothing, so walk the
+       inputDrvs edges depth-first. */
+    std::function<void(const StorePath &)> write = [&](const StorePath & path) {
+        auto i = pendingDrvWrites.find(path);
+        if (i == pendingDrvWrites.end()) return;
+        auto drv = std::move(i->second);
+        /* Erase before recursing, so a path is written at most
+           once. */
+        pendingDrvWrites.erase(i);
+        for (auto & [inputDrv, _] : drv.inputDrvs.map)
+            write(inputDrv);
+        auto written = writeDerivation(*store, drv, repair);
+        assert(written == path);
+    };
+
+    while (!pendingDrvWrites.empty())
+        write(pendingDrvWrites.begin()->first);
+}
+
+
+std::vector<SourcePath> EvalState::getParsedFiles() const
+{
+    std::vector<SourcePath> res;
+    for (auto & [path, _] : fileParseCache)
+        res.push_back(path);
+    return res;
+}
+
+
 void EvalState::resetFileCache()
 {
     fileEvalCache.clear();
@@ -1416,6 +1595,29 @@ static std::string showAttrPath(EvalState & state, Env & env, const AttrPath & a
 }
 
 
+/* Look up `name` in the attribute set `vAttrs`, going through this
+   site's single-entry inline cache when `cacheable` (the first,
+   statically-named path component). Attribute sets are immutable
+   once built and the name is fixed per site, so a pointer match
+   within one GC epoch means the cached slot is still the answer. */
+const Attr * ExprSelect::lookupWithCache(const Value & vAttrs, Symbol name, bool cacheable) const
+{
+    auto attrs = vAttrs.attrs();
+    if (cacheable) {
+        auto epoch = gcEpoch();
+        if (attrs == cachedBindings && cachedEpoch == epoch)
+            return cachedAttr;
+        auto j = attrs->get(name);
+        if (j) {
+            cachedBindings = attrs;
+            cachedAttr = j;
+            cachedEpoch = epoch;
+        }
+        return j;
+    }
+    return attrs->get(name);
+}
+
 void ExprSelect::eval(EvalState & state, Env & env, Value & v)
 {
     Value vTmp;
@@ -1435,6 +1637,7 @@ void ExprSelect::eval(EvalState & state, Env & env, Value & v)
                 showAttrPath(state, env, attrPath))
             : nullptr;
 
+        bool firstComponent = true;
         for (auto & i : attrPath) {
             state.nrLookups++;
             const Attr * j;
@@ -1442,14 +1645,14 @@ void ExprSelect::eval(EvalState & state, Env & env, Value & v)
             if (def) {
                 state.forceValue(*vAttrs, pos);
                 if (vAttrs->type() != nAttrs ||
-                    !(j = vAttrs->attrs()->get(name)))
+                    !(j = lookupWithCache(*vAttrs, name, firstComponent && (bool) i.symbol)))
                 {
                     def->eval(state, env, v);
                     return;
                 }
             } else {
                 state.forceAttrs(*vAttrs, pos, "while selecting an attribute");
-                if (!(j = vAttrs->attrs()->get(name))) {
+                if (!(j = lookupWithCache(*vAttrs, name, firstComponent && (bool) i.symbol))) {
                     StringSet allAttrNames;
                     for (auto & attr : *vAttrs->attrs())
                         allAttrNames.insert(std::string(state.symbols[attr.name]));
@@ -1461,6 +1664,7 @@ void ExprSelect::eval(EvalState & state, Env & env, Value & v)
             vAttrs = j->value;
             pos2 = j->pos;
             if (state.countCalls) state.attrSelects[pos2]++;
+            firstComponent = false;
         }
 
         state.forceValue(*vAttrs, (pos2 ? pos2 : this->pos ) );
@@ -1584,10 +1788,17 @@ void EvalState::callFunction(Value & fun, std::span<Value *> args, Value & vRes,
 
                 /* For each formal argument, get the actual argument.  If
                    there is no matching actual argument but the formal
-                   argument has a default, use the default. */
+                   argument has a default, use the default. Both the
+                   formals and the bindings are sorted by symbol, so
+                   walk them in lockstep rather than doing a binary
+                   search per formal; functions with large argument
+                   sets are called millions of times in a big eval. */
                 size_t attrsUsed = 0;
+                auto attrIt = args[0]->attrs()->begin();
+                auto attrsEnd = args[0]->attrs()->end();
                 for (auto & i : lambda.formals->formals) {
-                    auto j = args[0]->attrs()->get(i.name);
+                    while (attrIt != attrsEnd && attrIt->name < i.name) ++attrIt;
+                    auto j = attrIt != attrsEnd && attrIt->name == i.name ? &*attrIt : nullptr;
                     if (!j) {
                         if (!i.def) {
                             error<TypeError>("function '%1%' called without required argument '%2%'",
@@ -1677,7 +1888,10 @@ void EvalState::callFunction(Value & fun, std::span<Value *> args, Value & vRes,
                 if (countCalls) primOpCalls[fn->name]++;
 
                 try {
-                    fn->fun(*this, vCur.determinePos(noPos), args.data(), vCur);
+                    if (fn->rawFun) [[likely]]
+                        fn->rawFun(*this, vCur.determinePos(noPos), args.data(), vCur);
+                    else
+                        fn->fun(*this, vCur.determinePos(noPos), args.data(), vCur);
                 } catch (Error & e) {
                     if (fn->addTrace)
                         addErrorTrace(e, pos, "while calling the '%1%' builtin", fn->name);
@@ -1725,7 +1939,10 @@ void EvalState::callFunction(Value & fun, std::span<Value *> args, Value & vRes,
                     // 1. Unify this and above code. Heavily redundant.
                     // 2. Create a fake env (arg1, arg2, etc.) and a fake expr (arg1: arg2: etc: builtins.name arg1 arg2 etc)
                     //    so the debugger allows to inspect the wrong parameters passed to the builtin.
-                    fn->fun(*this, vCur.determinePos(noPos), vArgs, vCur);
+                    if (fn->rawFun) [[likely]]
+                        fn->rawFun(*this, vCur.determinePos(noPos), vArgs, vCur);
+                    else
+                        fn->fun(*this, vCur.determinePos(noPos), vArgs, vCur);
                 } catch (Error & e) {
                     if (fn->addTrace)
                         addErrorTrace(e, pos, "while calling the '%1%' builtin", fn->name);
@@ -1943,7 +2160,24 @@ void ExprOpUpdate::eval(EvalState & state, Env & env, Value & v)
     if (v1.attrs()->size() == 0) { v = v2; return; }
     if (v2.attrs()->size() == 0) { v = v1; return; }
 
-    auto attrs = state.buildBindings(v1.attrs()->size() + v2.attrs()->size());
+    /* Count the attributes occurring in both sets, so that the
+       result can be allocated at its exact size. Module-system
+       evaluation performs millions of largely-overlapping merges,
+       and allocating size1 + size2 for each wastes nearly half of
+       the merge intermediates. The counting pass is a cache-hot
+       linear scan, much cheaper than the over-allocation. */
+    size_t dups = 0;
+    {
+        auto i = v1.attrs()->begin();
+        auto j = v2.attrs()->begin();
+        while (i != v1.attrs()->end() && j != v2.attrs()->end()) {
+            if (i->name == j->name) { dups++; ++i; ++j; }
+            else if (i->name < j->name) ++i;
+            else ++j;
+        }
+    }
+
+    auto attrs = state.buildBindings(v1.attrs()->size() + v2.attrs()->size() - dups);
 
     /* Merge the sets, preferring values from the second set.  Make
        sure to keep the resulting vector in sorted order. */
@@ -0,0 +1,205 @@
+#include "nix/expr/file-eval-cache.hh"
+#include "nix/expr/eval.hh"
+#include "nix/expr/eval-inline.hh"
+#include "nix/store/sqlite.hh"
+#include "nix/util/sync.hh"
+#include "nix/util/util.hh"
+#include "nix/util/users.hh"
+#include "nix/util/file-system.hh"
+
+#include <nlohmann/json.hpp>
+
+namespace nix {
+
+static const char * schema = R"sql(
+create table if not exists FileValues (
+    key         text primary key not null,
+    value       text not null
+);
+)sql";
+
+struct PersistentFileEvalCache::Impl
+{
+    std::atomic_bool failed{false};
+
+    struct State
+    {
+        SQLite db;
+        SQLiteStmt insertValue;
+        SQLiteStmt queryValue;
+    };
+
+    Sync<State> _state;
+
+    Impl()
+    {
+        auto state(_state.lock());
+
+        Path cacheDir = getCacheDir() + "/file-eval-cache-v1";
+        createDirs(cacheDir);
+
+        state->db = SQLite(cacheDir + "/values.sqlite");
+        state->db.isCache();
+        state->db.exec(schema);
+
+        state->insertValue.create(state->db,
+            "insert or replace into FileValues(key, value) values (?, ?)");
+
+        state->queryValue.create(state->db,
+            "select value from FileValues where key = ?");
+    }
+};
+
+/* Encode a value in literal normal form as JSON, with a type tag to
+   distinguish e.g. paths from strings. Returns std::nullopt if the
+   value (or one of its elements) is not in literal normal form. */
+static std::optional<nlohmann::json> encodeValue(EvalState & state, Value & v)
+{
+    using json = nlohmann::json;
+
+    /* Note: deliberately no forcing here. Caching must not evaluate
+       anything the caller didn't evaluate. */
+    switch (v.isThunk() || v.isApp() ? nThunk : v.type()) {
+    case nNull:
+        return json{{"t", "null"}};
+    case nBool:
+        return json{{"t", "bool"}, {"v", v.boolean()}};
+    case nInt:
+        return json{{"t", "int"}, {"v", v.integer().value}};
+    case nFloat:
+        return json{{"t", "float"}, {"v", v.fpoint()}};
+    case nString: {
+        if (v.context()) return std::nullopt;
+        return json{{"t", "string"}, {"v", v.string_view()}};
+    }
+    case nPath: {
+        auto path = v.path();
+        /* Only paths in the root filesystem are stable across
+           processes; accessors of in-memory or fetched trees are
+           not. */
+        if (path.accessor != state.rootFS) return std::nullopt;
+        return json{{"t", "path"}, {"v", path.path.abs()}};
+    }
+    case nList: {
+        auto elems = json::array();
+        for (auto elem : v.listItems()) {
+            auto j = encodeValue(state, *elem);
+            if (!j) return std::nullopt;
+            elems.push_back(std::move(*j));
+        }
+        return json{{"t", "list"}, {"v", std::move(elems)}};
+    }
+    case nAttrs: {
+        auto attrs = json::object();
+        for (auto & attr : *v.attrs()) {
+            auto j = encodeValue(state, *attr.value);
+            if (!j) return std::nullopt;
+            attrs.emplace(state.symbols[attr.name], std::move(*j));
+        }
+        return json{{"t", "attrs"}, {"v", std::move(attrs)}};
+    }
+    default:
+        return std::nullopt;
+    }
+}
+
+static void decodeValue(EvalState & state, const nlohmann::json & j, Value & v)
+{
+    auto & t = j.at("t").get_ref<const std::string &>();
+
+    if (t == "null")
+        v.mkNull();
+    else if (t == "bool")
+        v.mkBool(j.at("v").get<bool>());
+    else if (t == "int")
+        v.mkInt(j.at("v").get<NixInt::Inner>());
+    else if (t == "float")
+        v.mkFloat(j.at("v").get<NixFloat>());
+    else if (t == "string")
+        v.mkString(j.at("v").get_ref<const std::string &>());
+    else if (t == "path")
+        v.mkPath(SourcePath(state.rootFS, CanonPath(j.at("v").get_ref<const std::string &>())));
+    else if (t == "list") {
+        auto & elems = j.at("v");
+        auto list = state.buildList(elems.size());
+        for (const auto & [n, elem] : enumerate(elems)) {
+            auto v2 = state.allocValue();
+            decodeValue(state, elem, *v2);
+            list[n] = v2;
+        }
+        v.mkList(list);
+    }
+    else if (t == "attrs") {
+        auto & attrs = j.at("v");
+        auto bindings = state.buildBindings(attrs.size());
+        for (auto & [name, elem] : attrs.items())
+            decodeValue(state, elem, bindings.alloc(name));
+        v.mkAttrs(bindings);
+    }
+    else
+        throw Error("unknown type tag '%s' in file evaluation cache", t);
+}
+
+PersistentFileEvalCache::PersistentFileEvalCache()
+    : impl(std::make_unique<Impl>())
+{
+}
+
+PersistentFileEvalCache::~PersistentFileEvalCache() { }
+
+bool PersistentFileEvalCache::lookup(const Hash & key, EvalState & state, Value & v)
+{
+    if (impl->failed) return false;
+
+    std::string encoded;
+
+    try {
+        auto state_(impl->_state.lock());
+        auto queryValue(state_->queryValue.use()(key.to_string(HashFormat::Base16, false)));
+        if (!queryValue.next()) return false;
+        encoded = queryValue.getStr(0);
+    } catch (SQLiteError &) {
+        ignoreExceptionExceptInterrupt();
+        impl->failed = true;
+        return false;
+    }
+
+    try {
+        decodeValue(state, nlohmann::json::parse(encoded), v);
+        return true;
+    } catch (std::exception &) {
+        /* A corrupt or stale entry; treat it as a miss. */
+        ignoreExceptionExceptInterrupt();
+        return false;
+    }
+}
+
+void PersistentFileEvalCache::insert(const Hash & key, EvalState & state, Value & v)
+{
+    if (impl->failed) return;
+
+    auto encoded = encodeValue(state, v);
+    if (!encoded) return;
+
+    try {
+        auto state_(impl->_state.lock());
+        state_->insertValue.use()
+            (key.to_string(HashFormat::Base16, false))
+            (encoded->dump()).exec();
+    } catch (SQLiteError &) {
+        ignoreExceptionExceptInterrupt();
+        impl->failed = true;
+    }
+}
+
+std::shared_ptr<PersistentFileEvalCache> makePersistentFileEvalCache()
+{
+    try {
+        return std::make_shared<PersistentFileEvalCache>();
+    } catch (SQLiteError &) {
+        ignoreExceptionExceptInterrupt();
+        return nullptr;
+    }
+}
+
+}
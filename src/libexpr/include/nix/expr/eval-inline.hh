@@ -31,6 +31,11 @@ inline void * allocBytes(size_t n)
 [[gnu::always_inline]]
 Value * EvalState::allocValue()
 {
+    if (arena) [[unlikely]] {
+        nrValues++;
+        return (Value *) arena->alloc(sizeof(Value));
+    }
+
 #if NIX_USE_BOEHMGC
     /* We use the boehm batch allocator to speed up allocations of Values (of which there are many).
        GC_malloc_many returns a linked list of objects of the given size, where the first word
@@ -63,6 +68,9 @@ Env & EvalState::allocEnv(size_t size)
 
     Env * env;
 
+    if (arena) [[unlikely]]
+        return *(Env *) arena->alloc(sizeof(Env) + size * sizeof(Value *));
+
 #if NIX_USE_BOEHMGC
     if (size == 1) {
         /* see allocValue for explanations. */
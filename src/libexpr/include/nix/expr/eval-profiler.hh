@@ -5,8 +5,13 @@
  * Evaluation profiler interface definitions and builtin implementations.
  */
 
+#include "nix/util/pos-idx.hh"
 #include "nix/util/ref.hh"
 
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <span>
 #include <bitset>
@@ -89,6 +94,129 @@ public:
     }
 };
 
+/**
+ * Profiler that attributes evaluator allocations (values,
+ * environments, attribute sets) to the call sites of the functions
+ * within which they were made, and writes a JSON report on
+ * destruction. Enabled by the `eval-memory-profile` setting.
+ */
+class MemoryProfiler : public EvalProfiler
+{
+    std::string outPath;
+
+    const EvalState * state = nullptr;
+
+    /** Call sites of the currently active calls. */
+    std::vector<PosIdx> stack;
+
+    struct Counts
+    {
+        uint64_t values = 0, envs = 0, attrsets = 0;
+    };
+
+    /** Allocation counters at the previous hook. */
+    Counts last;
+
+    /** Exclusive allocation counts per call site. */
+    std::unordered_map<PosIdx, Counts> perSite;
+
+    /** Attribute allocations since the last hook to the innermost
+        active call. */
+    void charge();
+
+    Hooks getNeededHooksImpl() const override
+    {
+        Hooks hooks;
+        hooks.set(preFunctionCall).set(postFunctionCall);
+        return hooks;
+    }
+
+public:
+
+    MemoryProfiler(std::string outPath)
+        : outPath(std::move(outPath))
+    {
+    }
+
+    ~MemoryProfiler();
+
+    void
+    preFunctionCallHook(const EvalState & state, const Value & v, std::span<Value *> args, const PosIdx pos) override;
+
+    void
+    postFunctionCallHook(const EvalState & state, const Value & v, std::span<Value *> args, const PosIdx pos) override;
+};
+
+/**
+ * Profiler that records every function call with wall-clock enter and
+ * exit times and writes a profile in the speedscope JSON format
+ * (https://www.speedscope.app/) on destruction. Enabled by the
+ * `eval-profile` setting and by `nix eval --profile`.
+ */
+class SpeedscopeProfiler : public EvalProfiler
+{
+    std::string outPath;
+
+    const EvalState * state = nullptr;
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    struct Frame
+    {
+        /** Name of the called function, if it has one. */
+        std::string name;
+        /** Position of the function's definition (lambdas only). */
+        PosIdx pos;
+    };
+
+    /** Frame table, indexed by the event frame numbers. Frames are
+        keyed on the function's identity (the `ExprLambda` or `PrimOp`
+        pointer), so the name and position are computed once per
+        function rather than once per call. */
+    std::vector<Frame> frames;
+    std::unordered_map<const void *, uint32_t> frameIdx;
+
+    struct Event
+    {
+        uint32_t frame;
+        bool open;
+        uint64_t us;
+    };
+
+    std::vector<Event> events;
+
+    /** Frames entered but not yet exited. */
+    std::vector<uint32_t> stack;
+
+    uint32_t getFrameIdx(const EvalState & state, const Value & v);
+
+    uint64_t now() const
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    Hooks getNeededHooksImpl() const override
+    {
+        return Hooks().set(preFunctionCall).set(postFunctionCall);
+    }
+
+public:
+
+    SpeedscopeProfiler(std::string outPath)
+        : outPath(std::move(outPath))
+    {
+    }
+
+    ~SpeedscopeProfiler();
+
+    void
+    preFunctionCallHook(const EvalState & state, const Value & v, std::span<Value *> args, const PosIdx pos) override;
+
+    void
+    postFunctionCallHook(const EvalState & state, const Value & v, std::span<Value *> args, const PosIdx pos) override;
+};
+
 /**
  * Profiler that invokes multiple profilers at once.
  */
@@ -175,6 +175,25 @@ struct EvalSettings : Config
           - or the prefix is a URI scheme ended by a colon `:` and the URI has the same scheme.
         )"};
 
+    Setting<std::string> evalMemoryProfile{this, "", "eval-memory-profile",
+        R"(
+          If set to a file name, write a report attributing evaluator
+          allocations (values, environments, attribute sets) to the
+          call sites of the functions within which they were made,
+          when evaluation ends. Unlike `NIX_SHOW_STATS`, which only
+          reports totals, this shows *where* the memory went.
+        )"};
+
+    Setting<std::string> evalProfile{this, "", "eval-profile",
+        R"(
+          If set to a file name, record every function call with
+          wall-clock enter/exit times and write the result there, in the
+          [speedscope](https://www.speedscope.app/) JSON format, when
+          evaluation ends. Frames are labelled with the function's name
+          (where it has one) and definition position. Also settable via
+          `nix eval --profile`.
+        )"};
+
     Setting<bool> traceFunctionCalls{this, false, "trace-function-calls",
         R"(
           If set to `true`, the Nix evaluator will trace every function call.
@@ -193,6 +212,18 @@ struct EvalSettings : Config
           `flamegraph.pl`.
         )"};
 
+    Setting<std::string> evalCacheUpstream{this, "", "eval-cache-upstream",
+        R"(
+          URL prefix of a service holding shared flake evaluation
+          caches. When the local cache has no database for a flake
+          fingerprint, `<prefix>/<fingerprint>.sqlite` is fetched into
+          place first, so one machine's evaluation warms every machine
+          pointed at the same prefix (e.g. a CI fleet). Writes stay
+          local; publishing the cache directory back to the service is
+          left to external tooling. Only point this at a service you
+          trust, since cached values are used without re-evaluation.
+        )"};
+
     Setting<bool> useEvalCache{this, true, "eval-cache",
         R"(
             Whether to use the flake evaluation cache.
@@ -212,6 +243,59 @@ struct EvalSettings : Config
     Setting<unsigned int> maxCallDepth{this, 10000, "max-call-depth",
         "The maximum function call depth to allow before erroring."};
 
+    Setting<bool> useFileEvalCache{this, false, "eval-file-cache",
+        R"(
+          Whether to cache the results of evaluating Nix files on disk,
+          keyed on the hash of the file contents and the evaluation
+          settings that can influence the result. Only effective in
+          [pure evaluation mode](#conf-pure-eval): impure evaluation
+          can depend on the environment, which the cache key does not
+          capture.
+
+          Only files that evaluate to plain data (attribute sets, lists,
+          strings without context, numbers, paths) benefit; files whose
+          result contains functions or unevaluated expressions are
+          evaluated as usual, as are files whose evaluation reads any
+          other file (an import, a `readFile`, ...), since the cache
+          key only covers the file's own contents.
+        )"};
+
+    Setting<bool> useArenaAllocator{this, false, "eval-arena",
+        R"(
+          Whether to allocate evaluator values, environments and
+          attribute sets from a bump-pointer arena that is only
+          released in bulk when evaluation ends, instead of from the
+          garbage-collected heap. Garbage collection is disabled for
+          the lifetime of the process in this mode, so it is only
+          suitable for evaluate-once-and-exit invocations; long-lived
+          processes such as `nix repl` should leave it off.
+        )"};
+
+    Setting<bool> deferDrvWrites{this, false, "eval-defer-drv-writes",
+        R"(
+          Whether to keep instantiated derivations in memory during
+          evaluation and only write the `.drv` files to the store
+          when the evaluator itself needs them realised (e.g. for
+          import-from-derivation). Evaluation-only workloads
+          (`nix eval`, `nix search`, dry runs) then perform no store
+          writes at all.
+
+          Commands that read `.drv` files from the store after
+          evaluation (`nix build`, `nix-instantiate`, anything that
+          realises the result externally) must leave this off.
+        )"};
+
+    Setting<unsigned int> evalCores{this, 1, "eval-cores",
+        R"(
+          *Experimental scaffolding with no effect yet.* The number of
+          worker threads the parallel evaluation machinery may use.
+          No evaluation site in this release enqueues work on it, so
+          setting this changes nothing for any command; it exists so
+          that thread-safe traversals can be converted incrementally.
+          Worker threads are only started if work is actually
+          submitted. The default is 1, i.e. evaluation is sequential.
+        )"};
+
     Setting<bool> builtinsTraceDebugger{this, false, "debugger-on-trace",
         R"(
           If set to true and the `--debugger` flag is given, the following functions
@@ -40,7 +40,10 @@ struct InputCache;
 }
 struct EvalSettings;
 class EvalState;
+struct Executor;
+class PersistentFileEvalCache;
 class StorePath;
+struct Derivation;
 struct SingleDerivedPath;
 enum RepairFlag : bool;
 struct MemorySourceAccessor;
@@ -109,6 +112,13 @@ struct PrimOp
      */
     std::function<PrimOpFun> fun;
 
+    /**
+     * If `fun` wraps a plain function pointer (the common case), a
+     * cached copy of it, so that calls bypass the type-erased
+     * std::function dispatch. Filled in by `check()`.
+     */
+    PrimOpFun * rawFun = nullptr;
+
     /**
      * Optional experimental for this to be gated on.
      */
@@ -202,6 +212,43 @@ struct DebugTrace {
     }
 };
 
+/**
+ * A bump-pointer arena for evaluator allocations, used when the
+ * `eval-arena` setting is enabled. Memory is only reclaimed in bulk
+ * when the owning `EvalState` is destroyed, which suits
+ * evaluate-once-and-exit invocations; garbage collection is disabled
+ * for the lifetime of the process in this mode.
+ */
+class EvalArena
+{
+    static constexpr size_t chunkSize = 4 << 20;
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+
+    char * cur = nullptr;
+    size_t left = 0;
+
+public:
+
+    void * alloc(size_t n)
+    {
+        /* Keep allocations aligned for any evaluator object. Chunks
+           are zeroed on creation and never reused, so the result is
+           zeroed, as callers expect. */
+        n = (n + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+        if (n > left) {
+            auto size = std::max(chunkSize, n);
+            chunks.push_back(std::make_unique<char[]>(size));
+            cur = chunks.back().get();
+            left = size;
+        }
+        auto p = cur;
+        cur += n;
+        left -= n;
+        return p;
+    }
+};
+
 class EvalState : public std::enable_shared_from_this<EvalState>
 {
 public:
@@ -269,6 +316,15 @@ public:
     /** `"unknown"` */
     Value vStringUnknown;
 
+    /**
+     * Shared constants for the small non-negative integers, so hot
+     * list primops (e.g. `genList` indices) don't allocate the same
+     * tiny values over and over.
+     *
+     * These are _not_ singletons. Pointer equality is _not_ sufficient.
+     */
+    Value vSmallInts[256];
+
     /**
      * The accessor corresponding to `store`.
      */
@@ -350,6 +406,13 @@ public:
      */
     std::map<const Hash, ref<eval_cache::EvalCache>> evalCaches;
 
+    /**
+     * Executor for parallel evaluation (see the `eval-cores`
+     * setting). Only evaluation sites that are explicitly
+     * thread-safe may spawn work on it.
+     */
+    ref<Executor> executor;
+
 private:
 
     /* Cache for calls to addToStore(); maps source paths to the store
@@ -368,6 +431,12 @@ private:
     typedef std::unordered_map<SourcePath, Value, std::hash<SourcePath>, std::equal_to<SourcePath>, traceable_allocator<std::pair<const SourcePath, Value>>> FileEvalCache;
     FileEvalCache fileEvalCache;
 
+    /**
+     * On-disk cache of file evaluation results (see the
+     * `eval-file-cache` setting). Null if disabled or unavailable.
+     */
+    std::shared_ptr<PersistentFileEvalCache> fileEvalCacheDb;
+
     /**
      * Associate source positions of certain AST nodes with their preceding doc comment, if they have one.
      * Grouped by file.
@@ -383,6 +452,12 @@ private:
      */
     std::shared_ptr<RegexCache> regexCache;
 
+    /**
+     * Bump-pointer arena for values, environments and bindings (see
+     * the `eval-arena` setting). Null unless enabled.
+     */
+    std::unique_ptr<EvalArena> arena;
+
 #if NIX_USE_BOEHMGC
     /**
      * Allocation cache for GC'd Value objects.
@@ -393,6 +468,13 @@ private:
      * Allocation cache for size-1 Env objects.
      */
     std::shared_ptr<void *> env1AllocCache;
+
+    /**
+     * Allocation caches for size-1 and size-2 Bindings, the two
+     * most common attribute set sizes by far.
+     */
+    std::shared_ptr<void *> bindings1AllocCache;
+    std::shared_ptr<void *> bindings2AllocCache;
 #endif
 
 public:
@@ -864,6 +946,50 @@ public:
 
     DocComment getDocCommentForPos(PosIdx pos);
 
+    /**
+     * Derivations instantiated but not yet written to the store
+     * (see the `eval-defer-drv-writes` setting), keyed by their
+     * (final) store path.
+     */
+    std::map<StorePath, Derivation> pendingDrvWrites;
+
+    /**
+     * Write out any derivations deferred by
+     * `eval-defer-drv-writes`. Must be called before anything reads
+     * `.drv` files from the store.
+     */
+    void flushPendingDerivations();
+
+    /**
+     * Number of reads of files other than the one being evaluated:
+     * bumped by `evalFile` and by the filesystem primops
+     * (`readFile`, `readDir`, ...). The persistent file evaluation
+     * cache refuses to cache a result whose computation bumped this,
+     * since its key only covers the file's own contents.
+     */
+    uint64_t nrExternalFileReads = 0;
+
+    /**
+     * The source files parsed so far. Watch-style tools use this to
+     * find out which files should trigger a re-evaluation when they
+     * change.
+     */
+    std::vector<SourcePath> getParsedFiles() const;
+
+    /**
+     * Snapshot of the allocation counters, for profilers (see
+     * `MemoryProfiler`).
+     */
+    struct AllocationCounters
+    {
+        uint64_t values, envs, attrsets;
+    };
+
+    AllocationCounters getAllocationCounters() const
+    {
+        return { nrValues, nrEnvs, nrAttrsets };
+    }
+
 private:
 
     /**
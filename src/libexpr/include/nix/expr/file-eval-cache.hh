@@ -0,0 +1,57 @@
+#pragma once
+///@file
+
+#include <memory>
+
+#include "nix/util/hash.hh"
+
+namespace nix {
+
+class EvalState;
+struct Value;
+
+/**
+ * A persistent, SQLite-backed cache for the results of evaluating
+ * Nix files (see `EvalState::evalFile()`), keyed on a hash of the
+ * file contents and the evaluation settings that can influence the
+ * result.
+ *
+ * Only values in *literal normal form* are cached: nulls, booleans,
+ * integers, floats, context-free strings, paths in the root
+ * filesystem, and lists and attribute sets whose elements have
+ * already been evaluated to such values. Anything containing an
+ * unevaluated thunk, a function or a string with context is not
+ * cached, since rehydrating it would require re-running the
+ * evaluator anyway.
+ */
+class PersistentFileEvalCache
+{
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+
+public:
+
+    PersistentFileEvalCache();
+
+    ~PersistentFileEvalCache();
+
+    /**
+     * Look up a previously cached evaluation result. Returns `true`
+     * and initialises `v` on a hit.
+     */
+    bool lookup(const Hash & key, EvalState & state, Value & v);
+
+    /**
+     * Record the result of evaluating a file, if it is in literal
+     * normal form (see above). Does nothing otherwise.
+     */
+    void insert(const Hash & key, EvalState & state, Value & v);
+};
+
+/**
+ * Open the per-user file evaluation cache, or return null if it
+ * cannot be opened (e.g. a read-only cache directory).
+ */
+std::shared_ptr<PersistentFileEvalCache> makePersistentFileEvalCache();
+
+}
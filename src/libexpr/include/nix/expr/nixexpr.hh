@@ -13,6 +13,8 @@ namespace nix {
 
 class EvalState;
 class PosTable;
+struct Attr;
+class Bindings;
 struct Env;
 struct ExprWith;
 struct StaticEnv;
@@ -88,6 +90,20 @@ struct Expr
     Expr() {
         nrExprs++;
     }
+
+    /**
+     * Expr nodes are carved out of a bump-pointer arena, since they
+     * are allocated in large numbers during parsing and are never
+     * freed individually (the AST is retained for the lifetime of
+     * the process, see `fileParseCache`).
+     */
+    void * operator new(size_t size);
+
+    /**
+     * Arena memory; individual deallocation is a no-op.
+     */
+    void operator delete(void *, size_t) { }
+
     virtual ~Expr() { };
     virtual void show(const SymbolTable & symbols, std::ostream & str) const;
     virtual void bindVars(EvalState & es, const std::shared_ptr<const StaticEnv> & env);
@@ -170,6 +186,19 @@ struct ExprVar : Expr
     Level level = 0;
     Displacement displ = 0;
 
+    /* Single-entry lookup cache for variables bound by `with`: the
+       last attribute set this variable was resolved in, and the
+       attribute it resolved to. Attribute sets are immutable once
+       built, but expression nodes are invisible to the garbage
+       collector, so a pointer match alone could be a collected
+       set's address reused by a new one; the cache is therefore
+       only valid within the GC cycle that filled it (see
+       `gcEpoch()` in `eval.cc`). Only touched by the
+       (single-threaded) evaluator. */
+    mutable const Bindings * cachedFromBindings = nullptr;
+    mutable const Attr * cachedFromAttr = nullptr;
+    mutable size_t cachedFromEpoch = 0;
+
     ExprVar(Symbol name) : name(name) { };
     ExprVar(const PosIdx & pos, Symbol name) : pos(pos), name(name) { };
     Value * maybeThunk(EvalState & state, Env & env) override;
@@ -199,6 +228,20 @@ struct ExprSelect : Expr
     PosIdx pos;
     Expr * e, * def;
     AttrPath attrPath;
+
+    /* Per-site inline cache for the first attribute path component:
+       the same syntactic site usually selects from the same
+       (immutable) attribute set, e.g. `pkgs.stdenv` millions of
+       times, so a pointer compare replaces the binary search. Like
+       `ExprVar`'s cache, it is only valid within the GC cycle that
+       filled it, since this node holds the only reference and is
+       not scanned by the collector. Only touched by the
+       (single-threaded) evaluator. */
+    mutable const Bindings * cachedBindings = nullptr;
+    mutable const Attr * cachedAttr = nullptr;
+    mutable size_t cachedEpoch = 0;
+
+    const Attr * lookupWithCache(const Value & vAttrs, Symbol name, bool cacheable) const;
     ExprSelect(const PosIdx & pos, Expr * e, AttrPath attrPath, Expr * def) : pos(pos), e(e), def(def), attrPath(std::move(attrPath)) { };
     ExprSelect(const PosIdx & pos, Expr * e, Symbol name) : pos(pos), e(e), def(0) { attrPath.push_back(AttrName(name)); };
     PosIdx getPos() const override { return pos; }
@@ -0,0 +1,119 @@
+#pragma once
+///@file
+
+#include <functional>
+#include <future>
+#include <map>
+#include <random>
+#include <thread>
+
+#include "nix/util/sync.hh"
+#include "nix/util/error.hh"
+#include "nix/util/logging.hh"
+
+namespace nix {
+
+struct EvalSettings;
+
+/**
+ * A simple thread pool for parallel evaluation. Unlike `ThreadPool`,
+ * work items have priorities, and worker threads are registered with
+ * the garbage collector so that they can allocate and mutate values.
+ *
+ * When `eval-cores` is 1 (the default), work items are executed
+ * eagerly on the calling thread, so callers don't need to
+ * distinguish between the sequential and parallel case. Worker
+ * threads are only started when the first item is enqueued in
+ * parallel mode, so an `Executor` that is never used costs nothing
+ * regardless of the setting.
+ */
+struct Executor
+{
+    using work_t = std::function<void()>;
+
+    struct Item
+    {
+        std::promise<void> promise;
+        work_t work;
+    };
+
+    /**
+     * Whether parallel evaluation is enabled, i.e. `eval-cores` > 1.
+     */
+    const bool enabled;
+
+private:
+
+    struct State
+    {
+        /**
+         * Work items, ordered by priority. Lower keys are executed
+         * first; ties are broken randomly to avoid all threads
+         * hammering the same subtree.
+         */
+        std::multimap<uint64_t, Item> queue;
+        std::vector<std::thread> threads;
+        bool quit = false;
+    };
+
+    /**
+     * Number of worker threads to start on first use.
+     */
+    const size_t nrWorkers;
+
+    Sync<State> state_;
+
+    std::condition_variable wakeup;
+
+public:
+
+    Executor(const EvalSettings & evalSettings);
+
+    ~Executor();
+
+    /**
+     * Enqueue a work item with the given priority. Returns a future
+     * that becomes ready when the work item has finished (or thrown
+     * an exception). If parallel evaluation is disabled, the work
+     * item is executed immediately on the calling thread.
+     */
+    std::future<void> enqueue(work_t work, uint64_t priority = 0);
+
+private:
+
+    void worker();
+};
+
+/**
+ * Convenience class to spawn a set of work items on an `Executor` and
+ * wait for all of them to finish, propagating the first exception
+ * encountered. Outstanding futures are awaited by the destructor, so
+ * unwinding doesn't leave detached work touching destroyed state.
+ */
+struct FutureVector
+{
+    Executor & executor;
+
+private:
+
+    Sync<std::vector<std::future<void>>> futures;
+
+public:
+
+    FutureVector(Executor & executor)
+        : executor(executor)
+    {
+    }
+
+    ~FutureVector();
+
+    void spawn(Executor::work_t work, uint64_t priority = 0);
+
+    /**
+     * Wait for all spawned work items to finish. If any of them
+     * threw an exception, the first one is rethrown.
+     */
+    void finishAll();
+};
+
+} // namespace nix
@@ -85,6 +85,14 @@ struct PrintOptions
      */
     size_t maxStringLength = std::numeric_limits<size_t>::max();
 
+    /**
+     * Maximum total number of bytes to emit. When the budget is
+     * exhausted, printing stops with a truncation marker. This
+     * bounds both output size and printing time for pathological
+     * values, independently of the structural limits above.
+     */
+    size_t maxBytes = std::numeric_limits<size_t>::max();
+
     /**
      * Indentation width for pretty-printing.
      *
@@ -90,6 +90,14 @@ private:
 
 public:
 
+    SymbolTable()
+    {
+        /* A nixpkgs evaluation interns on the order of 100k symbols;
+           pre-sizing the table keeps the first seconds of parsing
+           out of rehash stalls. */
+        symbols.reserve(64 * 1024);
+    }
+
     /**
      * Converts a string into a symbol.
      */
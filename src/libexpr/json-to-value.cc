@@ -2,6 +2,7 @@
 #include "nix/expr/value.hh"
 #include "nix/expr/eval.hh"
 
+#include <algorithm>
 #include <limits>
 #include <variant>
 #include <nlohmann/json.hpp>
@@ -37,12 +38,24 @@ class JSONSax : nlohmann::json_sax<json> {
 
     class JSONObjectState : public JSONState {
         using JSONState::JSONState;
-        ValueMap attrs;
+
+        /* Keys are appended and sorted once at the end, which for
+           large machine-generated objects is much cheaper than a
+           node-based map insert per key. */
+        std::vector<std::pair<Symbol, Value *>, traceable_allocator<std::pair<Symbol, Value *>>> attrs;
+
         std::unique_ptr<JSONState> resolve(EvalState & state) override
         {
+            std::stable_sort(attrs.begin(), attrs.end(),
+                [](const auto & a, const auto & b) { return a.first < b.first; });
             auto attrs2 = state.buildBindings(attrs.size());
-            for (auto & i : attrs)
-                attrs2.insert(i.first, i.second);
+            for (size_t i = 0; i < attrs.size(); ++i) {
+                /* For duplicate keys, the last value wins, as
+                   before. */
+                if (i + 1 < attrs.size() && attrs[i].first == attrs[i + 1].first)
+                    continue;
+                attrs2.insert(attrs[i].first, attrs[i].second);
+            }
             parent->value(state).mkAttrs(attrs2);
             return std::move(parent);
         }
@@ -51,7 +64,7 @@ class JSONSax : nlohmann::json_sax<json> {
         void key(string_t & name, EvalState & state)
         {
             forceNoNullByte(name);
-            attrs.insert_or_assign(state.symbols.create(name), &value(state));
+            attrs.emplace_back(state.symbols.create(name), &value(state));
         }
     };
 
@@ -11,6 +11,32 @@
 
 namespace nix {
 
+void * Expr::operator new(size_t size)
+{
+    /* A simple thread-local bump allocator. Chunks are deliberately
+       leaked: the AST outlives any single evaluation and individual
+       nodes are never freed. */
+    constexpr size_t chunkSize = 1 << 20;
+
+    static thread_local char * cur = nullptr;
+    static thread_local size_t left = 0;
+
+    size = (size + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+    if (size > left) {
+        if (size > chunkSize)
+            return ::operator new(size);
+        cur = (char *) ::operator new(chunkSize);
+        left = chunkSize;
+    }
+
+    auto p = cur;
+    cur += size;
+    left -= size;
+    return p;
+}
+
+
 unsigned long Expr::nrExprs = 0;
 
 ExprBlackHole eBlackHole;
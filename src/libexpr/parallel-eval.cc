@@ -0,0 +1,142 @@
+#include "nix/expr/parallel-eval.hh"
+#include "nix/expr/eval-settings.hh"
+#include "nix/expr/eval-gc.hh"
+#include "nix/util/util.hh"
+
+namespace nix {
+
+Executor::Executor(const EvalSettings & evalSettings)
+    : enabled(evalSettings.evalCores > 1)
+    , nrWorkers(evalSettings.evalCores)
+{
+    /* Workers are started lazily by the first enqueue(), so an
+       executor that never sees a work item starts no threads. */
+}
+
+Executor::~Executor()
+{
+    std::vector<std::thread> threads;
+    {
+        auto state(state_.lock());
+        state->quit = true;
+        std::swap(threads, state->threads);
+        debug("stopping %d evaluation workers", threads.size());
+    }
+
+    wakeup.notify_all();
+
+    for (auto & thr : threads)
+        thr.join();
+}
+
+void Executor::worker()
+{
+    while (true) {
+        Item item;
+
+        {
+            auto state(state_.lock());
+            while (true) {
+                if (state->quit) return;
+                if (!state->queue.empty()) break;
+                state.wait(wakeup);
+            }
+            auto i = state->queue.begin();
+            item = std::move(i->second);
+            state->queue.erase(i);
+        }
+
+        try {
+            item.work();
+            item.promise.set_value();
+        } catch (...) {
+            item.promise.set_exception(std::current_exception());
+        }
+    }
+}
+
+std::future<void> Executor::enqueue(work_t work, uint64_t priority)
+{
+    std::promise<void> promise;
+    auto future = promise.get_future();
+
+    if (!enabled) {
+        /* Sequential mode: run the work item right away so callers
+           see exactly the same evaluation order as before. */
+        try {
+            work();
+            promise.set_value();
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+        return future;
+    }
+
+    {
+        auto state(state_.lock());
+
+        if (state->threads.empty() && !state->quit) {
+            debug("starting %d evaluation workers", nrWorkers);
+            for (size_t n = 0; n < nrWorkers; ++n)
+                state->threads.emplace_back([this]() {
+#if NIX_USE_BOEHMGC
+                    GC_stack_base sb;
+                    GC_get_stack_base(&sb);
+                    GC_register_my_thread(&sb);
+#endif
+                    worker();
+#if NIX_USE_BOEHMGC
+                    GC_unregister_my_thread();
+#endif
+                });
+        }
+
+        /* Perturb the priority a bit so that items with equal
+           priority don't all land on the same worker in FIFO order. */
+        thread_local std::mt19937 prng{std::random_device{}()};
+        state->queue.emplace(
+            (priority << 16) | (prng() & 0xffff),
+            Item{.promise = std::move(promise), .work = std::move(work)});
+    }
+
+    wakeup.notify_one();
+
+    return future;
+}
+
+FutureVector::~FutureVector()
+{
+    try {
+        finishAll();
+    } catch (...) {
+        ignoreExceptionInDestructor();
+    }
+}
+
+void FutureVector::spawn(Executor::work_t work, uint64_t priority)
+{
+    auto future = executor.enqueue(std::move(work), priority);
+    futures.lock()->push_back(std::move(future));
+}
+
+void FutureVector::finishAll()
+{
+    std::exception_ptr ex;
+    while (true) {
+        std::vector<std::future<void>> mine;
+        {
+            auto futures_(futures.lock());
+            if (futures_->empty()) break;
+            std::swap(mine, *futures_);
+        }
+        for (auto & future : mine)
+            try {
+                future.get();
+            } catch (...) {
+                if (!ex) ex = std::current_exception();
+            }
+    }
+    if (ex) std::rethrow_exception(ex);
+}
+
+} // namespace nix
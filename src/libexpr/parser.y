@@ -260,7 +260,31 @@ expr_op
   | expr_op UPDATE expr_op { $$ = new ExprOpUpdate(state->at(@2), $1, $3); }
   | expr_op '?' attrpath { $$ = new ExprOpHasAttr($1, std::move(*$3)); delete $3; }
   | expr_op '+' expr_op
-    { $$ = new ExprConcatStrings(state->at(@2), false, new std::vector<std::pair<PosIdx, Expr *> >({{state->at(@1), $1}, {state->at(@3), $3}})); }
+    { /* Flatten nested `+` chains into one node, so that
+         evaluating `a + b + c + ...` concatenates all the parts in
+         a single pass instead of copying the accumulated prefix at
+         every step (which is quadratic for long writeText-style
+         chains). Only `+` nodes are merged; interpolations
+         (forceString) keep their own coercion semantics. */
+      /* Constant-fold literal operands: `1 + 2` and `"a" + "b"`
+         have no observable behaviour besides their result (folding
+         is skipped on integer overflow, so that error still
+         surfaces lazily at evaluation time as before). */
+      std::optional<NixInt::Inner> foldedInt;
+      if (auto i1 = dynamic_cast<ExprInt *>($1))
+          if (auto i2 = dynamic_cast<ExprInt *>($3))
+              foldedInt = (i1->v.integer() + i2->v.integer()).valueChecked();
+      auto s1 = dynamic_cast<ExprString *>($1);
+      auto s2 = s1 ? dynamic_cast<ExprString *>($3) : nullptr;
+      if (foldedInt)
+          $$ = new ExprInt(NixInt(*foldedInt));
+      else if (s1 && s2)
+          $$ = new ExprString(std::string(s1->v.string_view()) + std::string(s2->v.string_view()));
+      else if (auto e1 = dynamic_cast<ExprConcatStrings *>($1); e1 && !e1->forceString) {
+          e1->es->emplace_back(state->at(@3), $3);
+          $$ = $1;
+      } else
+          $$ = new ExprConcatStrings(state->at(@2), false, new std::vector<std::pair<PosIdx, Expr *> >({{state->at(@1), $1}, {state->at(@3), $3}})); }
   | expr_op '-' expr_op { $$ = new ExprCall(state->at(@2), new ExprVar(state->s.sub), {$1, $3}); }
   | expr_op '*' expr_op { $$ = new ExprCall(state->at(@2), new ExprVar(state->s.mul), {$1, $3}); }
   | expr_op '/' expr_op { $$ = new ExprCall(state->at(@2), new ExprVar(state->s.div), {$1, $3}); }
@@ -58,6 +58,10 @@ std::string EvalState::realiseString(Value & s, StorePathSet * storePathsOutMayb
 
 StringMap EvalState::realiseContext(const NixStringContext & context, StorePathSet * maybePathsOut, bool isIFD)
 {
+    /* Realisation (and the validity checks below) read .drv files
+       from the store. */
+    flushPendingDerivations();
+
     std::vector<DerivedPath::Built> drvs;
     StringMap res;
 
@@ -96,11 +100,36 @@ StringMap EvalState::realiseContext(const NixStringContext & context, StorePathS
             drvs.begin()->to_string(*store)
         ).debugThrow();
 
-    /* Build/substitute the context. */
-    std::vector<DerivedPath> buildReqs;
-    buildReqs.reserve(drvs.size());
-    for (auto & d : drvs) buildReqs.emplace_back(DerivedPath { d });
-    buildStore->buildPaths(buildReqs, bmNormal, store);
+    /* Fast path: when every requested output is already built and
+       valid, skip setting up a build Worker. IFD-heavy evaluations
+       import thousands of already-built derivations and otherwise
+       pay the whole goal machinery per import. */
+    bool allValid = true;
+    try {
+        for (auto & drv : drvs) {
+            for (auto & [outputName, outputPath] : resolveDerivedPath(*buildStore, drv, &*store)) {
+                /* Protect the output from concurrent GC before
+                   checking it, as the build goals would have. */
+                buildStore->addTempRoot(outputPath);
+                if (!buildStore->isValidPath(outputPath)) {
+                    allValid = false;
+                    break;
+                }
+            }
+            if (!allValid) break;
+        }
+    } catch (Error &) {
+        /* E.g. not-yet-known content-addressed outputs. */
+        allValid = false;
+    }
+
+    if (!allValid) {
+        /* Build/substitute the context. */
+        std::vector<DerivedPath> buildReqs;
+        buildReqs.reserve(drvs.size());
+        for (auto & d : drvs) buildReqs.emplace_back(DerivedPath { d });
+        buildStore->buildPaths(buildReqs, bmNormal, store);
+    }
 
     StorePathSet outputsToCopyAndAllow;
 
@@ -1592,8 +1621,13 @@ static void derivationStrictInternal(
         }
     }
 
-    /* Write the resulting term into the Nix store directory. */
-    auto drvPath = writeDerivation(*state.store, drv, state.repair);
+    /* Write the resulting term into the Nix store directory (or,
+       with eval-defer-drv-writes, just compute its path and keep the
+       derivation in memory until something needs the file). */
+    auto deferWrite = state.settings.deferDrvWrites && !state.settings.readOnlyMode;
+    auto drvPath = writeDerivation(*state.store, drv, state.repair, /*readOnly=*/deferWrite);
+    if (deferWrite)
+        state.pendingDrvWrites.emplace(drvPath, drv);
     auto drvPathS = state.store->printStorePath(drvPath);
 
     printMsg(lvlChatty, "instantiated '%1%' -> '%2%'", drvName, drvPathS);
@@ -1729,6 +1763,7 @@ static RegisterPrimOp primop_storePath({
 
 static void prim_pathExists(EvalState & state, const PosIdx pos, Value * * args, Value & v)
 {
+    state.nrExternalFileReads++;
     try {
         auto & arg = *args[0];
 
@@ -1841,6 +1876,7 @@ static RegisterPrimOp primop_dirOf({
 /* Return the contents of a file as a string. */
 static void prim_readFile(EvalState & state, const PosIdx pos, Value * * args, Value & v)
 {
+    state.nrExternalFileReads++;
     auto path = realisePath(state, pos, *args[0]);
     auto s = path.readFile();
     if (s.find((char) 0) != std::string::npos)
@@ -1881,6 +1917,7 @@ static RegisterPrimOp primop_readFile({
    which are desugared to 'findFile __nixPath "x"'. */
 static void prim_findFile(EvalState & state, const PosIdx pos, Value * * args, Value & v)
 {
+    state.nrExternalFileReads++;
     state.forceList(*args[0], pos, "while evaluating the first argument passed to builtins.findFile");
 
     LookupPath lookupPath;
@@ -2059,6 +2096,7 @@ static RegisterPrimOp primop_findFile(PrimOp {
 /* Return the cryptographic hash of a file in base-16. */
 static void prim_hashFile(EvalState & state, const PosIdx pos, Value * * args, Value & v)
 {
+    state.nrExternalFileReads++;
     auto algo = state.forceStringNoCtx(*args[0], pos, "while evaluating the first argument passed to builtins.hashFile");
     std::optional<HashAlgorithm> ha = parseHashAlgo(algo);
     if (!ha)
@@ -2091,6 +2129,7 @@ static Value * fileTypeToString(EvalState & state, SourceAccessor::Type type)
 
 static void prim_readFileType(EvalState & state, const PosIdx pos, Value * * args, Value & v)
 {
+    state.nrExternalFileReads++;
     auto path = realisePath(state, pos, *args[0], std::nullopt);
     /* Retrieve the directory entry type and stringize it. */
     v = *fileTypeToString(state, path.lstat().type);
@@ -2109,6 +2148,7 @@ static RegisterPrimOp primop_readFileType({
 /* Read a directory (without . or ..) */
 static void prim_readDir(EvalState & state, const PosIdx pos, Value * * args, Value & v)
 {
+    state.nrExternalFileReads++;
     auto path = realisePath(state, pos, *args[0]);
 
     // Retrieve directory entries for all nodes in a directory.
@@ -2570,6 +2610,7 @@ static void addPath(
 
 static void prim_filterSource(EvalState & state, const PosIdx pos, Value * * args, Value & v)
 {
+    state.nrExternalFileReads++;
     NixStringContext context;
     auto path = state.coerceToPath(pos, *args[1], context,
         "while evaluating the second argument (the path to filter) passed to 'builtins.filterSource'");
@@ -2635,6 +2676,7 @@ static RegisterPrimOp primop_filterSource({
 
 static void prim_path(EvalState & state, const PosIdx pos, Value * * args, Value & v)
 {
+    state.nrExternalFileReads++;
     std::optional<SourcePath> path;
     std::string name;
     Value * filterFun = nullptr;
@@ -3644,8 +3686,13 @@ static void prim_genList(EvalState & state, const PosIdx pos, Value * * args, Va
 
     auto list = state.buildList(len);
     for (const auto & [n, v] : enumerate(list)) {
-        auto arg = state.allocValue();
-        arg->mkInt(n);
+        Value * arg;
+        if (n < sizeof(state.vSmallInts) / sizeof(*state.vSmallInts))
+            arg = &state.vSmallInts[n];
+        else {
+            arg = state.allocValue();
+            arg->mkInt(n);
+        }
         (v = state.allocValue())->mkApp(args[0], arg);
     }
     v.mkList(list);
@@ -4323,7 +4370,11 @@ struct RegexCache
 
     Sync<State> state_;
 
-    std::regex get(std::string_view re)
+    /* Note: returns a reference into the cache. Entries are never
+       erased and the map is node-based, so the reference stays
+       valid; copying a std::regex means deep-copying the compiled
+       automaton, which callers used to do once per match. */
+    const std::regex & get(std::string_view re)
     {
         auto state(state_.lock());
         auto it = state->cache.find(re);
@@ -4349,9 +4400,21 @@ void prim_match(EvalState & state, const PosIdx pos, Value * * args, Value & v)
 {
     auto re = state.forceStringNoCtx(*args[0], pos, "while evaluating the first argument passed to builtins.match");
 
+    /* Fast path: a pattern without any regex metacharacters can
+       only match itself exactly (and has no capture groups). */
+    if (re.find_first_of(".[]{}()\\*+?|^$") == std::string_view::npos) {
+        NixStringContext context;
+        const auto str = state.forceString(*args[1], context, pos, "while evaluating the second argument passed to builtins.match");
+        if (str == re)
+            v.mkList(state.buildList(0));
+        else
+            v.mkNull();
+        return;
+    }
+
     try {
 
-        auto regex = state.regexCache->get(re);
+        auto & regex = state.regexCache->get(re);
 
         NixStringContext context;
         const auto str = state.forceString(*args[1], context, pos, "while evaluating the second argument passed to builtins.match");
@@ -4428,7 +4491,7 @@ void prim_split(EvalState & state, const PosIdx pos, Value * * args, Value & v)
 
     try {
 
-        auto regex = state.regexCache->get(re);
+        auto & regex = state.regexCache->get(re);
 
         NixStringContext context;
         const auto str = state.forceString(*args[1], context, pos, "while evaluating the second argument passed to builtins.split");
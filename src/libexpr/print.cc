@@ -622,8 +622,69 @@ public:
     }
 };
 
+/* Thrown internally when the output byte budget is exhausted. */
+struct PrintBudgetExceeded {};
+
+/* A filter streambuf that throws PrintBudgetExceeded once the
+   budget is used up, so printing stops in O(1) memory no matter how
+   large the value is. */
+struct BudgetStreambuf : std::streambuf
+{
+    std::streambuf * inner;
+    size_t remaining;
+
+    BudgetStreambuf(std::streambuf * inner, size_t remaining)
+        : inner(inner), remaining(remaining)
+    { }
+
+    int_type overflow(int_type c) override
+    {
+        if (c == traits_type::eof()) return c;
+        if (!remaining) throw PrintBudgetExceeded{};
+        remaining--;
+        return inner->sputc(c);
+    }
+
+    std::streamsize xsputn(const char * s, std::streamsize n) override
+    {
+        if ((size_t) n > remaining) {
+            inner->sputn(s, remaining);
+            remaining = 0;
+            throw PrintBudgetExceeded{};
+        }
+        remaining -= n;
+        return inner->sputn(s, n);
+    }
+};
+
 void printValue(EvalState & state, std::ostream & output, Value & v, PrintOptions options)
 {
+    if (options.maxBytes != std::numeric_limits<size_t>::max()) {
+        auto * innerBuf = output.rdbuf();
+        BudgetStreambuf budgetBuf(innerBuf, options.maxBytes);
+        output.rdbuf(&budgetBuf);
+        /* Make insertion rethrow the budget exception instead of
+           just setting badbit, so the traversal stops immediately. */
+        auto oldExceptions = output.exceptions();
+        output.exceptions(std::ios::badbit);
+        auto restore = [&]() {
+            output.clear();
+            output.exceptions(oldExceptions);
+            output.rdbuf(innerBuf);
+        };
+        try {
+            Printer(output, state, options).print(v);
+            restore();
+        } catch (PrintBudgetExceeded &) {
+            restore();
+            output << " " ANSI_FAINT "«output truncated»" ANSI_NORMAL;
+        } catch (...) {
+            restore();
+            throw;
+        }
+        return;
+    }
+
     Printer(output, state, options).print(v);
 }
 
@@ -106,11 +106,158 @@ json printValueAsJSON(EvalState & state, bool strict,
     return out;
 }
 
+namespace {
+
+/* An attrset or list whose elements are still being streamed. */
+struct JsonFrame
+{
+    Value * v;
+    PosIdx pos;
+    bool isAttrs;
+    /** Attributes in output order (attrsets only). */
+    std::vector<const Attr *> attrs;
+    /** Index of the next element to emit. */
+    size_t next = 0;
+};
+
+}
+
+/* Streaming variant: emits tokens as values are forced, with an
+   explicit frame stack instead of C++ recursion, so deep manifests
+   serialize in flat memory instead of first materializing a
+   `nlohmann::json` tree several times the size of the output. Leaf
+   values still go through `nlohmann::json` so escaping, number
+   formatting and UTF-8 validation are bit-identical to the tree
+   builder above. */
 void printValueAsJSON(EvalState & state, bool strict,
     Value & v, const PosIdx pos, std::ostream & str, NixStringContext & context, bool copyToStore)
 {
+    std::vector<JsonFrame> stack;
+
+    auto emitString = [&](std::string_view s) {
+        str << json(s).dump();
+    };
+
+    /* Emit a single value: scalars are written directly, composites
+       open a new frame. Returns whether a frame was opened. */
+    auto emit = [&](Value * w, PosIdx wPos) -> bool {
+        checkInterrupt();
+
+        while (true) {
+            if (strict) state.forceValue(*w, wPos);
+
+            switch (w->type()) {
+
+                case nInt:
+                    str << json(w->integer().value).dump();
+                    return false;
+
+                case nBool:
+                    str << (w->boolean() ? "true" : "false");
+                    return false;
+
+                case nString:
+                    copyContext(*w, context);
+                    emitString(w->string_view());
+                    return false;
+
+                case nPath:
+                    if (copyToStore)
+                        emitString(state.store->printStorePath(
+                            state.copyPathToStore(context, w->path())));
+                    else
+                        emitString(w->path().path.abs());
+                    return false;
+
+                case nNull:
+                    str << "null";
+                    return false;
+
+                case nFloat:
+                    str << json(w->fpoint()).dump();
+                    return false;
+
+                case nAttrs: {
+                    if (auto maybeString = state.tryAttrsToString(wPos, *w, context, false, false)) {
+                        emitString(*maybeString);
+                        return false;
+                    }
+                    if (auto i = w->attrs()->get(state.sOutPath)) {
+                        /* A derivation: serialize its `outPath`
+                           instead. */
+                        w = i->value;
+                        wPos = i->pos;
+                        continue;
+                    }
+                    str << '{';
+                    stack.push_back({w, wPos, true, w->attrs()->lexicographicOrder(state.symbols)});
+                    return true;
+                }
+
+                case nList:
+                    str << '[';
+                    stack.push_back({w, wPos, false});
+                    return true;
+
+                case nExternal:
+                    str << w->external()->printValueAsJSON(state, strict, context, copyToStore).dump();
+                    return false;
+
+                case nThunk:
+                case nFunction:
+                    state.error<TypeError>(
+                        "cannot convert %1% to JSON",
+                        showType(*w)
+                    )
+                    .atPos(w->determinePos(wPos))
+                    .debugThrow();
+            }
+        }
+    };
+
     try {
-        str << printValueAsJSON(state, strict, v, pos, context, copyToStore);
+        emit(&v, pos);
+
+        while (!stack.empty()) {
+            /* Note: `emit` may push a frame, so don't hold a
+               reference to the top across it. */
+            auto & top = stack.back();
+
+            if (top.isAttrs) {
+                if (top.next == top.attrs.size()) {
+                    str << '}';
+                    stack.pop_back();
+                    continue;
+                }
+                auto a = top.attrs[top.next++];
+                if (top.next > 1) str << ',';
+                emitString(state.symbols[a->name]);
+                str << ':';
+                emit(a->value, a->pos);
+            } else {
+                if (top.next == top.v->listSize()) {
+                    str << ']';
+                    stack.pop_back();
+                    continue;
+                }
+                auto n = top.next++;
+                if (n > 0) str << ',';
+                emit(top.v->listElems()[n], top.pos);
+            }
+        }
+    } catch (Error & e) {
+        /* Reconstruct the traces the recursive builder would have
+           added while unwinding. */
+        for (auto i = stack.rbegin(); i != stack.rend(); ++i) {
+            if (i->isAttrs) {
+                auto a = i->attrs[i->next - 1];
+                e.addTrace(state.positions[a->pos],
+                    HintFmt("while evaluating attribute '%1%'", state.symbols[a->name]));
+            } else
+                e.addTrace(state.positions[i->pos],
+                    HintFmt("while evaluating list element at index %1%", i->next - 1));
+        }
+        throw;
     } catch (nlohmann::json::exception & e) {
         throw JSONSerializationError("JSON serialization error: %s", e.what());
     }
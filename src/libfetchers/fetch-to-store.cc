@@ -1,9 +1,82 @@
 #include "nix/fetchers/fetch-to-store.hh"
 #include "nix/fetchers/fetchers.hh"
 #include "nix/fetchers/fetch-settings.hh"
+#include "nix/fetchers/filtering-source-accessor.hh"
+#include "nix/util/hash.hh"
+
+#include <filesystem>
+
+#include <sys/stat.h>
 
 namespace nix {
 
+/* For accessors without a content fingerprint (e.g. dirty working
+   trees), compute a cheap metadata fingerprint from a stat walk over
+   the physical tree: path, mode, size, mtime and inode of every
+   entry, like git's index. A content change implies a metadata
+   change (modulo deliberate clock games, the same caveat git
+   accepts), so this is a sound cache key; any change merely causes
+   a re-dump. Trees modified within the last second are not
+   fingerprinted, to avoid the same-second race git also guards
+   against. */
+static std::optional<std::string> makeMetadataFingerprint(const SourcePath & path)
+{
+#ifdef _WIN32
+    return std::nullopt;
+#else
+    /* Only for accessors that expose the physical tree unfiltered;
+       with a filtering accessor (e.g. a dirty git tree) the stat
+       walk would cover files the dump excludes, and two filtered
+       views of the same tree would collide on one key. */
+    if (dynamic_cast<FilteringSourceAccessor *>(&*path.accessor))
+        return std::nullopt;
+
+    auto physical = path.accessor->getPhysicalPath(path.path);
+    if (!physical) return std::nullopt;
+
+    HashSink sink { HashAlgorithm::SHA256 };
+
+    auto now = time(0);
+
+    try {
+        sink(physical->string());
+
+        struct stat st;
+
+        auto add = [&](const std::filesystem::path & p) -> bool {
+            if (::lstat(p.c_str(), &st)) return false;
+            if (st.st_mtime >= now - 1) return false;
+            sink(fmt("%s;%d;%d;%d;%d;%d\n",
+                p.string(), st.st_mode, (uint64_t) st.st_size,
+                (uint64_t) st.st_mtime,
+#ifdef __APPLE__
+                (uint64_t) st.st_mtimespec.tv_nsec,
+#else
+                (uint64_t) st.st_mtim.tv_nsec,
+#endif
+                (uint64_t) st.st_ino));
+            return true;
+        };
+
+        if (!add(*physical)) return std::nullopt;
+
+        for (std::filesystem::recursive_directory_iterator it(*physical), end; it != end; ++it) {
+            /* Note: .git is deliberately *included*. Filtering
+               accessors (which exclude it from the dump) were
+               rejected above, so for the accessors that get here the
+               dump contains .git, and skipping it would let changes
+               confined to it (e.g. a plain 'git fetch') reuse a
+               store path with stale .git contents. */
+            if (!add(it->path())) return std::nullopt;
+        }
+    } catch (std::exception &) {
+        return std::nullopt;
+    }
+
+    return "dirty:" + sink.finish().first.to_string(HashFormat::Nix32, false);
+#endif
+}
+
 fetchers::Cache::Key makeFetchToStoreCacheKey(
     const std::string & name,
     const std::string & fingerprint,
@@ -34,8 +107,15 @@ StorePath fetchToStore(
 
     std::optional<fetchers::Cache::Key> cacheKey;
 
-    if (!filter && path.accessor->fingerprint) {
-        cacheKey = makeFetchToStoreCacheKey(std::string{name}, *path.accessor->fingerprint, method, path.path.abs());
+    auto fingerprint = path.accessor->fingerprint;
+    if (!fingerprint && !filter)
+        /* Dirty working trees can still be cached on their stat
+           metadata, making re-entry after an edit proportional to a
+           stat walk rather than a full dump. */
+        fingerprint = makeMetadataFingerprint(path);
+
+    if (!filter && fingerprint) {
+        cacheKey = makeFetchToStoreCacheKey(std::string{name}, *fingerprint, method, path.path.abs());
         if (auto res = settings.getCache()->lookupStorePath(*cacheKey, store)) {
             debug("store path cache hit for '%s'", path);
             return res->storePath;
@@ -183,8 +183,11 @@ std::vector<nlohmann::json> Fetch::fetchUrls(const std::vector<Pointer> & pointe
     FileTransferRequest request(httpUrl.to_string() + "/info/lfs/objects/batch");
     request.post = true;
     Headers headers;
-    if (this->url.scheme == "ssh")
-        headers.push_back({"Authorization", lfs::getLfsApiToken(this->url)});
+    if (this->url.scheme == "ssh") {
+        if (!authToken)
+            authToken = lfs::getLfsApiToken(this->url);
+        headers.push_back({"Authorization", *authToken});
+    }
     headers.push_back({"Content-Type", "application/vnd.git-lfs+json"});
     headers.push_back({"Accept", "application/vnd.git-lfs+json"});
     request.headers = headers;
@@ -490,6 +490,13 @@ struct GitRepoImpl : GitRepo, std::enable_shared_from_this<GitRepoImpl>
         const Hash & rev,
         bool smudgeLfs = false);
 
+    /**
+     * Cache of raw accessors, keyed on (rev, smudgeLfs), so that the
+     * tree entries they have already resolved are shared between
+     * users of this repository.
+     */
+    std::map<std::pair<Hash, bool>, ref<GitSourceAccessor>> rawAccessorCache;
+
     ref<SourceAccessor> getAccessor(
         const Hash & rev,
         bool exportIgnore,
@@ -1195,7 +1202,16 @@ ref<GitSourceAccessor> GitRepoImpl::getRawAccessor(
     bool smudgeLfs)
 {
     auto self = ref<GitRepoImpl>(shared_from_this());
-    return make_ref<GitSourceAccessor>(self, rev, smudgeLfs);
+    /* Share accessors per rev, so that the tree entries walked by
+       one user of this repository (and cached in the accessor's
+       lookup cache) don't have to be re-walked by the next one.
+       For large monorepos that walk is the dominant cost. */
+    auto key = std::pair(rev, smudgeLfs);
+    if (auto i = rawAccessorCache.find(key); i != rawAccessorCache.end())
+        return i->second;
+    auto accessor = make_ref<GitSourceAccessor>(self, rev, smudgeLfs);
+    rawAccessorCache.emplace(key, accessor);
+    return accessor;
 }
 
 ref<SourceAccessor> GitRepoImpl::getAccessor(
@@ -6,6 +6,8 @@
 
 #include <nlohmann/json_fwd.hpp>
 
+#include <optional>
+
 namespace nix::lfs {
 
 /**
@@ -30,6 +32,13 @@ struct Fetch
     // derived from git remote url
     nix::ParsedURL url;
 
+    /**
+     * Cached result of `git-lfs-authenticate` (ssh remotes only):
+     * running an ssh command per LFS object dominates cold fetches
+     * of pointer-heavy trees.
+     */
+    mutable std::optional<std::string> authToken;
+
     Fetch(git_repository * repo, git_oid rev);
     bool shouldFetch(const CanonPath & path) const;
     void fetch(
@@ -1,10 +1,45 @@
 #include "nix/fetchers/input-cache.hh"
 #include "nix/fetchers/registry.hh"
+#include "nix/fetchers/cache.hh"
+#include "nix/fetchers/fetch-settings.hh"
 #include "nix/util/sync.hh"
 #include "nix/util/source-path.hh"
 
 namespace nix::fetchers {
 
+/* Resolution results (original input -> locked input) are also
+   remembered across processes in the fetcher cache, subject to the
+   usual TTL, so that re-resolving an unlocked input (e.g. the HEAD
+   of a branch) doesn't hit the network on every invocation. Locked
+   inputs resolve to themselves and don't need this. */
+static const Cache::Domain inputResolutionDomain = "inputResolution";
+
+static bool isPersistentlyCacheable(const Input & input)
+{
+    /* Local sources (path inputs, local git checkouts) are expected
+       to reflect changes immediately; resolving them is cheap, so
+       never serve them from a TTL cache. */
+    return !input.isLocked() && !input.getSourcePath();
+}
+
+static std::optional<Input> lookupPersistentResolution(const Input & input)
+{
+    if (!isPersistentlyCacheable(input)) return std::nullopt;
+    auto res = input.settings->getCache()->lookupWithTTL({inputResolutionDomain, input.toAttrs()});
+    if (!res) return std::nullopt;
+    try {
+        return Input::fromAttrs(*input.settings, Attrs(*res));
+    } catch (Error &) {
+        return std::nullopt;
+    }
+}
+
+static void upsertPersistentResolution(const Input & input, const Input & lockedInput)
+{
+    if (!isPersistentlyCacheable(input) || !lockedInput.isLocked()) return;
+    input.settings->getCache()->upsert({inputResolutionDomain, input.toAttrs()}, lockedInput.toAttrs());
+}
+
 InputCache::CachedResult
 InputCache::getAccessor(ref<Store> store, const Input & originalInput, UseRegistries useRegistries)
 {
@@ -12,9 +47,17 @@ InputCache::getAccessor(ref<Store> store, const Input & originalInput, UseRegist
     Input resolvedInput = originalInput;
 
     if (!fetched) {
-        if (originalInput.isDirect()) {
+        /* An unexpired previous resolution of this input lets us
+           fetch the locked input directly, which for sources already
+           in the local fetcher caches requires no network. */
+        if (auto locked = lookupPersistentResolution(originalInput)) {
+            auto [accessor, lockedInput] = locked->getAccessor(store);
+            fetched.emplace(CachedInput{.lockedInput = lockedInput, .accessor = accessor});
+        }
+        else if (originalInput.isDirect()) {
             auto [accessor, lockedInput] = originalInput.getAccessor(store);
             fetched.emplace(CachedInput{.lockedInput = lockedInput, .accessor = accessor});
+            upsertPersistentResolution(originalInput, lockedInput);
         } else {
             if (useRegistries != UseRegistries::No) {
                 auto [res, extraAttrs] = lookupInRegistries(store, originalInput, useRegistries);
@@ -25,6 +68,7 @@ InputCache::getAccessor(ref<Store> store, const Input & originalInput, UseRegist
                     fetched.emplace(CachedInput{.lockedInput = lockedInput, .accessor = accessor});
                 }
                 upsert(resolvedInput, *fetched);
+                upsertPersistentResolution(originalInput, fetched->lockedInput);
             } else {
                 throw Error(
                     "'%s' is an indirect flake reference, but registry lookups are not allowed",
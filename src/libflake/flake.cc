@@ -7,7 +7,9 @@
 #include "nix/expr/eval-inline.hh"
 #include "nix/store/store-api.hh"
 #include "nix/fetchers/fetchers.hh"
+#include "nix/fetchers/attrs.hh"
 #include "nix/util/finally.hh"
+#include "nix/util/thread-pool.hh"
 #include "nix/fetchers/fetch-settings.hh"
 #include "nix/flake/settings.hh"
 #include "nix/expr/value-to-json.hh"
@@ -612,15 +614,35 @@ LockedFlake lockFlake(
 
                         node->inputs.insert_or_assign(id, childNode);
 
-                        /* If we have this input in updateInputs, then we
-                           must fetch the flake to update it. */
+                        /* Is an input *below* this one being updated?
+                           Since this node's own revision is unchanged,
+                           the lock file records exactly the inputs its
+                           flake.nix declares at that revision, so the
+                           subgraph can be relocked from the lock's
+                           recorded refs without refetching this flake.
+                           The exception is relative path inputs, whose
+                           resolution needs the flake's own source path;
+                           for those fall back to fetching. */
                         auto lb = lockFlags.inputUpdates.lower_bound(inputAttrPath);
 
-                        auto mustRefetch =
+                        auto hasDescendantUpdate =
                             lb != lockFlags.inputUpdates.end()
                             && lb->size() > inputAttrPath.size()
                             && std::equal(inputAttrPath.begin(), inputAttrPath.end(), lb->begin());
 
+                        bool mustRefetch = false;
+
+                        if (hasDescendantUpdate) {
+                            for (auto & i : oldLock->inputs)
+                                if (auto lockedNode = std::get_if<0>(&i.second))
+                                    if ((*lockedNode)->originalRef.input.isRelative()) {
+                                        mustRefetch = true;
+                                        break;
+                                    }
+                            if (!mustRefetch)
+                                debug("updating inputs of '%s' from its lock without refetching it", inputAttrPathS);
+                        }
+
                         FlakeInputs fakeInputs;
 
                         if (!mustRefetch) {
@@ -758,6 +780,31 @@ LockedFlake lockFlake(
 
         nodePaths.emplace(newLockFile.root, flake.path.parent());
 
+        /* Warm the input cache for all top-level inputs that will
+           need fetching, in parallel, so lock computation is bounded
+           by the slowest fetch instead of the sum of them. Only
+           direct inputs are prefetched (registry lookups stay on
+           the main thread), and failures are ignored here - they
+           resurface with proper context in computeLocks. */
+        {
+            ThreadPool prefetchPool;
+            for (auto & [id, input] : flake.inputs) {
+                if (!input.ref || input.follows) continue;
+                if (!input.ref->input.isDirect()) continue;
+                bool needed = lockFlags.recreateLockFile
+                    || lockFlags.inputUpdates.count({id})
+                    || !get(oldLockFile.root->inputs, id);
+                if (!needed) continue;
+                prefetchPool.enqueue([&state, ref{*input.ref}]() {
+                    try {
+                        state.inputCache->getAccessor(state.store, ref.input, fetchers::UseRegistries::No);
+                    } catch (...) {
+                    }
+                });
+            }
+            prefetchPool.process();
+        }
+
         computeLocks(
             flake.inputs,
             newLockFile.root,
@@ -949,28 +996,75 @@ void callFlake(EvalState & state,
 
 }
 
+/* Compute the fingerprint of a single locked input: its content
+   fingerprint plus the bits (revCount, lastModified) that can
+   influence evaluation but aren't implied by the content. */
+static std::optional<std::string> inputFingerprint(ref<Store> store, const FlakeRef & lockedRef)
+{
+    auto fingerprint = lockedRef.input.getFingerprint(store);
+    if (!fingerprint)
+        /* Some input schemes expose no fingerprint of their own -
+           notably relative path inputs, which the lock file
+           nevertheless treats as locked. Fall back to hashing the
+           locked attributes (narHash etc.), which is exactly what
+           the lock file attests for them; bailing out here would
+           silently disable the eval cache for any flake using such
+           inputs. */
+        fingerprint = fetchers::attrsToJSON(lockedRef.input.toAttrs()).dump();
+
+    *fingerprint += fmt(";%s", lockedRef.subdir);
+
+    if (auto revCount = lockedRef.input.getRevCount())
+        *fingerprint += fmt(";revCount=%d", *revCount);
+    if (auto lastModified = lockedRef.input.getLastModified())
+        *fingerprint += fmt(";lastModified=%d", *lastModified);
+
+    return fingerprint;
+}
+
+std::optional<std::map<std::string, std::string>> LockedFlake::getInputFingerprints(
+    ref<Store> store,
+    const fetchers::Settings & fetchSettings) const
+{
+    if (lockFile.isUnlocked(fetchSettings)) return std::nullopt;
+
+    std::map<std::string, std::string> res;
+
+    for (auto & [attrPath, edge] : lockFile.getAllInputs()) {
+        if (auto follows = std::get_if<1>(&edge)) {
+            /* The target has its own entry, but the shape of the
+               edge is part of the fingerprint. */
+            res.emplace(printInputAttrPath(attrPath), "follows:" + printInputAttrPath(*follows));
+            continue;
+        }
+        auto fingerprint = inputFingerprint(store, std::get<0>(edge)->lockedRef);
+        if (!fingerprint) return std::nullopt;
+        res.emplace(printInputAttrPath(attrPath), std::move(*fingerprint));
+    }
+
+    return res;
+}
+
 std::optional<Fingerprint> LockedFlake::getFingerprint(
     ref<Store> store,
     const fetchers::Settings & fetchSettings) const
 {
     if (lockFile.isUnlocked(fetchSettings)) return std::nullopt;
 
-    auto fingerprint = flake.lockedRef.input.getFingerprint(store);
+    auto fingerprint = inputFingerprint(store, flake.lockedRef);
     if (!fingerprint) return std::nullopt;
 
-    *fingerprint += fmt(";%s;%s", flake.lockedRef.subdir, lockFile);
+    /* Hash the per-input fingerprints rather than the lock file
+       serialisation, so that lock file churn that doesn't change any
+       locked input (reordering, formatting) doesn't invalidate the
+       eval cache, and cache layers can reuse the per-input values
+       for finer-grained invalidation. */
+    auto inputFingerprints = getInputFingerprints(store, fetchSettings);
+    if (!inputFingerprints) return std::nullopt;
 
-    /* Include revCount and lastModified because they're not
-       necessarily implied by the content fingerprint (e.g. for
-       tarball flakes) but can influence the evaluation result. */
-    if (auto revCount = flake.lockedRef.input.getRevCount())
-        *fingerprint += fmt(";revCount=%d", *revCount);
-    if (auto lastModified = flake.lockedRef.input.getLastModified())
-        *fingerprint += fmt(";lastModified=%d", *lastModified);
+    for (auto & [attrPath, fp] : *inputFingerprints)
+        *fingerprint += fmt(";%s=%s", attrPath, fp);
 
-    // FIXME: as an optimization, if the flake contains a lock file
-    // and we haven't changed it, then it's sufficient to use
-    // flake.sourceInfo.storePath for the fingerprint.
     return hashString(HashAlgorithm::SHA256, *fingerprint);
 }
 
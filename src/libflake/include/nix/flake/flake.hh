@@ -137,6 +137,22 @@ struct LockedFlake
     std::optional<Fingerprint> getFingerprint(
         ref<Store> store,
         const fetchers::Settings & fetchSettings) const;
+
+    /**
+     * Compute a fingerprint for every locked input, keyed by its
+     * attribute path in the lock file (e.g. `nixpkgs/nix`). Inputs
+     * that follow another input are skipped (the followed input has
+     * its own entry). Returns std::nullopt if any input has no
+     * fingerprint, e.g. because it is unlocked.
+     *
+     * The whole-flake fingerprint returned by `getFingerprint` is a
+     * hash of these, so cache layers that know which inputs an
+     * attribute depends on can use the per-input fingerprints for
+     * finer-grained invalidation.
+     */
+    std::optional<std::map<std::string, std::string>> getInputFingerprints(
+        ref<Store> store,
+        const fetchers::Settings & fetchSettings) const;
 };
 
 struct LockFlags
@@ -375,8 +375,13 @@ public:
 
     void update(State & state)
     {
-        state.haveUpdate = true;
-        updateCV.notify_one();
+        /* Only poke the render thread on the first update since the
+           last draw; with thousands of parallel goals the redundant
+           notifications are a futex syscall per activity event. */
+        if (!state.haveUpdate) {
+            state.haveUpdate = true;
+            updateCV.notify_one();
+        }
     }
 
     /**
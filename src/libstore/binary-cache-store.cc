@@ -1,4 +1,5 @@
 #include "nix/util/archive.hh"
+#include "nix/util/content-chunker.hh"
 #include "nix/store/binary-cache-store.hh"
 #include "nix/util/compression.hh"
 #include "nix/store/derivations.hh"
@@ -6,6 +7,7 @@
 #include "nix/store/globals.hh"
 #include "nix/store/nar-info.hh"
 #include "nix/util/sync.hh"
+#include "nix/util/util.hh"
 #include "nix/store/remote-fs-accessor.hh"
 #include "nix/store/nar-info-disk-cache.hh"
 #include "nix/store/nar-accessor.hh"
@@ -14,10 +16,15 @@
 #include "nix/util/signals.hh"
 #include "nix/util/archive.hh"
 
+#include <array>
 #include <chrono>
+#include <deque>
 #include <future>
+#include <random>
 #include <regex>
 #include <fstream>
+
+#include <fcntl.h>
 #include <sstream>
 
 #include <nlohmann/json.hpp>
@@ -125,17 +132,99 @@ void BinaryCacheStore::writeNarInfo(ref<NarInfo> narInfo)
 
     upsertFile(narInfoFile, narInfo->to_string(*this), "text/x-nix-narinfo");
 
-    {
-        auto state_(state.lock());
-        state_->pathInfoCache.upsert(
-            std::string(narInfo->path.to_string()),
-            PathInfoCacheValue { .value = std::shared_ptr<NarInfo>(narInfo) });
-    }
+    pathInfoCache.upsert(
+        std::string(narInfo->path.to_string()),
+        PathInfoCacheValue { .value = std::shared_ptr<NarInfo>(narInfo) });
 
     if (diskCache)
         diskCache->upsertNarInfo(getUri(), std::string(narInfo->path.hashPart()), std::shared_ptr<NarInfo>(narInfo));
 }
 
+/* A sink that forwards data to another sink on a worker thread, with
+   a bounded buffer in between. Used to overlap NAR hashing and
+   listing with (much more expensive) compression. */
+struct AsyncSink : Sink
+{
+    struct State
+    {
+        std::string data;
+        bool quit = false;
+        std::exception_ptr exc;
+    };
+
+    Sync<State> state_;
+    std::condition_variable avail, drain;
+    Sink & nextSink;
+    std::thread thread;
+
+    static constexpr size_t maxBuffer = 64 * 1024 * 1024;
+
+    AsyncSink(Sink & nextSink)
+        : nextSink(nextSink)
+        , thread([this]() { run(); })
+    { }
+
+    ~AsyncSink()
+    {
+        try {
+            finish();
+        } catch (...) {
+            ignoreExceptionInDestructor();
+        }
+    }
+
+    void run()
+    {
+        while (true) {
+            std::string chunk;
+            {
+                auto state(state_.lock());
+                while (state->data.empty() && !state->quit)
+                    state.wait(avail);
+                if (state->data.empty()) return;
+                chunk = std::move(state->data);
+                state->data.clear();
+            }
+            drain.notify_one();
+            try {
+                nextSink(chunk);
+            } catch (...) {
+                auto state(state_.lock());
+                state->exc = std::current_exception();
+                state->quit = true;
+                drain.notify_one();
+                return;
+            }
+        }
+    }
+
+    void operator () (std::string_view data) override
+    {
+        auto state(state_.lock());
+        while (!state->quit && state->data.size() > maxBuffer)
+            state.wait(drain);
+        if (state->exc) std::rethrow_exception(state->exc);
+        state->data.append(data);
+        avail.notify_one();
+    }
+
+    /**
+     * Wait for the worker thread to finish writing all data to the
+     * next sink, rethrowing any exception it encountered.
+     */
+    void finish()
+    {
+        {
+            auto state(state_.lock());
+            state->quit = true;
+        }
+        avail.notify_all();
+        if (thread.joinable()) thread.join();
+        auto state(state_.lock());
+        if (state->exc) std::rethrow_exception(state->exc);
+    }
+};
+
 ref<const ValidPathInfo> BinaryCacheStore::addToStoreCommon(
     Source & narSource, RepairFlag repair, CheckSigsFlag checkSigs,
     std::function<ValidPathInfo(HashResult)> mkInfo)
@@ -152,7 +241,26 @@ ref<const ValidPathInfo> BinaryCacheStore::addToStoreCommon(
     HashSink fileHashSink { HashAlgorithm::SHA256 };
     std::shared_ptr<SourceAccessor> narAccessor;
     HashSink narHashSink { HashAlgorithm::SHA256 };
-    {
+    nlohmann::json manifestChunks = nlohmann::json::array();
+
+    if (config.chunkedNars) {
+        /* Split the uncompressed NAR into content-defined chunks,
+           uploading only chunks the cache doesn't already have. */
+        ChunkingSink chunkingSink([&](std::string_view chunk) {
+            auto hash = hashString(HashAlgorithm::SHA256, chunk);
+            auto key = "chunks/" + hash.to_string(HashFormat::Nix32, false);
+            if (repair || !fileExists(key))
+                upsertFile(key, std::string(chunk), "application/octet-stream");
+            manifestChunks.push_back({
+                {"hash", hash.to_string(HashFormat::Nix32, true)},
+                {"size", chunk.size()},
+            });
+        });
+        TeeSink teeSinkUncompressed { chunkingSink, narHashSink };
+        TeeSource teeSource { narSource, teeSinkUncompressed };
+        narAccessor = makeNarAccessor(teeSource);
+        chunkingSink.finish();
+    } else {
     FdSink fileSink(fdTemp.get());
     TeeSink teeSinkCompressed { fileSink, fileHashSink };
     auto compressionSink = makeCompressionSink(
@@ -160,9 +268,13 @@ ref<const ValidPathInfo> BinaryCacheStore::addToStoreCommon(
         teeSinkCompressed,
         config.parallelCompression,
         config.compressionLevel);
-    TeeSink teeSinkUncompressed { *compressionSink, narHashSink };
+    /* Compress on a worker thread, so that hashing and generating
+       the NAR listing overlap with the compressor. */
+    AsyncSink asyncSink { *compressionSink };
+    TeeSink teeSinkUncompressed { asyncSink, narHashSink };
     TeeSource teeSource { narSource, teeSinkUncompressed };
     narAccessor = makeNarAccessor(teeSource);
+    asyncSink.finish();
     compressionSink->finish();
     fileSink.flush();
     }
@@ -171,18 +283,34 @@ ref<const ValidPathInfo> BinaryCacheStore::addToStoreCommon(
 
     auto info = mkInfo(narHashSink.finish());
     auto narInfo = make_ref<NarInfo>(info);
-    narInfo->compression = config.compression;
-    auto [fileHash, fileSize] = fileHashSink.finish();
-    narInfo->fileHash = fileHash;
-    narInfo->fileSize = fileSize;
-    narInfo->url = "nar/" + narInfo->fileHash->to_string(HashFormat::Nix32, false) + ".nar"
-                   + (config.compression == "xz" ? ".xz" :
-           config.compression == "bzip2" ? ".bz2" :
-           config.compression == "zstd" ? ".zst" :
-           config.compression == "lzip" ? ".lzip" :
-           config.compression == "lz4" ? ".lz4" :
-           config.compression == "br" ? ".br" :
-           "");
+    std::optional<std::string> manifest;
+    uint64_t fileSize;
+    if (config.chunkedNars) {
+        /* The "file" is the manifest; the reassembled stream is the
+           raw NAR. */
+        narInfo->compression = "none";
+        manifest = nlohmann::json{
+            {"version", 1},
+            {"narSize", info.narSize},
+            {"chunks", std::move(manifestChunks)},
+        }.dump();
+        narInfo->fileHash = hashString(HashAlgorithm::SHA256, *manifest);
+        narInfo->fileSize = fileSize = manifest->size();
+        narInfo->url = "nar/" + info.narHash.to_string(HashFormat::Nix32, false) + ".nar.chunks";
+    } else {
+        narInfo->compression = config.compression;
+        auto [fileHash, fileSize_] = fileHashSink.finish();
+        narInfo->fileHash = fileHash;
+        narInfo->fileSize = fileSize = fileSize_;
+        narInfo->url = "nar/" + narInfo->fileHash->to_string(HashFormat::Nix32, false) + ".nar"
+                       + (config.compression == "xz" ? ".xz" :
+               config.compression == "bzip2" ? ".bz2" :
+               config.compression == "zstd" ? ".zst" :
+               config.compression == "lzip" ? ".lzip" :
+               config.compression == "lz4" ? ".lz4" :
+               config.compression == "br" ? ".br" :
+               "");
+    }
 
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(now2 - now1).count();
     printMsg(lvlTalkative, "copying path '%1%' (%2% bytes, compressed %3$.1f%% in %4% ms) to binary cache",
@@ -202,14 +330,20 @@ ref<const ValidPathInfo> BinaryCacheStore::addToStoreCommon(
         }
 
     /* Optionally write a JSON file containing a listing of the
-       contents of the NAR. */
+       contents of the NAR. The listing comes from the index built
+       during the NAR streaming pass above, so this costs no extra
+       pass over the NAR; uploading it happens concurrently with the
+       NAR upload below. */
+    std::future<void> listingUpload;
     if (config.writeNARListing) {
-        nlohmann::json j = {
-            {"version", 1},
-            {"root", listNar(ref<SourceAccessor>(narAccessor), CanonPath::root, true)},
-        };
+        listingUpload = std::async(std::launch::async, [&]() {
+            nlohmann::json j = {
+                {"version", 1},
+                {"root", listNar(ref<SourceAccessor>(narAccessor), CanonPath::root, true)},
+            };
 
-        upsertFile(std::string(info.path.hashPart()) + ".ls", j.dump(), "application/json");
+            upsertFile(std::string(info.path.hashPart()) + ".ls", j.dump(), "application/json");
+        });
     }
 
     /* Optionally maintain an index of DWARF debug info files
@@ -269,8 +403,15 @@ ref<const ValidPathInfo> BinaryCacheStore::addToStoreCommon(
         }
     }
 
-    /* Atomically write the NAR file. */
-    if (repair || !fileExists(narInfo->url)) {
+    /* Atomically write the NAR file (or, in chunked mode, its
+       manifest; the chunks were uploaded above). */
+    if (config.chunkedNars) {
+        if (repair || !fileExists(narInfo->url)) {
+            stats.narWrite++;
+            upsertFile(narInfo->url, std::string(*manifest), "application/json");
+        } else
+            stats.narWriteAverted++;
+    } else if (repair || !fileExists(narInfo->url)) {
         stats.narWrite++;
         upsertFile(narInfo->url,
             std::make_shared<std::fstream>(fnTemp, std::ios_base::in | std::ios_base::binary),
@@ -282,6 +423,41 @@ ref<const ValidPathInfo> BinaryCacheStore::addToStoreCommon(
     stats.narWriteCompressedBytes += fileSize;
     stats.narWriteCompressionTimeMs += duration;
 
+    if (listingUpload.valid())
+        listingUpload.get();
+
+    /* Roll up the closure sizes, so one narinfo fetch prices a whole
+       substitution. During a closure copy the references were just
+       uploaded, so their infos sit in the in-memory path info cache;
+       the walk deliberately uses only that cache - if anything is
+       missing the rollup is omitted rather than fetched, so uploads
+       never trigger narinfo round trips of their own. */
+    {
+        StorePathSet seen{info.path};
+        std::deque<StorePath> queue{info.references.begin(), info.references.end()};
+        uint64_t closureNarSize = 0, closureFileSize = 0;
+        bool complete = true;
+        while (!queue.empty()) {
+            auto p = std::move(queue.front());
+            queue.pop_front();
+            if (!seen.insert(p).second) continue;
+            auto refInfo = queryPathInfoFromClientCache(p);
+            if (!refInfo || !*refInfo) {
+                complete = false;
+                break;
+            }
+            auto refNarInfo = std::dynamic_pointer_cast<const NarInfo>(*refInfo);
+            closureNarSize += (*refInfo)->narSize;
+            closureFileSize += refNarInfo ? refNarInfo->fileSize : (*refInfo)->narSize;
+            for (auto & r : (*refInfo)->references)
+                queue.push_back(r);
+        }
+        if (complete) {
+            narInfo->closureNarSize = closureNarSize + narInfo->narSize;
+            narInfo->closureFileSize = closureFileSize + narInfo->fileSize;
+        }
+    }
+
     narInfo->sign(*this, signers);
 
     /* Atomically write the NAR info file.*/
@@ -402,17 +578,112 @@ std::optional<StorePath> BinaryCacheStore::queryPathFromHashPart(const std::stri
     }
 }
 
+void BinaryCacheStore::logAccess(std::string_view op, std::string_view key, bool hit, uint64_t bytes, uint64_t durationMs)
+{
+    if (config.accessLog.get().empty()) return;
+
+    try {
+        auto file(accessLogFile.lock());
+        if (!*file)
+            *file = std::make_shared<std::ofstream>(config.accessLog.get(), std::ios_base::app);
+        **file << nlohmann::json({
+            {"op", op},
+            {"key", key},
+            {"hit", hit},
+            {"bytes", bytes},
+            {"ms", durationMs},
+        }).dump() << "\n" << std::flush;
+    } catch (...) {
+        ignoreExceptionExceptInterrupt();
+    }
+}
+
 void BinaryCacheStore::narFromPath(const StorePath & storePath, Sink & sink)
 {
     auto info = queryPathInfo(storePath).cast<const NarInfo>();
 
+    auto startTime = std::chrono::steady_clock::now();
+
     LengthSink narSize;
     TeeSink tee { sink, narSize };
 
     auto decompressor = makeDecompressionSink(info->compression, tee);
 
+    /* Node-local cache of downloaded (compressed) NARs, shared by
+       all stores of this user: co-located jobs substituting
+       overlapping closures into different chroot stores then
+       download each NAR once. Uses the same directory as
+       local-nar-cache. Files are written to a temp name and renamed,
+       so concurrent readers only ever see complete entries. */
+    std::optional<Path> narCachePath;
+    if (auto cacheDir = config.localNarCache.get(); cacheDir != "" && info->fileHash && !hasSuffix(info->url, ".chunks"))
+        narCachePath = cacheDir + "/" + info->fileHash->to_string(HashFormat::Nix32, false) + ".nar-cache";
+
     try {
-        getFile(info->url, *decompressor);
+        if (narCachePath && pathExists(*narCachePath)) {
+            readFile(*narCachePath, *decompressor);
+        } else if (hasSuffix(info->url, ".chunks")) {
+            /* A chunked NAR: fetch the manifest, then stream the
+               chunks in order. */
+            auto manifest = getFile(info->url);
+            if (!manifest)
+                throw NoSuchBinaryCacheFile("file '%s' does not exist in binary cache '%s'", info->url, getUri());
+            auto json = nlohmann::json::parse(*manifest);
+            if (json.at("version") != 1)
+                throw Error("unsupported chunked NAR manifest version in binary cache '%s'", getUri());
+            /* With a local NAR cache configured, chunks are kept on
+               disk keyed by their content hash. Since version updates
+               mostly shift content without changing it, re-downloading
+               an updated path then only transfers the chunks that
+               actually differ from what previous downloads left
+               behind - the content-addressed equivalent of delta
+               substitution, with no from/to pairing needed. */
+            std::optional<Path> chunkCacheDir;
+            if (auto cacheDir = config.localNarCache.get(); cacheDir != "") {
+                chunkCacheDir = cacheDir + "/chunks";
+                createDirs(*chunkCacheDir);
+            }
+            for (auto & chunk : json.at("chunks")) {
+                auto hash = Hash::parseAnyPrefixed(chunk.at("hash").get<std::string>());
+                auto key = hash.to_string(HashFormat::Nix32, false);
+                if (chunkCacheDir) {
+                    auto chunkPath = *chunkCacheDir + "/" + key;
+                    if (pathExists(chunkPath)) {
+                        readFile(chunkPath, *decompressor);
+                        continue;
+                    }
+                    auto data = getFile("chunks/" + key);
+                    if (!data)
+                        throw NoSuchBinaryCacheFile("file '%s' does not exist in binary cache '%s'", "chunks/" + key, getUri());
+                    if (hashString(hash.algo, *data) != hash)
+                        throw Error("hash mismatch in chunk '%s' of binary cache '%s'", key, getUri());
+                    auto tmpPath = chunkPath + ".tmp." + std::to_string(getpid());
+                    writeFile(tmpPath, *data);
+                    std::filesystem::rename(tmpPath, chunkPath);
+                    (*decompressor)(*data);
+                } else
+                    getFile("chunks/" + key, *decompressor);
+            }
+        } else if (narCachePath) {
+            createDirs(dirOf(*narCachePath));
+            auto tmpPath = *narCachePath + ".tmp." + std::to_string(getpid());
+            AutoDelete delTmp(tmpPath);
+            {
+                AutoCloseFD fd = toDescriptor(open(tmpPath.c_str(), O_CREAT | O_TRUNC | O_WRONLY
+#ifndef _WIN32
+                    | O_CLOEXEC
+#endif
+                    , 0600));
+                if (!fd) throw SysError("creating '%s'", tmpPath);
+                FdSink fileSink(fd.get());
+                TeeSink tee2 { *decompressor, fileSink };
+                getFile(info->url, tee2);
+                fileSink.flush();
+            }
+            std::filesystem::rename(tmpPath, *narCachePath);
+            delTmp.cancel();
+        } else
+            getFile(info->url, *decompressor);
     } catch (NoSuchBinaryCacheFile & e) {
         throw SubstituteGone(std::move(e.info()));
     }
@@ -422,8 +693,75 @@ void BinaryCacheStore::narFromPath(const StorePath & storePath, Sink & sink)
     stats.narRead++;
     //stats.narReadCompressedBytes += nar->size(); // FIXME
     stats.narReadBytes += narSize.length;
+
+    logAccess("nar", storePath.to_string(), true, narSize.length,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime).count());
 }
 
+/* A bloom filter over the hash parts of the store paths available
+   in a binary cache, published by the cache operator as
+   `store-paths.bloom` (see `parse` for the format). Lets clients
+   skip the .narinfo round trip for paths the cache definitely
+   doesn't have. */
+struct StorePathBloomFilter
+{
+    static constexpr std::string_view magic{"NIXBLOOM1\n"};
+
+    uint64_t nrBits;
+    uint32_t nrHashes;
+    std::string bits;
+
+    /* Format: the magic string, a little-endian uint64 number of
+       bits, a little-endian uint32 number of hash functions, and
+       ceil(nrBits / 8) bytes of filter data. Bit indexes are derived
+       from consecutive little-endian uint64s of the SHA-256 of the
+       hash part. */
+    static std::optional<StorePathBloomFilter> parse(std::string_view s)
+    {
+        if (!hasPrefix(s, magic)) return std::nullopt;
+        s.remove_prefix(magic.size());
+        if (s.size() < 12) return std::nullopt;
+
+        StorePathBloomFilter filter;
+
+        auto readLE = [&](size_t bytes) {
+            uint64_t n = 0;
+            for (size_t i = 0; i < bytes; ++i)
+                n |= (uint64_t) (unsigned char) s[i] << (8 * i);
+            s.remove_prefix(bytes);
+            return n;
+        };
+
+        filter.nrBits = readLE(8);
+        filter.nrHashes = readLE(4);
+
+        if (filter.nrBits == 0
+            || filter.nrHashes == 0
+            || filter.nrHashes > 4 /* only 32 digest bytes available */
+            || s.size() < (filter.nrBits + 7) / 8)
+            return std::nullopt;
+
+        filter.bits = std::string(s.substr(0, (filter.nrBits + 7) / 8));
+
+        return filter;
+    }
+
+    bool mayContain(std::string_view hashPart) const
+    {
+        auto h = hashString(HashAlgorithm::SHA256, hashPart);
+        for (uint32_t i = 0; i < nrHashes; ++i) {
+            uint64_t n = 0;
+            for (size_t j = 0; j < 8; ++j)
+                n |= (uint64_t) h.hash[i * 8 + j] << (8 * j);
+            auto bit = n % nrBits;
+            if (!((unsigned char) bits[bit / 8] & (1 << (bit % 8))))
+                return false;
+        }
+        return true;
+    }
+};
+
 void BinaryCacheStore::queryPathInfoUncached(const StorePath & storePath,
     Callback<std::shared_ptr<const ValidPathInfo>> callback) noexcept
 {
@@ -433,15 +771,48 @@ void BinaryCacheStore::queryPathInfoUncached(const StorePath & storePath,
         fmt("querying info about '%s' on '%s'", storePathS, uri), Logger::Fields{storePathS, uri});
     PushActivity pact(act->id);
 
+    /* If the cache publishes a filter of its store paths, consult it
+       before going to the network: a negative answer is definite
+       (modulo filter staleness, see the `store-paths.bloom` docs)
+       and saves a 404 round trip. */
+    std::call_once(pathFilterInit, [&]() {
+        try {
+            if (auto data = getFile("store-paths.bloom")) {
+                if (auto filter = StorePathBloomFilter::parse(*data))
+                    pathFilter = std::make_shared<StorePathBloomFilter>(std::move(*filter));
+                if (pathFilter)
+                    debug("using store path filter of '%s' (%d bits, %d hashes)",
+                        uri, pathFilter->nrBits, pathFilter->nrHashes);
+                else
+                    warn("ignoring malformed store path filter of '%s'", uri);
+            }
+        } catch (...) {
+            /* The filter is only an optimization; failure to fetch
+               it must not fail the query. */
+            ignoreExceptionExceptInterrupt();
+        }
+    });
+
+    if (pathFilter && !pathFilter->mayContain(storePath.hashPart())) {
+        stats.narInfoMissing++;
+        return callback({});
+    }
+
     auto narInfoFile = narInfoFileFor(storePath);
 
     auto callbackPtr = std::make_shared<decltype(callback)>(std::move(callback));
 
+    auto startTime = std::chrono::steady_clock::now();
+
     getFile(narInfoFile,
         {[=,this](std::future<std::optional<std::string>> fut) {
             try {
                 auto data = fut.get();
 
+                auto durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - startTime).count();
+                logAccess("narinfo", storePath.hashPart(), (bool) data, data ? data->size() : 0, durationMs);
+
                 if (!data) return (*callbackPtr)({});
 
                 stats.narInfoRead++;
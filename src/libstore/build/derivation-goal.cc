@@ -1,4 +1,6 @@
 #include "nix/store/build/derivation-goal.hh"
+
+#include <limits>
 #ifndef _WIN32 // TODO enable build hook on Windows
 #  include "nix/store/build/hook-instance.hh"
 #  include "nix/store/build/derivation-builder.hh"
@@ -80,11 +82,18 @@ DerivationGoal::~DerivationGoal()
 
 std::string DerivationGoal::key()
 {
-    /* Ensure that derivations get built in order of their name,
-       i.e. a derivation named "aardvark" always comes before
-       "baboon". And substitution goals always happen before
-       derivation goals (due to "b$"). */
-    return "b$" + std::string(drvPath.name()) + "$" + worker.store.printStorePath(drvPath);
+    /* Substitution goals happen before derivation goals (due to
+       "b$"). Among derivation goals, those with longer expected
+       build times (from recorded durations of previous builds) sort
+       first, so build slots go to the approximate critical path
+       instead of wide fan-outs of short jobs; ties fall back to the
+       name ordering. */
+    if (keyPrefix.empty()) {
+        auto expected = worker.getExpectedBuildTime(drvPath);
+        debug("expected build time of '%s' is %ds", worker.store.printStorePath(drvPath), expected);
+        keyPrefix = fmt("%016x", std::numeric_limits<uint64_t>::max() - expected);
+    }
+    return "b$" + keyPrefix + "$" + std::string(drvPath.name()) + "$" + worker.store.printStorePath(drvPath);
 }
 
 
@@ -192,8 +201,7 @@ Goal::Co DerivationGoal::haveDerivation()
         parsedDrv = std::make_unique<StructuredAttrs>(*parsedOpt);
     }
     try {
-        drvOptions = std::make_unique<DerivationOptions>(
-            DerivationOptions::fromStructuredAttrs(drv->env, parsedDrv.get()));
+        drvOptions = DerivationOptions::fromStructuredAttrsShared(drv->env, parsedDrv.get());
     } catch (Error & e) {
         e.addTrace({}, "while parsing derivation '%s'", worker.store.printStorePath(drvPath));
         throw;
@@ -513,6 +521,15 @@ Goal::Co DerivationGoal::gaveUpOnSubstitution()
             auto resolvedDrv = *resolvedDrvGoal->drv;
             auto & resolvedResult = resolvedDrvGoal->buildResult;
 
+            /* Early cut-off: the resolved derivation's outputs were
+               already realised (an input rebuilt to the same output
+               hash), so this rebuild was skipped entirely. Make that
+               visible, since it's the payoff of ca-derivations. */
+            if (resolvedResult.status == BuildResult::AlreadyValid)
+                printMsg(lvlInfo, "early cut-off: '%s' resolved to already-built '%s'",
+                    worker.store.printStorePath(drvPath),
+                    worker.store.printStorePath(resolvedDrvGoal->drvPath));
+
             SingleDrvOutputs builtOutputs;
 
             if (resolvedResult.success()) {
@@ -1262,7 +1279,7 @@ Path DerivationGoal::openLogFile()
     createDirs(dir);
 
     Path logFileName = fmt("%s/%s%s", dir, baseName.substr(2),
-        settings.compressLog ? ".bz2" : "");
+        settings.compressLog ? (settings.logCompression.get() == "zstd" ? ".zst" : ".bz2") : "");
 
     fdLogFile = toDescriptor(open(logFileName.c_str(), O_CREAT | O_WRONLY | O_TRUNC
 #ifndef _WIN32
@@ -1274,7 +1291,8 @@ Path DerivationGoal::openLogFile()
     logFileSink = std::make_shared<FdSink>(fdLogFile.get());
 
     if (settings.compressLog)
-        logSink = std::shared_ptr<CompressionSink>(makeCompressionSink("bzip2", *logFileSink));
+        logSink = std::shared_ptr<CompressionSink>(makeCompressionSink(
+            settings.logCompression.get() == "zstd" ? "zstd" : "bzip2", *logFileSink));
     else
         logSink = logFileSink;
 
@@ -1541,8 +1559,13 @@ Goal::Done DerivationGoal::done(
         auto wantedBuiltOutputs = filterDrvOutputs(wantedOutputs, std::move(builtOutputs));
         assert(!wantedBuiltOutputs.empty());
         buildResult.builtOutputs = std::move(wantedBuiltOutputs);
-        if (status == BuildResult::Built)
+        if (status == BuildResult::Built) {
             worker.doneBuilds++;
+            if (buildResult.stopTime >= buildResult.startTime && buildResult.startTime) {
+                worker.recordBuildTime(drvPath, buildResult.stopTime - buildResult.startTime);
+                worker.recordBuildMetrics(drvPath, buildResult);
+            }
+        }
     } else {
         if (status != BuildResult::DependencyFailed)
             worker.failedBuilds++;
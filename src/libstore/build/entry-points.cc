@@ -5,13 +5,76 @@
 #endif
 #include "nix/store/local-store.hh"
 #include "nix/util/strings.hh"
+#include "nix/util/util.hh"
+#include "nix/util/finally.hh"
+#include "nix/store/derivations.hh"
+#include "nix/store/globals.hh"
+
+#include <thread>
 
 namespace nix {
 
+/* Speculatively query the substituters for every output path
+   reachable from the requested derivations, in one batched wave, so
+   that narinfo latency overlaps with goal scheduling instead of
+   trickling out in dependency order as DerivationGoals discover
+   their outputs. The results land in the substituters' caches; any
+   errors are ignored here and will resurface (if real) on the
+   actual queries. */
+static std::thread prefetchSubstitutablePaths(
+    Store & store, Store & evalStore, const std::vector<DerivedPath> & reqs)
+{
+    return std::thread([&store, &evalStore, reqs]() {
+        try {
+            StorePathCAMap paths;
+            StorePathSet seenDrvs;
+
+            std::function<void(const StorePath &)> visitDrv = [&](const StorePath & drvPath) {
+                if (!drvPath.isDerivation() || !seenDrvs.insert(drvPath).second) return;
+                Derivation drv;
+                try {
+                    drv = evalStore.readDerivation(drvPath);
+                } catch (Error &) {
+                    return;
+                }
+                for (auto & [_, outAndPath] : drv.outputsAndOptPaths(store))
+                    if (outAndPath.second)
+                        paths.insert_or_assign(*outAndPath.second, std::nullopt);
+                for (auto & [inputDrv, _] : drv.inputDrvs.map)
+                    visitDrv(inputDrv);
+            };
+
+            for (auto & req : reqs)
+                std::visit(overloaded {
+                    [&](const DerivedPath::Opaque & o) {
+                        paths.insert_or_assign(o.path, std::nullopt);
+                    },
+                    [&](const DerivedPath::Built & b) {
+                        visitDrv(b.drvPath->getBaseStorePath());
+                    },
+                }, req.raw());
+
+            if (paths.empty()) return;
+
+            SubstitutablePathInfos infos;
+            store.querySubstitutablePathInfos(paths, infos);
+        } catch (...) {
+            ignoreExceptionExceptInterrupt();
+        }
+    });
+}
+
 void Store::buildPaths(const std::vector<DerivedPath> & reqs, BuildMode buildMode, std::shared_ptr<Store> evalStore)
 {
     Worker worker(*this, evalStore ? *evalStore : *this);
 
+    std::thread prefetcher;
+    if (settings.useSubstitutes && buildMode == bmNormal)
+        prefetcher = prefetchSubstitutablePaths(*this, evalStore ? *evalStore : *this, reqs);
+    Finally joinPrefetcher([&]() {
+        if (prefetcher.joinable()) prefetcher.join();
+    });
+
     Goals goals;
     for (auto & br : reqs)
         goals.insert(worker.makeGoal(br, buildMode));
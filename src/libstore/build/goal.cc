@@ -1,5 +1,16 @@
 #include "nix/store/build/goal.hh"
 #include "nix/store/build/worker.hh"
+#include "nix/util/environment-variables.hh"
+#include "nix/util/sync.hh"
+
+#include <chrono>
+#include <fstream>
+
+#include <nlohmann/json.hpp>
+
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
 
 namespace nix {
 
@@ -202,9 +213,82 @@ Goal::Done Goal::amDone(ExitCode result, std::optional<Error> ex)
 }
 
 
+/* Writes goal state transitions in the Chrome trace-event format
+   when NIX_GOAL_TRACE is set to a file name. Every transition that
+   goes through Goal::trace() is emitted as an instant event with a
+   microsecond timestamp, with one trace "thread" per goal, so the
+   result can be loaded into chrome://tracing / Perfetto for
+   post-hoc critical-path analysis of big builds. */
+class GoalTracer
+{
+    struct State
+    {
+        std::ofstream out;
+        std::map<std::string, unsigned int, std::less<>> goalIds;
+    };
+
+    Sync<State> state_;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+public:
+
+    GoalTracer(const Path & path)
+    {
+        auto state(state_.lock());
+        state->out.open(path);
+        /* A JSON array that is never closed; the trace viewers
+           accept that, and it keeps emission append-only. */
+        state->out << "[\n";
+    }
+
+    void emit(std::string_view goalName, std::string_view event)
+    {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        auto state(state_.lock());
+
+        auto i = state->goalIds.find(goalName);
+        if (i == state->goalIds.end()) {
+            i = state->goalIds.emplace(std::string(goalName), state->goalIds.size() + 1).first;
+            /* Name the per-goal "thread" after the goal. */
+            state->out << nlohmann::json({
+                {"name", "thread_name"},
+                {"ph", "M"},
+                {"pid", 1},
+                {"tid", i->second},
+                {"args", {{"name", goalName}}},
+            }).dump() << ",\n";
+        }
+
+        state->out << nlohmann::json({
+            {"name", event},
+            {"cat", "goal"},
+            {"ph", "i"},
+            {"s", "t"},
+            {"ts", us},
+            {"pid", 1},
+            {"tid", i->second},
+        }).dump() << ",\n";
+    }
+};
+
+static GoalTracer * goalTracer()
+{
+    static auto tracer = []() -> std::unique_ptr<GoalTracer> {
+        if (auto path = getEnv("NIX_GOAL_TRACE"))
+            return std::make_unique<GoalTracer>(*path);
+        return nullptr;
+    }();
+    return tracer.get();
+}
+
 void Goal::trace(std::string_view s)
 {
     debug("%1%: %2%", name, s);
+    if (auto t = goalTracer()) [[unlikely]]
+        t->emit(name, s);
 }
 
 void Goal::work()
@@ -4,6 +4,7 @@
 #include "nix/store/nar-info.hh"
 #include "nix/util/finally.hh"
 #include "nix/util/signals.hh"
+#include <atomic>
 #include <coroutine>
 
 namespace nix {
@@ -58,31 +59,116 @@ Goal::Co PathSubstitutionGoal::init()
 
     bool substituterFailed = false;
 
-    for (const auto & sub : subs) {
-        trace("trying next substituter");
-
-        cleanup();
-
-        /* The path the substituter refers to the path as. This will be
-         * different when the stores have different names. */
+    /* Query all applicable substituters in parallel (on helper
+       threads, sharing one wake-up pipe and one substitution slot),
+       so a slow cache early in the configured order doesn't make
+       every path wait out its latency. The results are consumed in
+       configured priority order below. */
+    struct SubQuery
+    {
+        ref<Store> sub;
         std::optional<StorePath> subPath;
-
-        /* Path info returned by the substituter's query info operation. */
+        bool applicable = true;
         std::shared_ptr<const ValidPathInfo> info;
+        std::exception_ptr exc;
+    };
+
+    std::vector<SubQuery> queries;
 
+    for (const auto & sub : subs) {
+        SubQuery q { .sub = sub };
         if (ca) {
-            subPath = sub->makeFixedOutputPathFromCA(
+            q.subPath = sub->makeFixedOutputPathFromCA(
                 std::string { storePath.name() },
                 ContentAddressWithReferences::withoutRefs(*ca));
             if (sub->storeDir == worker.store.storeDir)
-                assert(subPath == storePath);
-        } else if (sub->storeDir != worker.store.storeDir) {
-            continue;
+                assert(q.subPath == storePath);
+        } else if (sub->storeDir != worker.store.storeDir)
+            q.applicable = false;
+        queries.push_back(std::move(q));
+    }
+
+    if (!queries.empty()) {
+        /* Queries share a single substitution slot. */
+        while (worker.getNrSubstitutions() >= std::max(1U, (unsigned int) settings.maxSubstitutionJobs)) {
+            co_await waitForBuildSlot();
+        }
+
+#ifndef _WIN32
+        outPipe.create();
+#else
+        outPipe.createAsyncPipe(worker.ioport.get());
+#endif
+
+        std::vector<std::thread> queryThreads;
+
+        /* If this goal is destroyed while suspended, make sure the
+           query threads are joined before their result slots go
+           away. */
+        Finally joinQueryThreads([&]() {
+            for (auto & t : queryThreads)
+                if (t.joinable()) t.join();
+        });
+
+        {
+            auto pending = std::make_shared<std::atomic<size_t>>(0);
+            for (auto & q : queries)
+                if (q.applicable)
+                    ++*pending;
+
+            for (auto & q : queries) {
+                if (!q.applicable) continue;
+                queryThreads.emplace_back([this, &q, pending]() {
+                    ReceiveInterrupts receiveInterrupts;
+                    try {
+                        q.info = q.sub->queryPathInfo(q.subPath ? *q.subPath : storePath);
+                    } catch (...) {
+                        q.exc = std::current_exception();
+                    }
+                    /* Wake up the worker loop when the last query is
+                       done. */
+                    if (--*pending == 0)
+                        outPipe.writeSide.close();
+                });
+            }
         }
 
+        if (!queryThreads.empty()) {
+            worker.childStarted(shared_from_this(), {
+#ifndef _WIN32
+                outPipe.readSide.get()
+#else
+                &outPipe
+#endif
+            }, true, false);
+
+            co_await Suspend{};
+
+            trace("substituter queries finished");
+
+            for (auto & t : queryThreads)
+                t.join();
+            worker.childTerminated(this);
+        } else
+            outPipe.close();
+    }
+
+    for (auto & q : queries) {
+        trace("trying next substituter");
+
+        cleanup();
+
+        if (!q.applicable) continue;
+
+        const auto & sub = q.sub;
+        const auto & subPath = q.subPath;
+
+        /* Path info returned by the substituter's query info operation. */
+        std::shared_ptr<const ValidPathInfo> info;
+
         try {
-            // FIXME: make async
-            info = sub->queryPathInfo(subPath ? *subPath : storePath);
+            if (q.exc) std::rethrow_exception(q.exc);
+            info = q.info;
         } catch (InvalidPath &) {
             continue;
         } catch (SubstituterDisabled & e) {
@@ -1,4 +1,8 @@
 #include "nix/store/local-store.hh"
+
+#include <fstream>
+
+#include <nlohmann/json.hpp>
 #include "nix/store/machines.hh"
 #include "nix/store/build/worker.hh"
 #include "nix/store/build/substitution-goal.hh"
@@ -8,6 +12,9 @@
 #  include "nix/store/build/hook-instance.hh"
 #endif
 #include "nix/util/signals.hh"
+#include "nix/util/file-system.hh"
+
+#include <cstdlib>
 
 namespace nix {
 
@@ -116,7 +123,7 @@ GoalPtr Worker::makeGoal(const DerivedPath & req, BuildMode buildMode)
 
 
 template<typename K, typename G>
-static void removeGoal(std::shared_ptr<G> goal, std::map<K, std::weak_ptr<G>> & goalMap)
+static void removeGoal(std::shared_ptr<G> goal, std::unordered_map<K, std::weak_ptr<G>> & goalMap)
 {
     /* !!! inefficient */
     for (auto i = goalMap.begin();
@@ -241,11 +248,57 @@ void Worker::childTerminated(Goal * goal, bool wakeSleepers)
 }
 
 
+#ifdef __linux__
+/* Return the `some avg10` figure (percent) from a PSI file, or
+   nothing if unavailable (old kernel, no CONFIG_PSI). */
+static std::optional<double> readPressureAvg10(const char * path)
+{
+    try {
+        auto contents = readFile(path);
+        auto pos = contents.find("avg10=");
+        if (pos == std::string::npos) return std::nullopt;
+        return strtod(contents.c_str() + pos + 6, nullptr);
+    } catch (SystemError &) {
+        return std::nullopt;
+    }
+}
+#endif
+
+bool Worker::hasLocalBuildCapacity()
+{
+    if (getNrLocalBuilds() >= settings.maxBuildJobs)
+        return false;
+
+    if (!settings.autoBuildJobs)
+        return true;
+
+    /* Always admit one build, so high external load cannot stall us
+       entirely, and so that held goals are re-examined whenever a
+       child terminates. */
+    if (getNrLocalBuilds() == 0)
+        return true;
+
+#ifdef __linux__
+    if (auto cpu = readPressureAvg10("/proc/pressure/cpu"))
+        if (*cpu >= settings.buildCpuPressureLimit) {
+            debug("holding back builds: CPU pressure %.2f%%", *cpu);
+            return false;
+        }
+    if (auto mem = readPressureAvg10("/proc/pressure/memory"))
+        if (*mem >= settings.buildMemPressureLimit) {
+            debug("holding back builds: memory pressure %.2f%%", *mem);
+            return false;
+        }
+#endif
+
+    return true;
+}
+
 void Worker::waitForBuildSlot(GoalPtr goal)
 {
     goal->trace("wait for build slot");
     bool isSubstitutionGoal = goal->jobCategory() == JobCategory::Substitution;
-    if ((!isSubstitutionGoal && getNrLocalBuilds() < settings.maxBuildJobs) ||
+    if ((!isSubstitutionGoal && hasLocalBuildCapacity()) ||
         (isSubstitutionGoal && getNrSubstitutions() < settings.maxSubstitutionJobs))
         wakeUp(goal); /* we can do it right away */
     else
@@ -267,6 +320,68 @@ void Worker::waitForAWhile(GoalPtr goal)
 }
 
 
+static Path buildTimesFile()
+{
+    return settings.nixStateDir + "/build-times";
+}
+
+uint64_t Worker::getExpectedBuildTime(const StorePath & drvPath)
+{
+    if (!buildTimes) {
+        buildTimes.emplace();
+        try {
+            if (pathExists(buildTimesFile()))
+                for (auto & line : tokenizeString<Strings>(readFile(buildTimesFile()), "\n")) {
+                    auto sep = line.rfind(' ');
+                    if (sep == std::string::npos) continue;
+                    if (auto seconds = string2Int<uint64_t>(line.substr(sep + 1)))
+                        buildTimes->insert_or_assign(line.substr(0, sep), *seconds);
+                }
+        } catch (Error &) {
+            ignoreExceptionExceptInterrupt();
+        }
+    }
+
+    auto i = buildTimes->find(std::string(drvPath.name()));
+    /* Unknown derivations get a middling default, so they neither
+       starve nor get starved by builds with known durations. */
+    return i != buildTimes->end() ? i->second : 60;
+}
+
+void Worker::recordBuildTime(const StorePath & drvPath, uint64_t seconds)
+{
+    try {
+        if (buildTimes)
+            buildTimes->insert_or_assign(std::string(drvPath.name()), seconds);
+        std::ofstream fs(buildTimesFile(), std::ios_base::app);
+        fs << drvPath.name() << ' ' << seconds << '\n';
+    } catch (...) {
+        ignoreExceptionExceptInterrupt();
+    }
+}
+
+void Worker::recordBuildMetrics(const StorePath & drvPath, const BuildResult & result)
+{
+    try {
+        nlohmann::json record = {
+            {"drvPath", store.printStorePath(drvPath)},
+            {"name", drvPath.name()},
+            {"startTime", result.startTime},
+            {"stopTime", result.stopTime},
+            {"duration", result.stopTime - result.startTime},
+        };
+        if (result.cpuUser)
+            record["cpuUserMs"] = result.cpuUser->count() / 1000;
+        if (result.cpuSystem)
+            record["cpuSystemMs"] = result.cpuSystem->count() / 1000;
+
+        std::ofstream fs(settings.nixStateDir + "/build-metrics", std::ios_base::app);
+        fs << record.dump() << '\n';
+    } catch (...) {
+        ignoreExceptionExceptInterrupt();
+    }
+}
+
 void Worker::run(const Goals & _topGoals)
 {
     std::vector<nix::DerivedPath> topPaths;
@@ -13,6 +13,11 @@ create table if not exists Realisations (
 
 create index if not exists IndexRealisations on Realisations(drvPath, outputName);
 
+-- Used by reverse lookups (output path -> realisations), notably the
+-- self-reference cleanup trigger below, which otherwise scans the
+-- whole table per deleted path.
+create index if not exists IndexRealisationsOutputPath on Realisations(outputPath);
+
 -- We can end-up in a weird edge-case where a path depends on itself because
 -- it’s an output of a CA derivation, that happens to be the same as one of its
 -- dependencies.
@@ -22,6 +22,8 @@
 
 #include <sstream>
 
+#include <nlohmann/json.hpp>
+
 namespace nix::daemon {
 
 Sink & operator << (Sink & sink, const Logger::Fields & fields)
@@ -834,6 +836,19 @@ static void performOp(TunnelLogger * logger, ref<Store> store,
         break;
     }
 
+    case WorkerProto::Op::QueryPathInfos: {
+        auto paths = WorkerProto::Serialise<StorePathSet>::read(*store, rconn);
+        logger->startWork();
+        auto infos = store->queryPathInfos(paths);
+        logger->stopWork();
+        conn.to << infos.size();
+        for (auto & [path, info] : infos) {
+            conn.to << store->printStorePath(path);
+            WorkerProto::write(*store, wconn, static_cast<const UnkeyedValidPathInfo &>(*info));
+        }
+        break;
+    }
+
     case WorkerProto::Op::QueryPathInfo: {
         auto path = store->parseStorePath(readString(conn.from));
         std::shared_ptr<const ValidPathInfo> info;
@@ -973,6 +988,35 @@ static void performOp(TunnelLogger * logger, ref<Store> store,
         break;
     }
 
+    case WorkerProto::Op::Ping: {
+        logger->startWork();
+        logger->stopWork();
+        conn.to << 1;
+        break;
+    }
+
+    case WorkerProto::Op::QueryMemoryStats: {
+        logger->startWork();
+        auto stats = store->memoryStats();
+        logger->stopWork();
+        conn.to << stats.dump();
+        break;
+    }
+
+    case WorkerProto::Op::QueryRealisations: {
+        std::set<DrvOutput> ids;
+        auto count = readNum<uint64_t>(conn.from);
+        while (count--)
+            ids.insert(DrvOutput::parse(readString(conn.from)));
+        logger->startWork();
+        auto realisations = store->queryRealisations(ids);
+        logger->stopWork();
+        conn.to << realisations.size();
+        for (auto & [_, realisation] : realisations)
+            WorkerProto::write(*store, wconn, realisation);
+        break;
+    }
+
     case WorkerProto::Op::QueryRealisation: {
         logger->startWork();
         auto outputId = DrvOutput::parse(readString(conn.from));
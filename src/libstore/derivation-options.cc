@@ -3,6 +3,7 @@
 #include "nix/store/parsed-derivations.hh"
 #include "nix/store/derivations.hh"
 #include "nix/store/store-api.hh"
+#include "nix/util/sync.hh"
 #include "nix/util/types.hh"
 #include "nix/util/util.hh"
 
@@ -244,6 +245,60 @@ DerivationOptions::fromStructuredAttrs(const StringMap & env, const StructuredAt
     };
 }
 
+std::shared_ptr<const DerivationOptions>
+DerivationOptions::fromStructuredAttrsShared(const StringMap & env, const StructuredAttrs * parsed, bool shouldWarn)
+{
+    /* The environment variables the legacy parser above consults.
+       Keep in sync with `fromStructuredAttrs`: a key missing here
+       makes distinct derivations share a memo entry. */
+    static const char * consultedEnvVars[] = {
+        "allowedReferences",
+        "disallowedReferences",
+        "allowedRequisites",
+        "disallowedRequisites",
+        "passAsFile",
+        "exportReferencesGraph",
+        "__sandboxProfile",
+        "__noChroot",
+        "__impureHostDeps",
+        "impureEnvVars",
+        "__darwinAllowLocalNetworking",
+        "requiredSystemFeatures",
+        "preferLocalBuild",
+        "allowSubstitutes",
+    };
+
+    /* With structured attributes any part of the JSON can matter
+       (outputChecks etc.), so a key would cost as much as the parse;
+       only the legacy encoding is memoized. */
+    if (parsed)
+        return std::make_shared<const DerivationOptions>(fromStructuredAttrs(env, parsed, shouldWarn));
+
+    /* Length-prefixed values, so a value containing the separator
+       cannot alias a neighbouring slot. */
+    std::string key;
+    for (auto & name : consultedEnvVars) {
+        if (auto i = env.find(name); i != env.end()) {
+            key.append(std::to_string(i->second.size()));
+            key.push_back(':');
+            key.append(i->second);
+        } else
+            key.push_back('-');
+    }
+
+    static Sync<std::map<std::string, std::shared_ptr<const DerivationOptions>>> cache_;
+
+    {
+        auto cache(cache_.lock());
+        if (auto i = cache->find(key); i != cache->end())
+            return i->second;
+    }
+
+    auto res = std::make_shared<const DerivationOptions>(fromStructuredAttrs(env, parsed, shouldWarn));
+    cache_.lock()->emplace(std::move(key), res);
+    return res;
+}
+
 StringSet DerivationOptions::getRequiredSystemFeatures(const BasicDerivation & drv) const
 {
     // FIXME: cache this?
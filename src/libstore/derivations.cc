@@ -264,8 +264,10 @@ static StringSet parseStrings(StringViewStream & str, bool arePaths)
 {
     StringSet res;
     expect(str, "[");
+    /* Serialised lists are sorted, so inserting at the end is O(1)
+       amortised instead of O(log n). */
     while (!endOfList(str))
-        res.insert((arePaths ? parsePath(str) : parseString(str)).toOwned());
+        res.insert(res.end(), (arePaths ? parsePath(str) : parseString(str)).toOwned());
     return res;
 }
 
@@ -425,12 +427,17 @@ Derivation parseDerivation(
         throw Error("derivation does not start with 'Derive' or 'DrvWithVersion'");
     }
 
+    /* Note: derivations are printed from sorted maps, so the lists
+       parsed below arrive in order and the end-of-map insertion
+       hints make each insertion O(1) amortised instead of O(log n).
+       Unsorted input stays correct, just slower. */
+
     /* Parse the list of outputs. */
     expect(str, "[");
     while (!endOfList(str)) {
         expect(str, "("); std::string id = parseString(str).toOwned();
         auto output = parseDerivationOutput(store, str, xpSettings);
-        drv.outputs.emplace(std::move(id), std::move(output));
+        drv.outputs.emplace_hint(drv.outputs.end(), std::move(id), std::move(output));
     }
 
     /* Parse the list of input derivations. */
@@ -439,7 +446,8 @@ Derivation parseDerivation(
         expect(str, "(");
         auto drvPath = parsePath(str);
         expect(str, ",");
-        drv.inputDrvs.map.insert_or_assign(store.parseStorePath(*drvPath), parseDerivedPathMapNode(store, str, version));
+        drv.inputDrvs.map.insert_or_assign(drv.inputDrvs.map.end(),
+            store.parseStorePath(*drvPath), parseDerivedPathMapNode(store, str, version));
         expect(str, ")");
     }
 
@@ -458,7 +466,7 @@ Derivation parseDerivation(
         expect(str, "("); auto name = parseString(str).toOwned();
         expect(str, ","); auto value = parseString(str).toOwned();
         expect(str, ")");
-        drv.env.insert_or_assign(std::move(name), std::move(value));
+        drv.env.insert_or_assign(drv.env.end(), std::move(name), std::move(value));
     }
 
     expect(str, ")");
@@ -477,6 +485,18 @@ Derivation parseDerivation(
  */
 static void printString(std::string & res, std::string_view s)
 {
+    /* Fast path: most strings (store paths, flags) need no
+       escaping, and the vectorized scan is much cheaper than the
+       byte-wise copy loop below. Unparsing runs twice per
+       derivation (once masked for hashing), so this is hot in
+       derivation-heavy evaluations. */
+    if (s.find_first_of("\"\\\n\r\t") == std::string_view::npos) {
+        res += '"';
+        res += s;
+        res += '"';
+        return;
+    }
+
     boost::container::small_vector<char, 64 * 1024> buffer;
     buffer.reserve(s.size() * 2 + 2);
     char * buf = buffer.data();
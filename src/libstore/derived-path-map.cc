@@ -3,49 +3,59 @@
 
 namespace nix {
 
+/* Note: plain recursive visitors, rather than recursive lambdas
+   through std::function, so that goal-graph construction doesn't
+   allocate a closure per lookup. */
+
 template<typename V>
 typename DerivedPathMap<V>::ChildNode & DerivedPathMap<V>::ensureSlot(const SingleDerivedPath & k)
 {
-    std::function<ChildNode &(const SingleDerivedPath & )> initIter;
-    initIter = [&](const auto & k) -> auto & {
-        return std::visit(overloaded {
-            [&](const SingleDerivedPath::Opaque & bo) -> auto & {
-                // will not overwrite if already there
-                return map[bo.path];
-            },
-            [&](const SingleDerivedPath::Built & bfd) -> auto & {
-                auto & n = initIter(*bfd.drvPath);
-                return n.childMap[bfd.output];
-            },
-        }, k.raw());
+    struct Visitor
+    {
+        DerivedPathMap & self;
+
+        ChildNode & operator () (const SingleDerivedPath::Opaque & bo)
+        {
+            // will not overwrite if already there
+            return self.map[bo.path];
+        }
+
+        ChildNode & operator () (const SingleDerivedPath::Built & bfd)
+        {
+            auto & n = std::visit(*this, bfd.drvPath->raw());
+            return n.childMap[bfd.output];
+        }
     };
-    return initIter(k);
+    return std::visit(Visitor{*this}, k.raw());
 }
 
 template<typename V>
 typename DerivedPathMap<V>::ChildNode * DerivedPathMap<V>::findSlot(const SingleDerivedPath & k)
 {
-    std::function<ChildNode *(const SingleDerivedPath & )> initIter;
-    initIter = [&](const auto & k) {
-        return std::visit(overloaded {
-            [&](const SingleDerivedPath::Opaque & bo) {
-                auto it = map.find(bo.path);
-                return it != map.end()
-                    ? &it->second
-                    : nullptr;
-            },
-            [&](const SingleDerivedPath::Built & bfd) {
-                auto * n = initIter(*bfd.drvPath);
-                if (!n) return (ChildNode *)nullptr;
-
-                auto it = n->childMap.find(bfd.output);
-                return it != n->childMap.end()
-                    ? &it->second
-                    : nullptr;
-            },
-        }, k.raw());
+    struct Visitor
+    {
+        DerivedPathMap & self;
+
+        ChildNode * operator () (const SingleDerivedPath::Opaque & bo)
+        {
+            auto it = self.map.find(bo.path);
+            return it != self.map.end()
+                ? &it->second
+                : nullptr;
+        }
+
+        ChildNode * operator () (const SingleDerivedPath::Built & bfd)
+        {
+            auto * n = std::visit(*this, bfd.drvPath->raw());
+            if (!n) return nullptr;
+
+            auto it = n->childMap.find(bfd.output);
+            return it != n->childMap.end()
+                ? &it->second
+                : nullptr;
+        }
     };
-    return initIter(k);
+    return std::visit(Visitor{*this}, k.raw());
 }
 
 }
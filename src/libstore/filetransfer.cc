@@ -24,6 +24,7 @@
 
 #include <cmath>
 #include <cstring>
+#include <deque>
 #include <queue>
 #include <random>
 #include <thread>
@@ -214,6 +215,9 @@ struct curlFileTransfer : public FileTransfer
                 result.etag = "";
                 result.data.clear();
                 result.bodySize = 0;
+                result.acceptRanges = false;
+                result.contentLength.reset();
+                result.contentEncoding = "";
                 statusMsg = trim(match.str(1));
                 acceptRanges = false;
                 encoding = "";
@@ -239,11 +243,20 @@ struct curlFileTransfer : public FileTransfer
                         }
                     }
 
-                    else if (name == "content-encoding")
+                    else if (name == "content-encoding") {
                         encoding = trim(line.substr(i + 1));
+                        result.contentEncoding = encoding;
+                    }
+
+                    else if (name == "content-length") {
+                        if (auto length = string2Int<uint64_t>(trim(line.substr(i + 1))))
+                            result.contentLength = *length;
+                    }
 
-                    else if (name == "accept-ranges" && toLower(trim(line.substr(i + 1))) == "bytes")
+                    else if (name == "accept-ranges" && toLower(trim(line.substr(i + 1))) == "bytes") {
                         acceptRanges = true;
+                        result.acceptRanges = true;
+                    }
 
                     else if (name == "link" || name == "x-amz-meta-link") {
                         auto value = trim(line.substr(i + 1));
@@ -593,6 +606,10 @@ struct curlFileTransfer : public FileTransfer
         #if LIBCURL_VERSION_NUM >= 0x072b00 // Multiplex requires >= 7.43.0
         curl_multi_setopt(curlm, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
         #endif
+        #if LIBCURL_VERSION_NUM >= 0x074300 // Max concurrent streams requires >= 7.67.0
+        curl_multi_setopt(curlm, CURLMOPT_MAX_CONCURRENT_STREAMS,
+            (long) fileTransferSettings.http2MaxConcurrentStreams.get());
+        #endif
         #if LIBCURL_VERSION_NUM >= 0x071e00 // Max connections requires >= 7.30.0
         curl_multi_setopt(curlm, CURLMOPT_MAX_TOTAL_CONNECTIONS,
             fileTransferSettings.httpConnections.get());
@@ -867,11 +884,94 @@ FileTransferResult FileTransfer::upload(const FileTransferRequest & request)
     return enqueueFileTransfer(request).get();
 }
 
+/* Try to perform a download as multiple concurrent ranged requests
+   (see the `http-max-segments` setting). Returns false if segmented
+   downloading is disabled or not applicable to this request, in
+   which case the caller falls back to a regular download. */
+static bool trySegmentedDownload(
+    FileTransfer & fileTransfer,
+    const FileTransferRequest & request,
+    Sink & sink,
+    std::function<void(FileTransferResult)> & resultCallback)
+{
+    auto maxSegments = fileTransferSettings.httpMaxSegments.get();
+    uint64_t segmentSize = fileTransferSettings.httpSegmentSize.get();
+    if (maxSegments <= 1 || segmentSize == 0) return false;
+    if (request.head || request.post || request.data || request.dataCallback) return false;
+    if (!hasPrefix(request.uri, "http://") && !hasPrefix(request.uri, "https://")) return false;
+
+    /* Probe the server for the content length and range support. */
+    FileTransferResult probe;
+    try {
+        auto probeRequest = request;
+        probeRequest.head = true;
+        probe = fileTransfer.enqueueFileTransfer(probeRequest).get();
+    } catch (FileTransferError &) {
+        /* E.g. a server that doesn't implement HEAD. */
+        return false;
+    }
+
+    /* Ranged requests on compressed responses are not worth the
+       trouble: the content length refers to the compressed body,
+       which curl transparently decompresses per response. */
+    if (!probe.acceptRanges
+        || !probe.contentLength
+        || !probe.contentEncoding.empty()
+        || *probe.contentLength <= 2 * segmentSize)
+        return false;
+
+    auto total = *probe.contentLength;
+
+    debug("downloading '%s' (%d bytes) in %d-byte segments over %d connections",
+        request.uri, total, segmentSize, maxSegments);
+
+    if (resultCallback) {
+        probe.bodySize = total;
+        resultCallback(std::move(probe));
+    }
+
+    /* Keep up to maxSegments ranged requests in flight, delivering
+       the results to the sink in order. */
+    std::deque<std::pair<uint64_t, std::future<FileTransferResult>>> inFlight;
+
+    uint64_t nextOffset = 0;
+
+    auto spawnNext = [&]() {
+        if (nextOffset >= total) return;
+        auto end = std::min(total, nextOffset + segmentSize);
+        auto segmentRequest = request;
+        segmentRequest.headers.emplace_back("Range", fmt("bytes=%d-%d", nextOffset, end - 1));
+        inFlight.emplace_back(end - nextOffset, fileTransfer.enqueueFileTransfer(segmentRequest));
+        nextOffset = end;
+    };
+
+    while (inFlight.size() < maxSegments && nextOffset < total)
+        spawnNext();
+
+    while (!inFlight.empty()) {
+        checkInterrupt();
+        auto segment = std::move(inFlight.front());
+        inFlight.pop_front();
+        auto result = segment.second.get();
+        spawnNext();
+        if (result.data.size() != segment.first)
+            throw FileTransferError(FileTransfer::Misc, {},
+                "expected %d bytes for ranged request of '%s' but got %d; the server may not support byte ranges",
+                segment.first, request.uri, result.data.size());
+        sink(result.data);
+    }
+
+    return true;
+}
+
 void FileTransfer::download(
     FileTransferRequest && request,
     Sink & sink,
     std::function<void(FileTransferResult)> resultCallback)
 {
+    if (trySegmentedDownload(*this, request, sink, resultCallback))
+        return;
+
     /* Note: we can't call 'sink' via request.dataCallback, because
        that would cause the sink to execute on the fileTransfer
        thread. If 'sink' is a coroutine, this will fail. Also, if the
@@ -5,6 +5,7 @@
 #include "nix/util/unix-domain-socket.hh"
 #include "nix/util/signals.hh"
 #include "nix/store/posix-fs-canonicalise.hh"
+#include "nix/util/thread-pool.hh"
 
 #include "store-config-private.hh"
 
@@ -21,6 +22,8 @@
 #include <random>
 
 #include <climits>
+#include <limits>
+#include <cstdio>
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -88,6 +91,11 @@ void LocalStore::addTempRoot(const StorePath & path)
       return;
     }
 
+    /* Already in our temp roots file, where any future collector
+       will see it; nothing more to do. */
+    if (tempRootsAdded.lock()->count(path))
+        return;
+
     createTempRootsFile();
 
     /* Open/create the global GC lock file. */
@@ -155,6 +163,8 @@ void LocalStore::addTempRoot(const StorePath & path)
        seen by a future run of the garbage collector. */
     auto s = printStorePath(path) + '\0';
     writeFull(_fdTempRoots.lock()->get(), s);
+
+    tempRootsAdded.lock()->insert(path);
 }
 
 
@@ -631,6 +641,24 @@ void LocalStore::collectGarbage(const GCOptions & options, GCResults & results)
     if (auto p = getEnv("_NIX_TEST_GC_SYNC_2"))
         readFile(*p);
 
+    /* When the store supports it, dead paths are renamed into a
+       trash directory (so their store locations become free
+       immediately) and deleted there by a pool of deleter threads,
+       parallelising the unlink storm. Stores with layer-aware
+       deletion keep the synchronous path. */
+    Path trashDir = config->realStoreDir + "/trash";
+    /* With a bounded max-freed, deletion must stay synchronous so
+       that the bytes-freed check doesn't race ahead of the actual
+       deletions and overshoot the limit. */
+    bool asyncDelete = shouldDelete && canDeleteAsync()
+        && options.maxFreed == std::numeric_limits<uint64_t>::max();
+    ThreadPool deleterPool;
+    std::atomic<uint64_t> bytesFreedTotal{0};
+
+    if (asyncDelete)
+        /* Clean up after a possible earlier crashed collection. */
+        deletePath(trashDir);
+
     /* Helper function that deletes a path from the store and throws
        GCLimitReached if we've deleted enough garbage. */
     auto deleteFromStore = [&](std::string_view baseName)
@@ -653,12 +681,29 @@ void LocalStore::collectGarbage(const GCOptions & options, GCResults & results)
 
         results.paths.insert(path);
 
-        uint64_t bytesFreed;
-        deleteStorePath(realPath, bytesFreed);
+        bool deleted = false;
+
+        if (asyncDelete) {
+            createDirs(trashDir);
+            Path trashPath = trashDir + "/" + std::string(baseName);
+            if (rename(realPath.c_str(), trashPath.c_str()) == 0) {
+                deleterPool.enqueue([trashPath, &bytesFreedTotal]() {
+                    uint64_t bytesFreed = 0;
+                    deletePath(trashPath, bytesFreed);
+                    bytesFreedTotal += bytesFreed;
+                });
+                deleted = true;
+            } else
+                debug("cannot move '%s' to '%s', deleting in place", realPath, trashPath);
+        }
 
-        results.bytesFreed += bytesFreed;
+        if (!deleted) {
+            uint64_t bytesFreed = 0;
+            deleteStorePath(realPath, bytesFreed);
+            bytesFreedTotal += bytesFreed;
+        }
 
-        if (results.bytesFreed > options.maxFreed) {
+        if (bytesFreedTotal > options.maxFreed) {
             printInfo("deleted more than %d bytes; stopping", options.maxFreed);
             throw GCLimitReached();
         }
@@ -817,7 +862,7 @@ void LocalStore::collectGarbage(const GCOptions & options, GCResults & results)
             while (errno = 0, dirent = readdir(dir.get())) {
                 checkInterrupt();
                 std::string name = dirent->d_name;
-                if (name == "." || name == ".." || name == linksName) continue;
+                if (name == "." || name == ".." || name == linksName || name == "trash") continue;
 
                 if (auto storePath = maybeParseStorePath(storeDir + "/" + name))
                     deleteReferrersClosure(*storePath);
@@ -829,6 +874,14 @@ void LocalStore::collectGarbage(const GCOptions & options, GCResults & results)
         }
     }
 
+    /* Wait for the deleter threads to finish and clean up the trash
+       directory before accounting the results. */
+    if (asyncDelete) {
+        deleterPool.process();
+        deletePath(trashDir);
+    }
+    results.bytesFreed += bytesFreedTotal;
+
     if (options.action == GCOptions::gcReturnLive) {
         for (auto & i : alive)
             results.paths.insert(printStorePath(i));
@@ -852,32 +905,37 @@ void LocalStore::collectGarbage(const GCOptions & options, GCResults & results)
         AutoCloseDir dir(opendir(linksDir.c_str()));
         if (!dir) throw SysError("opening directory '%1%'", linksDir);
 
-        int64_t actualSize = 0, unsharedSize = 0;
+        std::atomic<int64_t> actualSize{0}, unsharedSize{0};
+
+        ThreadPool linksPool;
 
         struct dirent * dirent;
         while (errno = 0, dirent = readdir(dir.get())) {
             checkInterrupt();
             std::string name = dirent->d_name;
             if (name == "." || name == "..") continue;
-            Path path = linksDir + "/" + name;
 
-            auto st = lstat(path);
+            linksPool.enqueue([path{linksDir + "/" + name}, &actualSize, &unsharedSize]() {
+                auto st = lstat(path);
 
-            if (st.st_nlink != 1) {
-                actualSize += st.st_size;
-                unsharedSize += (st.st_nlink - 1) * st.st_size;
-                continue;
-            }
+                if (st.st_nlink != 1) {
+                    actualSize += st.st_size;
+                    unsharedSize += (st.st_nlink - 1) * st.st_size;
+                    return;
+                }
 
-            printMsg(lvlTalkative, "deleting unused link '%1%'", path);
+                printMsg(lvlTalkative, "deleting unused link '%1%'", path);
 
-            if (unlink(path.c_str()) == -1)
-                throw SysError("deleting '%1%'", path);
+                if (unlink(path.c_str()) == -1)
+                    throw SysError("deleting '%1%'", path);
 
-            /* Do not account for deleted file here. Rely on deletePath()
-               accounting.  */
+                /* Do not account for deleted file here. Rely on deletePath()
+                   accounting.  */
+            });
         }
 
+        linksPool.process();
+
         struct stat st;
         if (stat(linksDir.c_str(), &st) == -1)
             throw SysError("statting '%1%'", linksDir);
@@ -159,6 +159,31 @@ protected:
 
     }
 
+    bool supportsFileRanges() override
+    { return true; }
+
+    std::string getFileRange(const std::string & path, uint64_t offset, uint64_t length) override
+    {
+        checkEnabled();
+        auto request(makeRequest(path));
+        request.headers.emplace_back("Range", fmt("bytes=%d-%d", offset, offset + length - 1));
+        try {
+            auto data = std::move(getFileTransfer()->download(request).data);
+            /* A server that ignores the Range header returns the
+               whole file (status 200 rather than 206). */
+            if (data.size() > length)
+                data = data.substr(offset, length);
+            if (data.size() != length)
+                throw Error("expected %d bytes from '%s' but got %d", length, path, data.size());
+            return data;
+        } catch (FileTransferError & e) {
+            if (e.error == FileTransfer::NotFound || e.error == FileTransfer::Forbidden)
+                throw NoSuchBinaryCacheFile("file '%s' does not exist in binary cache '%s'", path, getUri());
+            maybeDisable();
+            throw;
+        }
+    }
+
     void getFile(const std::string & path, Sink & sink) override
     {
         checkEnabled();
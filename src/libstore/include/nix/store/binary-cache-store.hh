@@ -7,7 +7,12 @@
 
 #include "nix/util/pool.hh"
 
+#include "nix/util/sync.hh"
+
 #include <atomic>
+#include <fstream>
+
+#include <mutex>
 
 namespace nix {
 
@@ -47,6 +52,25 @@ struct BinaryCacheStoreConfig : virtual StoreConfig
           The meaning and accepted values depend on the compression method selected.
           `-1` specifies that the default compression level should be used.
         )"};
+
+    const Setting<Path> accessLog{this, "", "access-log",
+        R"(
+          If set to a file name, append a JSON line for every
+          narinfo query and NAR download served by this store
+          (operation, path, hit/miss, bytes, milliseconds), for
+          driving cache tiering decisions. Disabled when empty.
+        )"};
+
+    const Setting<bool> chunkedNars{this, false, "chunked-nars",
+        R"(
+          Whether to upload NARs as content-defined chunks stored
+          under `chunks/` by hash, with a per-path manifest under
+          `nar/`, instead of one compressed NAR file. Chunks shared
+          with previously uploaded paths (e.g. earlier versions of
+          the same package) are not re-uploaded. Caches written this
+          way can only be read by Nix versions that understand
+          chunked NARs.
+        )"};
 };
 
 
@@ -96,6 +120,26 @@ public:
      */
     virtual void getFile(const std::string & path, Sink & sink);
 
+    /**
+     * Delete the given file from the binary cache, if supported.
+     */
+    virtual void deleteFile(const std::string & path)
+    { unsupported("deleteFile"); }
+
+    /**
+     * Whether `getFileRange` is supported by this store.
+     */
+    virtual bool supportsFileRanges()
+    { return false; }
+
+    /**
+     * Fetch the byte range [offset, offset + length) of the
+     * specified file. Only usable if `supportsFileRanges` returns
+     * true.
+     */
+    virtual std::string getFileRange(const std::string & path, uint64_t offset, uint64_t length)
+    { unsupported("getFileRange"); }
+
     /**
      * Get the contents of /nix-cache-info. Return std::nullopt if it
      * doesn't exist.
@@ -120,6 +164,25 @@ private:
 
     std::string narMagic;
 
+    /**
+     * Filter of the hash parts available in this cache, published by
+     * the cache as `store-paths.bloom`, loaded on first use. See
+     * `StorePathBloomFilter`.
+     */
+    std::shared_ptr<const struct StorePathBloomFilter> pathFilter;
+
+    std::once_flag pathFilterInit;
+
+    /**
+     * Handle of the access log (see the `access-log` setting).
+     */
+    Sync<std::shared_ptr<std::ofstream>> accessLogFile;
+
+    /**
+     * Append an access record to the access log, if enabled.
+     */
+    void logAccess(std::string_view op, std::string_view key, bool hit, uint64_t bytes, uint64_t durationMs);
+
     std::string narInfoFileFor(const StorePath & storePath);
 
     void writeNarInfo(ref<NarInfo> narInfo);
@@ -74,7 +74,7 @@ struct DerivationGoal : public Goal
     std::unique_ptr<Derivation> drv;
 
     std::unique_ptr<StructuredAttrs> parsedDrv;
-    std::unique_ptr<DerivationOptions> drvOptions;
+    std::shared_ptr<const DerivationOptions> drvOptions;
 
     /**
      * The remainder is state held during the build.
@@ -153,6 +153,11 @@ struct DerivationGoal : public Goal
 
     std::string key() override;
 
+    /**
+     * Cached scheduling-priority prefix of `key()`.
+     */
+    std::string keyPrefix;
+
     /**
      * Add wanted outputs to an already existing derivation goal.
      */
@@ -10,6 +10,8 @@
 #include <future>
 #include <thread>
 
+#include <unordered_map>
+
 namespace nix {
 
 /* Forward definition. */
@@ -103,8 +105,11 @@ private:
      * Maps used to prevent multiple instantiations of a goal for the
      * same derivation / path.
      */
-    std::map<StorePath, std::weak_ptr<DerivationGoal>> derivationGoals;
-    std::map<StorePath, std::weak_ptr<PathSubstitutionGoal>> substitutionGoals;
+    /* Note: hashed on the store path digest (see
+       std::hash<StorePath>), which with tens of thousands of goals
+       is much cheaper than ordered maps doing string compares. */
+    std::unordered_map<StorePath, std::weak_ptr<DerivationGoal>> derivationGoals;
+    std::unordered_map<StorePath, std::weak_ptr<PathSubstitutionGoal>> substitutionGoals;
     std::map<DrvOutput, std::weak_ptr<DrvOutputSubstitutionGoal>> drvOutputSubstitutionGoals;
 
     /**
@@ -125,7 +130,7 @@ private:
     /**
      * Cache for pathContentsGood().
      */
-    std::map<StorePath, bool> pathContentsGoodCache;
+    std::unordered_map<StorePath, bool> pathContentsGoodCache;
 
 public:
 
@@ -188,6 +193,36 @@ public:
     Worker(Store & store, Store & evalStore);
     ~Worker();
 
+    /**
+     * The expected duration (in seconds) of building the given
+     * derivation, based on recorded times of previous builds of
+     * derivations with the same name. Used for scheduling: longer
+     * builds get build slots first (see `DerivationGoal::key()`).
+     */
+    uint64_t getExpectedBuildTime(const StorePath & drvPath);
+
+    /**
+     * Record the observed duration of a successful build.
+     */
+    void recordBuildTime(const StorePath & drvPath, uint64_t seconds);
+
+    /**
+     * Append a durable JSON record of a finished build (timing, CPU
+     * use) to <state-dir>/build-metrics, queryable with
+     * `nix store build-stats`.
+     */
+    void recordBuildMetrics(const StorePath & drvPath, const BuildResult & result);
+
+private:
+
+    /**
+     * Recorded durations of previous builds, keyed on derivation
+     * name. Loaded lazily from <nix-state-dir>/build-times.
+     */
+    std::optional<std::map<std::string, uint64_t>> buildTimes;
+
+public:
+
     /**
      * Make a goal (with caching).
      */
@@ -240,6 +275,13 @@ public:
      */
     size_t getNrLocalBuilds();
 
+    /**
+     * Whether another local build may start: a `max-jobs` slot is
+     * free and, with `auto-build-jobs`, the machine is not under CPU
+     * or memory pressure.
+     */
+    bool hasLocalBuildCapacity();
+
     /**
      * Return the number of substitution processes currently running.
      */
@@ -2,6 +2,7 @@
 ///@file
 
 #include <cstdint>
+#include <memory>
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <variant>
@@ -176,6 +177,15 @@ struct DerivationOptions
     static DerivationOptions
     fromStructuredAttrs(const StringMap & env, const StructuredAttrs * parsed, bool shouldWarn = true);
 
+    /**
+     * Like `fromStructuredAttrs`, but memoized process-wide on the
+     * attributes actually consulted. Since most derivations carry
+     * identical stdenv boilerplate, mass rebuilds parse each distinct
+     * combination once and the goals share one immutable object.
+     */
+    static std::shared_ptr<const DerivationOptions>
+    fromStructuredAttrsShared(const StringMap & env, const StructuredAttrs * parsed, bool shouldWarn = true);
+
     /**
      * @param drv Must be the same derivation we parsed this from. In
      * the future we'll flip things around so a `BasicDerivation` has
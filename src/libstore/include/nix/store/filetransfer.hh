@@ -10,6 +10,9 @@
 #include "nix/util/configuration.hh"
 #include "nix/util/serialise.hh"
 
+#include <coroutine>
+#include <variant>
+
 namespace nix {
 
 struct FileTransferSettings : Config
@@ -17,6 +20,14 @@ struct FileTransferSettings : Config
     Setting<bool> enableHttp2{this, true, "http2",
         "Whether to enable HTTP/2 support."};
 
+    Setting<unsigned int> http2MaxConcurrentStreams{this, 100, "http2-max-concurrent-streams",
+        R"(
+          The maximum number of concurrent streams per HTTP/2
+          connection. Many small requests to the same server (e.g. a
+          .narinfo storm during substitution) are multiplexed over
+          one connection up to this limit.
+        )"};
+
     Setting<std::string> userAgentSuffix{this, "", "user-agent-suffix",
         "String appended to the user agent in HTTP requests."};
 
@@ -54,6 +65,26 @@ struct FileTransferSettings : Config
           not processed quickly enough to exceed the size of this buffer, downloads may stall.
           The default is 67108864 (64 MiB).
         )"};
+
+    Setting<size_t> httpSegmentSize{this, 32 * 1024 * 1024, "http-segment-size",
+        R"(
+          The segment size (in bytes) used for segmented downloads,
+          i.e. downloads that are split into multiple concurrent
+          ranged requests. See [`http-max-segments`](#conf-http-max-segments).
+        )"};
+
+    Setting<size_t> httpMaxSegments{this, 1, "http-max-segments",
+        R"(
+          The maximum number of concurrent ranged requests that a
+          single large download may be split into, when the server
+          supports byte ranges and announces a content length larger
+          than twice [`http-segment-size`](#conf-http-segment-size).
+          Segments are reassembled in order, so a download may buffer
+          up to `http-max-segments * http-segment-size` bytes in
+          memory.
+
+          The default is 1, i.e. downloads use a single connection.
+        )"};
 };
 
 extern FileTransferSettings fileTransferSettings;
@@ -110,6 +141,24 @@ struct FileTransferResult
 
     uint64_t bodySize = 0;
 
+    /**
+     * Whether the server announced support for ranged requests
+     * (`Accept-Ranges: bytes`).
+     */
+    bool acceptRanges = false;
+
+    /**
+     * The `Content-Length` header, if any. Note that for compressed
+     * responses this is the length of the compressed body, not of
+     * `data`.
+     */
+    std::optional<uint64_t> contentLength;
+
+    /**
+     * The `Content-Encoding` header, if any.
+     */
+    std::string contentEncoding;
+
     /**
      * An "immutable" URL for this resource (i.e. one whose contents
      * will never change), as returned by the `Link: <url>;
@@ -153,6 +202,54 @@ struct FileTransfer
         Sink & sink,
         std::function<void(FileTransferResult)> resultCallback = {});
 
+    /**
+     * An awaitable transfer, for use in coroutines:
+     *
+     * ```
+     * auto result = co_await getFileTransfer()->transfer(request);
+     * ```
+     *
+     * The transfer is enqueued when the coroutine suspends on it.
+     * Note that the coroutine is resumed *on the transfer thread*,
+     * so the continuation must either be brief or reschedule itself
+     * onto its own executor before doing heavy work; in particular,
+     * goals must not block the transfer thread.
+     */
+    struct TransferAwaitable
+    {
+        FileTransfer & fileTransfer;
+        FileTransferRequest request;
+        std::variant<std::monostate, FileTransferResult, std::exception_ptr> result;
+
+        bool await_ready() const noexcept
+        { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            fileTransfer.enqueueFileTransfer(request,
+                {[this, handle](std::future<FileTransferResult> fut) {
+                    try {
+                        result = fut.get();
+                    } catch (...) {
+                        result = std::current_exception();
+                    }
+                    handle.resume();
+                }});
+        }
+
+        FileTransferResult await_resume()
+        {
+            if (auto ex = std::get_if<std::exception_ptr>(&result))
+                std::rethrow_exception(*ex);
+            return std::move(std::get<FileTransferResult>(result));
+        }
+    };
+
+    TransferAwaitable transfer(FileTransferRequest request)
+    {
+        return TransferAwaitable{*this, std::move(request), {}};
+    }
+
     enum Error { NotFound, Forbidden, Misc, Transient, Interrupted };
 };
 
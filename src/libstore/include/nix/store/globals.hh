@@ -387,6 +387,18 @@ public:
     Setting<off_t> reservedSize{this, 8 * 1024 * 1024, "gc-reserved-space",
         "Amount of reserved disk space for the garbage collector."};
 
+    Setting<int> daemonConnectionNiceness{
+        this, 0, "daemon-connection-niceness",
+        R"(
+          The `nice` value applied to daemon connection handler
+          processes. On shared builders, raising it (e.g. to 10)
+          keeps bulk query clients from starving builds: build
+          processes themselves run at the daemon's own priority
+          regardless of this setting. Only takes effect when the
+          daemon can lower and restore priorities (i.e. runs as
+          root).
+        )"};
+
     Setting<bool> fsyncMetadata{
         this, true, "fsync-metadata",
         R"(
@@ -396,6 +408,17 @@ public:
           default is `true`.
         )"};
 
+    Setting<bool> batchFsync{this, false, "batch-fsync",
+        R"(
+          When [`fsync-store-paths`](#conf-fsync-store-paths) is
+          enabled, sync a store path's files with a single `syncfs()`
+          on the store's filesystem instead of walking the path and
+          calling `fsync()` on every file. This gives the same
+          durability for the registered path at a fraction of the
+          syscalls, at the cost of flushing unrelated dirty data on
+          the same filesystem. Only effective on Linux.
+        )"};
+
     Setting<bool> fsyncStorePaths{this, false, "fsync-store-paths",
         R"(
           Whether to call `fsync()` on store paths before registering them, to
@@ -406,12 +429,60 @@ public:
     Setting<bool> useSQLiteWAL{this, !isWSL1(), "use-sqlite-wal",
         "Whether SQLite should use WAL mode."};
 
+    Setting<int64_t> sqliteMmapSize{this, 0, "sqlite-mmap-size",
+        R"(
+          Size in bytes of the memory map through which the Nix
+          database is read (SQLite's `mmap_size` pragma). A mapping
+          lets concurrent readers share one warm image of the database
+          in the kernel page cache instead of each keeping private
+          copies of the hot pages, which helps on busy builders with
+          large databases. `0` (the default) disables the mapping.
+        )"};
+
+    Setting<int64_t> sqliteCacheSize{this, 0, "sqlite-cache-size",
+        R"(
+          Per-connection page cache size of the Nix database (SQLite's
+          `cache_size` pragma): a page count if positive, KiB if
+          negative. `0` (the default) leaves SQLite's default in
+          place.
+        )"};
+
+    Setting<int64_t> sqliteWalAutocheckpoint{this, 40000, "sqlite-wal-autocheckpoint",
+        R"(
+          Number of WAL pages after which the Nix database is
+          checkpointed. The default is large enough that instantiating
+          a NixOS system derivation checkpoints (and thus syncs) only
+          once; write-heavy workloads on slow disks may want it lower,
+          read-mostly ones higher. Only effective in WAL mode.
+        )"};
+
 #ifndef _WIN32
     // FIXME: remove this option, `fsync-store-paths` is faster.
     Setting<bool> syncBeforeRegistering{this, false, "sync-before-registering",
         "Whether to call `sync()` before registering a path as valid."};
 #endif
 
+    Setting<bool> autoBuildJobs{this, false, "auto-build-jobs",
+        R"(
+          If set to `true`, admission of local builds additionally
+          considers the machine's [pressure stall
+          information](https://docs.kernel.org/accounting/psi.html):
+          when CPU or memory pressure exceeds
+          [`build-cpu-pressure-limit`](#conf-build-cpu-pressure-limit) or
+          [`build-memory-pressure-limit`](#conf-build-memory-pressure-limit),
+          further builds are held back until a running build finishes,
+          even if [`max-jobs`](#conf-max-jobs) slots are free. One
+          build is always admitted, so progress is guaranteed. This
+          lets a large `max-jobs` setting soak up small builds without
+          letting many large builds thrash the machine. Linux only.
+        )"};
+
+    Setting<unsigned int> buildCpuPressureLimit{this, 75, "build-cpu-pressure-limit",
+        "CPU pressure (PSI `some avg10`, in percent) above which `auto-build-jobs` stops admitting builds."};
+
+    Setting<unsigned int> buildMemPressureLimit{this, 10, "build-memory-pressure-limit",
+        "Memory pressure (PSI `some avg10`, in percent) above which `auto-build-jobs` stops admitting builds."};
+
     Setting<bool> useSubstitutes{
         this, true, "substitute",
         R"(
@@ -514,11 +585,22 @@ public:
         this, true, "compress-build-log",
         R"(
           If set to `true` (the default), build logs written to
-          `/nix/var/log/nix/drvs` will be compressed on the fly using bzip2.
+          `/nix/var/log/nix/drvs` will be compressed on the fly.
           Otherwise, they will not be compressed.
         )",
         {"build-compress-log"}};
 
+    Setting<std::string> logCompression{
+        this, "bzip2", "log-compression",
+        R"(
+          The compression method used for build logs when
+          [`compress-build-log`](#conf-compress-build-log) is
+          enabled: `bzip2` (the default, readable by older tools) or
+          `zstd` (considerably faster to compress, keeping log
+          compression off the critical path of verbose builds).
+          Either format can be read back regardless of this setting.
+        )"};
+
     Setting<unsigned long> maxLogSize{
         this, 0, "max-build-log-size",
         R"(
@@ -172,6 +172,16 @@ public:
      * Just exists because this is exactly what Hydra was doing, and we
      * don't yet want an algorithmic change.
      */
+    /**
+     * Ship a whole batch of paths over one connection with a window
+     * of unacknowledged NARs, rather than a round trip per path.
+     */
+    void addMultipleToStore(
+        PathsSource && pathsToCopy,
+        Activity & act,
+        RepairFlag repair,
+        CheckSigsFlag checkSigs) override;
+
     void addMultipleToStoreLegacy(Store & srcStore, const StorePathSet & paths);
 
     void connect() override;
@@ -184,6 +194,12 @@ public:
 
     ConnectionStats getConnectionStats();
 
+    /**
+     * The remote machine's current load average, if the remote
+     * serves protocol >= 2.8.
+     */
+    std::optional<double> queryLoad();
+
     pid_t getConnectionPid();
 
     /**
@@ -173,6 +173,12 @@ private:
      */
     void deleteStorePath(const Path & path, uint64_t & bytesFreed) override;
 
+    /**
+     * Deletion must go through the layer-aware `deleteStorePath`.
+     */
+    bool canDeleteAsync() override
+    { return false; }
+
     /**
      * Deduplicate by removing store objects from the upper layer that
      * are now in the lower layer.
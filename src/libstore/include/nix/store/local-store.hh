@@ -8,9 +8,12 @@
 #include "nix/store/indirect-root-store.hh"
 #include "nix/util/sync.hh"
 
+#include "nix/util/pool.hh"
+
 #include <chrono>
 #include <future>
 #include <string>
+#include <atomic>
 #include <unordered_set>
 
 
@@ -30,8 +33,9 @@ const int nixSchemaVersion = 10;
 
 struct OptimiseStats
 {
-    unsigned long filesLinked = 0;
-    uint64_t bytesFreed = 0;
+    /* Atomic because the optimiser runs on a thread pool. */
+    std::atomic<unsigned long> filesLinked{0};
+    std::atomic<uint64_t> bytesFreed{0};
 };
 
 struct LocalStoreConfig : std::enable_shared_from_this<LocalStoreConfig>, virtual LocalFSStoreConfig
@@ -65,6 +69,36 @@ struct LocalStoreConfig : std::enable_shared_from_this<LocalStoreConfig>, virtua
           > While the filesystem the database resides on might appear to be read-only, consider whether another user or system might have write access to it.
         )"};
 
+    Setting<bool> verifyIncomingPaths{this,
+        true,
+        "verify-incoming-paths",
+        R"(
+          Whether to re-verify the NAR hash (and, for content-addressed
+          paths, the content address) of paths as they are added to
+          this store. Disabling this skips a SHA-256 pass per copied
+          path - and a full re-read for content-addressed paths - which
+          makes promotion copies between two stores on the same machine
+          run at disk speed.
+
+          > **Warning**
+          > Only disable this for copies from a store you trust as
+          > much as this one (e.g. a CI chroot store on the same
+          > machine). The source store's database already attests the
+          > hashes being copied; this setting merely stops this store
+          > from re-deriving them.
+        )"};
+
+    Setting<bool> ephemeral{this,
+        false,
+        "ephemeral",
+        R"(
+          Treat this store as throwaway: skip all database syncing,
+          so registration costs no fsync at all. Intended for
+          tmpfs-backed stores used by CI builds whose contents do not
+          need to survive a crash; a crash can corrupt the store's
+          database.
+        )"};
+
     static const std::string name() { return "Local Store"; }
 
     static StringSet uriSchemes()
@@ -92,6 +126,23 @@ private:
      */
     AutoCloseFD globalLock;
 
+    /**
+     * A read-only database connection plus the prepared statements
+     * for path info queries. Pooled, so read storms don't serialize
+     * on the main connection's mutex (WAL mode lets readers run
+     * concurrently with the writer).
+     */
+    struct ReadConn
+    {
+        SQLite db;
+        SQLiteStmt queryPathInfo;
+        SQLiteStmt queryReferences;
+    };
+
+    ref<Pool<ReadConn>> readConnections;
+
+    ref<ReadConn> openReadConnection();
+
     struct State
     {
         /**
@@ -169,6 +220,8 @@ public:
 
     StorePathSet queryAllValidPaths() override;
 
+    void forEachValidPath(std::function<void(const StorePath &)> callback) override;
+
     void queryPathInfoUncached(const StorePath & path,
         Callback<std::shared_ptr<const ValidPathInfo>> callback) noexcept override;
 
@@ -199,6 +252,13 @@ public:
 
     void addTempRoot(const StorePath & path) override;
 
+    /**
+     * Temp roots already registered by this process. Goals register
+     * the same roots over and over; the repeats can skip the
+     * lock/write syscall dance entirely.
+     */
+    Sync<StorePathSet> tempRootsAdded;
+
 private:
 
     void createTempRootsFile();
@@ -259,6 +319,16 @@ public:
      */
     virtual void deleteStorePath(const Path & path, uint64_t & bytesFreed);
 
+    /**
+     * Whether `deleteStorePath` simply removes the path from the
+     * filesystem, so that `collectGarbage` may rename dead paths
+     * into a trash directory and delete them asynchronously on a
+     * pool of deleter threads. Stores that override
+     * `deleteStorePath` with layer-aware behaviour return false.
+     */
+    virtual bool canDeleteAsync()
+    { return true; }
+
     /**
      * Optimise the disk space usage of the Nix store by hard-linking
      * files with the same contents.
@@ -390,10 +460,27 @@ private:
 
     std::pair<std::filesystem::path, AutoCloseFD> createTempDirInStore();
 
-    typedef std::unordered_set<ino_t> InodeHash;
+    /**
+     * Inodes known to be linked into the links directory. Shared
+     * between the optimiser threads, hence internally synchronised.
+     */
+    struct InodeHash
+    {
+        std::shared_ptr<Sync<std::unordered_set<ino_t>>> inodes =
+            std::make_shared<Sync<std::unordered_set<ino_t>>>();
+
+        bool count(ino_t ino)
+        { return inodes->lock()->count(ino); }
+
+        void insert(ino_t ino)
+        { inodes->lock()->insert(ino); }
+
+        size_t size()
+        { return inodes->lock()->size(); }
+    };
 
     InodeHash loadInodeHash();
-    Strings readDirectoryIgnoringInodes(const Path & path, const InodeHash & inodeHash);
+    Strings readDirectoryIgnoringInodes(const Path & path, InodeHash & inodeHash);
     void optimisePath_(Activity * act, OptimiseStats & stats, const Path & path, InodeHash & inodeHash, RepairFlag repair);
 
     // Internal versions that are not wrapped in retry_sqlite.
@@ -16,6 +16,16 @@ struct NarInfo : ValidPathInfo
     std::optional<Hash> fileHash;
     uint64_t fileSize = 0;
 
+    /**
+     * Aggregate sizes of this path's closure as stored in the same
+     * cache (NAR bytes and compressed download bytes). Optional
+     * rollup written at upload time so a deployment gate can estimate
+     * the cost of substituting a root from one narinfo fetch instead
+     * of walking the closure. 0 means unknown.
+     */
+    uint64_t closureNarSize = 0;
+    uint64_t closureFileSize = 0;
+
     NarInfo() = delete;
     NarInfo(const Store & store, std::string name, ContentAddressWithReferences ca, Hash narHash)
         : ValidPathInfo(store, std::move(name), std::move(ca), narHash)
@@ -163,9 +163,12 @@ struct ValidPathInfo : UnkeyedValidPathInfo {
     /**
      * Return the number of signatures on this .narinfo that were
      * produced by one of the specified keys, or maxSigs if the path
-     * is content-addressed.
+     * is content-addressed. Stops verifying once `enough` valid
+     * signatures have been seen: callers that only need to know
+     * whether a path is signed at all pass 1 and skip the remaining
+     * ed25519 verifications.
      */
-    size_t checkSignatures(const Store & store, const PublicKeys & publicKeys) const;
+    size_t checkSignatures(const Store & store, const PublicKeys & publicKeys, size_t enough = maxSigs) const;
 
     /**
      * Verify a single signature.
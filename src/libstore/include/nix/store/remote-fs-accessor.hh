@@ -17,6 +17,14 @@ class RemoteFSAccessor : public SourceAccessor
 
     Path cacheDir;
 
+    /**
+     * Where NAR listings are cached. Same as `cacheDir` when NAR
+     * caching is enabled, otherwise a shared per-user directory:
+     * listings are small and make repeated metadata access skip
+     * fetching and parsing the NAR entirely.
+     */
+    Path listingCacheDir;
+
     std::pair<ref<SourceAccessor>, CanonPath> fetch(const CanonPath & path);
 
     friend struct BinaryCacheStore;
@@ -1,10 +1,14 @@
 #pragma once
 ///@file
 
+#include <atomic>
+#include <chrono>
 #include <limits>
+#include <optional>
 #include <string>
 
 #include "nix/store/store-api.hh"
+#include "nix/store/worker-protocol.hh"
 #include "nix/store/gc-store.hh"
 #include "nix/store/log-store.hh"
 
@@ -22,7 +26,8 @@ struct RemoteStoreConfig : virtual StoreConfig
 {
     using StoreConfig::StoreConfig;
 
-    const Setting<int> maxConnections{this, 1, "max-connections",
+    // Non-const: SSH stores raise the default, see `SSHStoreConfig`.
+    Setting<int> maxConnections{this, 1, "max-connections",
         "Maximum number of concurrent connections to the Nix daemon."};
 
     const Setting<unsigned int> maxConnectionAge{this,
@@ -46,6 +51,8 @@ struct RemoteStore :
 
     RemoteStore(const Config & config);
 
+    ~RemoteStore();
+
     /* Implementations of abstract store API methods. */
 
     bool isValidPathUncached(const StorePath & path) override;
@@ -58,6 +65,25 @@ struct RemoteStore :
     void queryPathInfoUncached(const StorePath & path,
         Callback<std::shared_ptr<const ValidPathInfo>> callback) noexcept override;
 
+    std::map<StorePath, ref<const ValidPathInfo>> queryPathInfos(const StorePathSet & paths) override;
+
+    std::map<DrvOutput, Realisation> queryRealisations(const std::set<DrvOutput> & ids) override;
+
+    nlohmann::json memoryStats() override;
+
+    /**
+     * Round-trip latency of a no-op daemon request, for health
+     * probes. Nothing if the daemon predates the Ping op.
+     */
+    std::optional<std::chrono::microseconds> ping();
+
+    /**
+     * The protocol version negotiated by the first connection, used
+     * to shorten the handshake of subsequent ones. 0 if no
+     * connection has been made yet.
+     */
+    std::atomic<WorkerProto::Version> expectedProtoVersion{0};
+
     void queryReferrers(const StorePath & path, StorePathSet & referrers) override;
 
     StorePathSet queryValidDerivers(const StorePath & path) override;
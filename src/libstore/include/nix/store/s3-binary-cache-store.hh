@@ -93,6 +93,10 @@ public:
     const Setting<uint64_t> bufferSize{
         this, 5 * 1024 * 1024, "buffer-size", "Size (in bytes) of each part in multi-part uploads."};
 
+    const Setting<unsigned int> uploadThreads{
+        this, 0, "upload-threads",
+        "The number of threads used for uploads. 0 means one per hardware thread."};
+
     static const std::string name()
     {
         return "S3 Binary Cache Store";
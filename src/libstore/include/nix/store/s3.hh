@@ -28,8 +28,13 @@ struct S3Helper
         unsigned int durationMs;
     };
 
+    /**
+     * @param range Byte range in HTTP `Range` header syntax (e.g.
+     * `bytes=0-1023`); fetches the whole object if empty.
+     */
     FileTransferResult getObject(
-        const std::string & bucketName, const std::string & key);
+        const std::string & bucketName, const std::string & key,
+        const std::string & range = "");
 };
 
 }
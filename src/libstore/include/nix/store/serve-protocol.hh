@@ -8,7 +8,7 @@ namespace nix {
 #define SERVE_MAGIC_1 0x390c9deb
 #define SERVE_MAGIC_2 0x5452eecb
 
-#define SERVE_PROTOCOL_VERSION (2 << 8 | 7)
+#define SERVE_PROTOCOL_VERSION (2 << 8 | 8)
 #define GET_PROTOCOL_MAJOR(x) ((x) & 0xff00)
 #define GET_PROTOCOL_MINOR(x) ((x) & 0x00ff)
 
@@ -115,6 +115,11 @@ enum struct ServeProto::Command : uint64_t
     QueryClosure = 7,
     BuildDerivation = 8,
     AddToStoreNar = 9,
+    /**
+     * Report the builder's current load average (times 1000), so
+     * dispatchers can log and tune placement. Since 2.8.
+     */
+    QueryLoad = 10,
 };
 
 
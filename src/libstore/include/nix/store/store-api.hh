@@ -6,7 +6,7 @@
 #include "nix/util/hash.hh"
 #include "nix/store/content-address.hh"
 #include "nix/util/serialise.hh"
-#include "nix/util/lru-cache.hh"
+#include "nix/util/sharded-lru-cache.hh"
 #include "nix/util/sync.hh"
 #include "nix/store/globals.hh"
 #include "nix/util/configuration.hh"
@@ -126,6 +126,14 @@ struct StoreConfig : public StoreDirConfig
         return std::nullopt;
     }
 
+    Setting<unsigned int> maxCopyStreams{this, 0, "max-copy-streams",
+        R"(
+          The maximum number of store paths copied into this store
+          concurrently (e.g. by `nix copy`). 0 means one per
+          hardware thread. Object storage backends sustain many
+          streams; `ssh://` stores usually saturate with a few.
+        )"};
+
     Setting<int> pathInfoCacheSize{this, 65536, "path-info-cache-size",
         "Size of the in-memory store path metadata cache."};
 
@@ -219,12 +227,10 @@ protected:
         }
     };
 
-    struct State
-    {
-        LRUCache<std::string, PathInfoCacheValue> pathInfoCache;
-    };
-
-    SharedSync<State> state;
+    /**
+     * Thread-safe, so no further locking is needed to access it.
+     */
+    ShardedLRUCache<std::string, PathInfoCacheValue> pathInfoCache;
 
     std::shared_ptr<NarInfoDiskCache> diskCache;
 
@@ -300,6 +306,29 @@ public:
      */
     ref<const ValidPathInfo> queryPathInfo(const StorePath & path);
 
+    /**
+     * Query information about several paths at once. Invalid paths
+     * are omitted from the result. Stores that talk to a daemon
+     * implement this as a single round trip.
+     */
+    virtual std::map<StorePath, ref<const ValidPathInfo>> queryPathInfos(const StorePathSet & paths);
+
+    /**
+     * Query several realisations at once. Unknown ones are omitted
+     * from the result. Stores that talk to a daemon implement this
+     * as a single round trip.
+     */
+    virtual std::map<DrvOutput, Realisation> queryRealisations(const std::set<DrvOutput> & ids);
+
+    /**
+     * Iterate over all valid paths, invoking `callback` for each,
+     * without materialising the whole set - inventory tooling over
+     * multi-million-path stores runs in constant memory this way.
+     * The default implementation falls back to
+     * `queryAllValidPaths()`.
+     */
+    virtual void forEachValidPath(std::function<void(const StorePath &)> callback);
+
     /**
      * Asynchronous version of queryPathInfo().
      */
@@ -738,6 +767,17 @@ public:
 
     const Stats & getStats();
 
+    /**
+     * Memory diagnostics for this process, as JSON: entry and byte
+     * counters for the path info cache, SQLite's allocations, and the
+     * allocator/RSS where the platform exposes them. Remote stores
+     * forward the query to the daemon when it is recent enough, so
+     * operators can watch which subsystem grows in a long-running
+     * daemon and evict it (e.g. via `clearPathInfoCache`) instead of
+     * restarting.
+     */
+    virtual nlohmann::json memoryStats();
+
     /**
      * Computes the full closure of of a set of store-paths for e.g.
      * derivations that need this information for `exportReferencesGraph`.
@@ -757,7 +797,7 @@ public:
      */
     void clearPathInfoCache()
     {
-        state.lock()->pathInfoCache.clear();
+        pathInfoCache.clear();
     }
 
     /**
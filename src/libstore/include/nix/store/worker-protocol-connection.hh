@@ -92,8 +92,18 @@ struct WorkerProto::BasicClientConnection : WorkerProto::BasicConnection
      * @param supportedFeatures The protocol features that we support.
      */
     // FIXME: this should probably be a constructor.
+    /**
+     * @param expectedVersion The protocol version negotiated by an
+     * earlier connection to the same daemon, if any. When it
+     * indicates that the daemon does feature negotiation, our
+     * features are sent together with the greeting, saving a round
+     * trip. If the daemon turns out to have changed to a version
+     * without feature negotiation, the connection is unusable and an
+     * error is thrown.
+     */
     static std::tuple<Version, FeatureSet> handshake(
-        BufferedSink & to, Source & from, WorkerProto::Version localVersion, const FeatureSet & supportedFeatures);
+        BufferedSink & to, Source & from, WorkerProto::Version localVersion, const FeatureSet & supportedFeatures,
+        std::optional<WorkerProto::Version> expectedVersion = std::nullopt);
 
     /**
      * After calling handshake, must call this to exchange some basic
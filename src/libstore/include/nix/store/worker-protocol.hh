@@ -13,7 +13,7 @@ namespace nix {
 
 /* Note: you generally shouldn't change the protocol version. Define a
    new `WorkerProto::Feature` instead. */
-#define PROTOCOL_VERSION (1 << 8 | 38)
+#define PROTOCOL_VERSION (1 << 8 | 39)
 #define GET_PROTOCOL_MAJOR(x) ((x) & 0xff00)
 #define GET_PROTOCOL_MINOR(x) ((x) & 0x00ff)
 
@@ -186,6 +186,10 @@ enum struct WorkerProto::Op : uint64_t
     AddBuildLog = 45,
     BuildPathsWithResults = 46,
     AddPermRoot = 47,
+    QueryPathInfos = 48,
+    QueryRealisations = 49,
+    QueryMemoryStats = 50,
+    Ping = 51,
 };
 
 struct WorkerProto::ClientHandshakeInfo
@@ -214,6 +218,17 @@ struct WorkerProto::ClientHandshakeInfo
     bool operator == (const ClientHandshakeInfo &) const = default;
 };
 
+/**
+ * Client-side op latency bookkeeping, recorded between an op code
+ * being sent and its stderr processing finishing on the same thread.
+ * Dumped per op code on exit when `NIX_SHOW_DAEMON_STATS` is set, so
+ * daemon saturation can be told apart from network trouble without
+ * instrumenting the daemon.
+ */
+void noteWorkerOpStart(WorkerProto::Op op);
+void noteWorkerOpEnd();
+void maybeDumpWorkerOpStats();
+
 /**
  * Convenience for sending operation codes.
  *
@@ -222,6 +237,7 @@ struct WorkerProto::ClientHandshakeInfo
  */
 inline Sink & operator << (Sink & sink, WorkerProto::Op op)
 {
+    noteWorkerOpStart(op);
     return sink << static_cast<uint64_t>(op);
 }
 
@@ -1,4 +1,8 @@
 #include "nix/store/legacy-ssh-store.hh"
+#include "nix/util/topo-sort.hh"
+
+#include <deque>
+#include "nix/util/signals.hh"
 #include "nix/store/common-ssh-store-config.hh"
 #include "nix/util/archive.hh"
 #include "nix/util/pool.hh"
@@ -331,6 +335,114 @@ StorePathSet LegacySSHStore::queryValidPaths(const StorePathSet & paths,
 }
 
 
+void LegacySSHStore::addMultipleToStore(
+    PathsSource && pathsToCopy,
+    Activity & act,
+    RepairFlag repair,
+    CheckSigsFlag checkSigs)
+{
+    if (pathsToCopy.empty()) return;
+
+    {
+        auto conn(connections->get());
+
+        if (GET_PROTOCOL_MINOR(conn->remoteVersion) >= 5) {
+            /* Pipeline the whole batch over this connection with a
+               bounded window of unacknowledged NARs, instead of
+               paying a full round trip per path; over WAN links the
+               per-path ack wait is what dominates. */
+            StorePathSet pathSet;
+            std::map<StorePath, std::pair<ValidPathInfo, std::unique_ptr<Source>> *> infosMap;
+            for (auto & p : pathsToCopy) {
+                pathSet.insert(p.first.path);
+                infosMap.insert_or_assign(p.first.path, &p);
+            }
+
+            /* One batched presence query up front. */
+            auto valid = conn->queryValidPaths(*this, false, pathSet, NoSubstitute);
+
+            /* Send in dependency order (references first). */
+            auto sorted = topoSort(pathSet,
+                {[&](const StorePath & path) {
+                    StorePathSet refs;
+                    for (auto & ref : infosMap.at(path)->first.references)
+                        if (ref != path && pathSet.count(ref))
+                            refs.insert(ref);
+                    return refs;
+                }},
+                {[&](const StorePath & path, const StorePath & parent) {
+                    return Error("cycle detected while copying '%s'", printStorePath(path));
+                }});
+
+            constexpr size_t maxWindow = 64;
+
+            std::deque<StorePath> awaitingAck;
+            size_t nrDone = 0;
+
+            auto drainOne = [&]() {
+                auto path = awaitingAck.front();
+                awaitingAck.pop_front();
+                if (readInt(conn->from) != 1)
+                    throw Error("failed to add path '%s' to remote host '%s'",
+                        printStorePath(path), config->host);
+                act.progress(++nrDone, pathsToCopy.size());
+            };
+
+            try {
+                for (auto i = sorted.rbegin(); i != sorted.rend(); ++i) {
+                    checkInterrupt();
+
+                    if (valid.count(*i)) {
+                        act.progress(++nrDone, pathsToCopy.size());
+                        continue;
+                    }
+
+                    auto & [info_, source] = *infosMap.at(*i);
+                    auto info = info_;
+                    info.ultimate = false;
+
+                    conn->to
+                        << ServeProto::Command::AddToStoreNar
+                        << printStorePath(info.path)
+                        << (info.deriver ? printStorePath(*info.deriver) : "")
+                        << info.narHash.to_string(HashFormat::Base16, false);
+                    ServeProto::write(*this, *conn, info.references);
+                    conn->to
+                        << info.registrationTime
+                        << info.narSize
+                        << info.ultimate
+                        << info.sigs
+                        << renderContentAddress(info.ca);
+                    copyNAR(*source, conn->to);
+                    source.reset();
+
+                    awaitingAck.push_back(info.path);
+
+                    if (awaitingAck.size() >= maxWindow) {
+                        conn->to.flush();
+                        drainOne();
+                    }
+                }
+
+                conn->to.flush();
+                while (!awaitingAck.empty())
+                    drainOne();
+            } catch (...) {
+                conn->good = false;
+                throw;
+            }
+
+            return;
+        }
+    }
+
+    /* Old servers: fall back to the generic per-path copy (after
+       releasing the connection, which the per-path calls acquire
+       themselves). */
+    Store::addMultipleToStore(std::move(pathsToCopy), act, repair, checkSigs);
+}
+
+
 void LegacySSHStore::addMultipleToStoreLegacy(Store & srcStore, const StorePathSet & paths)
 {
     auto conn(connections->get());
@@ -354,6 +466,17 @@ void LegacySSHStore::connect()
 }
 
 
+std::optional<double> LegacySSHStore::queryLoad()
+{
+    auto conn(connections->get());
+    if (GET_PROTOCOL_MINOR(conn->remoteVersion) < 8)
+        return std::nullopt;
+    conn->to << ServeProto::Command::QueryLoad;
+    conn->to.flush();
+    return readNum<uint64_t>(conn->from) / 1000.0;
+}
+
+
 unsigned int LegacySSHStore::getProtocol()
 {
     auto conn(connections->get());
@@ -78,6 +78,11 @@ protected:
         }
     }
 
+    void deleteFile(const std::string & path) override
+    {
+        deletePath(config->binaryCacheDir + "/" + path);
+    }
+
     StorePathSet queryAllValidPaths() override
     {
         StorePathSet paths;
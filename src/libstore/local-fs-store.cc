@@ -107,15 +107,18 @@ std::optional<std::string> LocalFSStore::getBuildLogExact(const StorePath & path
             j == 0
             ? fmt("%s/%s/%s/%s", config.logDir.get(), drvsLogDir, baseName.substr(0, 2), baseName.substr(2))
             : fmt("%s/%s/%s", config.logDir.get(), drvsLogDir, baseName);
-        Path logBz2Path = logPath + ".bz2";
-
         if (pathExists(logPath))
             return readFile(logPath);
 
-        else if (pathExists(logBz2Path)) {
-            try {
-                return decompress("bzip2", readFile(logBz2Path));
-            } catch (Error &) { }
+        for (auto & [ext, method] : std::initializer_list<std::pair<const char *, const char *>>{
+            {".zst", "zstd"}, {".bz2", "bzip2"}})
+        {
+            auto compressedLogPath = logPath + ext;
+            if (pathExists(compressedLogPath)) {
+                try {
+                    return decompress(method, readFile(compressedLogPath));
+                } catch (Error &) { }
+            }
         }
 
     }
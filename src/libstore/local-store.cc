@@ -25,6 +25,7 @@
 #include <cstring>
 
 #include <memory>
+#include <thread>
 #include <new>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -114,6 +115,9 @@ LocalStore::LocalStore(ref<const Config> config)
     , schemaPath(dbDir + "/schema")
     , tempRootsDir(config->stateDir + "/temproots")
     , fnTempRoots(fmt("%s/%d", tempRootsDir, getpid()))
+    , readConnections(make_ref<Pool<ReadConn>>(
+          std::max(1U, std::thread::hardware_concurrency()),
+          [this]() { return openReadConnection(); }))
 {
     auto state(_state.lock());
     state->stmts = std::make_unique<State::Stmts>();
@@ -446,6 +450,22 @@ int LocalStore::getSchema()
     return curSchema;
 }
 
+ref<LocalStore::ReadConn> LocalStore::openReadConnection()
+{
+    auto conn = make_ref<ReadConn>();
+
+    conn->db = SQLite(dbDir + "/db.sqlite",
+        config->readOnly ? SQLiteOpenMode::Immutable : SQLiteOpenMode::NoCreate);
+
+    conn->queryPathInfo.create(conn->db,
+        "select id, hash, registrationTime, deriver, narSize, ultimate, sigs, ca from ValidPaths where path = ?;");
+
+    conn->queryReferences.create(conn->db,
+        "select path from Refs join ValidPaths on reference = id where referrer = ?;");
+
+    return conn;
+}
+
 void LocalStore::openDB(State & state, bool create)
 {
     if (create && config->readOnly) {
@@ -480,7 +500,7 @@ void LocalStore::openDB(State & state, bool create)
        should be safe enough.  If the user asks for it, don't sync at
        all.  This can cause database corruption if the system
        crashes. */
-    std::string syncMode = settings.fsyncMetadata ? "normal" : "off";
+    std::string syncMode = !config->ephemeral && settings.fsyncMetadata ? "normal" : "off";
     db.exec("pragma synchronous = " + syncMode);
 
     /* Set the SQLite journal mode.  WAL mode is fastest, so it's the
@@ -511,12 +531,19 @@ void LocalStore::openDB(State & state, bool create)
         }
     }
 
-    /* Increase the auto-checkpoint interval to 40000 pages.  This
-       seems enough to ensure that instantiating the NixOS system
+    /* The default auto-checkpoint interval of 40000 pages seems
+       enough to ensure that instantiating the NixOS system
        derivation is done in a single fsync(). */
-    if (mode == "wal" && sqlite3_exec(db, "pragma wal_autocheckpoint = 40000;", 0, 0, 0) != SQLITE_OK)
+    if (mode == "wal" && sqlite3_exec(db,
+            fmt("pragma wal_autocheckpoint = %d;", settings.sqliteWalAutocheckpoint.get()).c_str(), 0, 0, 0) != SQLITE_OK)
         SQLiteError::throw_(db, "setting autocheckpoint interval");
 
+    /* Optional read-path tuning; see the setting descriptions. */
+    if (settings.sqliteMmapSize.get() != 0)
+        db.exec(fmt("pragma mmap_size = %d", settings.sqliteMmapSize.get()));
+    if (settings.sqliteCacheSize.get() != 0)
+        db.exec(fmt("pragma cache_size = %d", settings.sqliteCacheSize.get()));
+
     /* Initialise the database schema, if necessary. */
     if (create) {
         static const char schema[] =
@@ -555,11 +582,15 @@ void LocalStore::upgradeDBSchema(State & state)
         schemaMigrations.insert(migrationName);
     };
 
-    if (experimentalFeatureSettings.isEnabled(Xp::CaDerivations))
+    if (experimentalFeatureSettings.isEnabled(Xp::CaDerivations)) {
         doUpgrade(
             "20220326-ca-derivations",
             #include "ca-specific-schema.sql.gen.hh"
             );
+        doUpgrade(
+            "20260901-realisations-output-path-index",
+            "create index if not exists IndexRealisationsOutputPath on Realisations(outputPath);");
+    }
 }
 
 
@@ -702,11 +733,8 @@ uint64_t LocalStore::addValidPath(State & state,
         }
     }
 
-    {
-        auto state_(Store::state.lock());
-        state_->pathInfoCache.upsert(std::string(info.path.to_string()),
-            PathInfoCacheValue{ .value = std::make_shared<const ValidPathInfo>(info) });
-    }
+    pathInfoCache.upsert(std::string(info.path.to_string()),
+        PathInfoCacheValue{ .value = std::make_shared<const ValidPathInfo>(info) });
 
     return id;
 }
@@ -716,9 +744,62 @@ void LocalStore::queryPathInfoUncached(const StorePath & path,
     Callback<std::shared_ptr<const ValidPathInfo>> callback) noexcept
 {
     try {
+        /* Without WAL, concurrent readers would just trade the mutex
+           for SQLITE_BUSY churn against the writer. */
+        if (!settings.useSQLiteWAL) {
+            callback(retrySQLite<std::shared_ptr<const ValidPathInfo>>([&]() {
+                auto state(_state.lock());
+                return queryPathInfoInternal(*state, path);
+            }));
+            return;
+        }
+
         callback(retrySQLite<std::shared_ptr<const ValidPathInfo>>([&]() {
-            auto state(_state.lock());
-            return queryPathInfoInternal(*state, path);
+            /* Use a pooled read-only connection, so concurrent
+               queries don't serialize on the main connection. */
+            auto conn(readConnections->get());
+
+            auto useQueryPathInfo(conn->queryPathInfo.use()(printStorePath(path)));
+
+            if (!useQueryPathInfo.next())
+                return std::shared_ptr<const ValidPathInfo>();
+
+            auto id = useQueryPathInfo.getInt(0);
+
+            auto narHash = Hash::dummy;
+            try {
+                narHash = Hash::parseAnyPrefixed(useQueryPathInfo.getStr(1));
+            } catch (BadHash & e) {
+                throw Error("invalid-path entry for '%s': %s", printStorePath(path), e.what());
+            }
+
+            auto info = std::make_shared<ValidPathInfo>(path, narHash);
+
+            info->id = id;
+
+            info->registrationTime = useQueryPathInfo.getInt(2);
+
+            auto s = (const char *) sqlite3_column_text(conn->queryPathInfo, 3);
+            if (s) info->deriver = parseStorePath(s);
+
+            /* Note that narSize = NULL yields 0. */
+            info->narSize = useQueryPathInfo.getInt(4);
+
+            info->ultimate = useQueryPathInfo.getInt(5) == 1;
+
+            s = (const char *) sqlite3_column_text(conn->queryPathInfo, 6);
+            if (s) info->sigs = tokenizeString<StringSet>(s, " ");
+
+            s = (const char *) sqlite3_column_text(conn->queryPathInfo, 7);
+            if (s) info->ca = ContentAddress::parseOpt(s);
+
+            /* Get the references. */
+            auto useQueryReferences(conn->queryReferences.use()(info->id));
+
+            while (useQueryReferences.next())
+                info->references.insert(parseStorePath(useQueryReferences.getStr(0)));
+
+            return std::shared_ptr<const ValidPathInfo>(info);
         }));
 
     } catch (...) { callback.rethrow(); }
@@ -830,6 +911,19 @@ StorePathSet LocalStore::queryAllValidPaths()
     });
 }
 
+void LocalStore::forEachValidPath(std::function<void(const StorePath &)> callback)
+{
+    /* Stream rows straight out of the database. Note: the callback
+       runs with the database state locked, so it must not reenter
+       the store. */
+    retrySQLite<void>([&]() {
+        auto state(_state.lock());
+        auto use(state->stmts->QueryValidPaths.use());
+        while (use.next())
+            callback(parseStorePath(use.getStr(0)));
+    });
+}
+
 
 void LocalStore::queryReferrers(State & state, const StorePath & path, StorePathSet & referrers)
 {
@@ -947,7 +1041,7 @@ void LocalStore::registerValidPaths(const ValidPathInfos & infos)
        be fsync-ed.  So some may want to fsync them before registering
        the validity, at the expense of some speed of the path
        registering operation. */
-    if (settings.syncBeforeRegistering) sync();
+    if (settings.syncBeforeRegistering && !config->ephemeral) sync();
 #endif
 
     return retrySQLite<void>([&]() {
@@ -956,19 +1050,68 @@ void LocalStore::registerValidPaths(const ValidPathInfos & infos)
         SQLiteTxn txn(state->db);
         StorePathSet paths;
 
+        /* Remember the ids of the paths touched in this transaction,
+           so that inserting the references below doesn't have to
+           query them again one statement at a time. */
+        std::map<StorePath, uint64_t> pathToId;
+
         for (auto & [_, i] : infos) {
             assert(i.narHash.algo == HashAlgorithm::SHA256);
-            if (isValidPath_(*state, i.path))
+            if (isValidPath_(*state, i.path)) {
                 updatePathInfo(*state, i);
-            else
-                addValidPath(*state, i, false);
+                pathToId.insert_or_assign(i.path, queryValidPathId(*state, i.path));
+            } else
+                pathToId.insert_or_assign(i.path, addValidPath(*state, i, false));
             paths.insert(i.path);
         }
 
+        auto lookupId = [&](const StorePath & path) {
+            auto i = pathToId.find(path);
+            if (i != pathToId.end()) return i->second;
+            return pathToId.insert_or_assign(path, queryValidPathId(*state, path)).first->second;
+        };
+
+        std::vector<std::pair<uint64_t, uint64_t>> refs;
         for (auto & [_, i] : infos) {
-            auto referrer = queryValidPathId(*state, i.path);
+            auto referrer = lookupId(i.path);
             for (auto & j : i.references)
-                state->stmts->AddReference.use()(referrer)(queryValidPathId(*state, j)).exec();
+                refs.emplace_back(referrer, lookupId(j));
+        }
+
+        /* Insert the references in multi-row batches, so that large
+           imports scale with page writes rather than per-row
+           statement dispatch. Note: keep the number of bound
+           variables below the conservative SQLITE_MAX_VARIABLE_NUMBER
+           default of 999. */
+        constexpr size_t refsPerBatch = 450;
+
+        auto makeBatchStmt = [&](size_t rows) {
+            std::string sql = "insert or replace into Refs (referrer, reference) values ";
+            for (size_t i = 0; i < rows; ++i)
+                sql += i == 0 ? "(?, ?)" : ", (?, ?)";
+            auto stmt = std::make_unique<SQLiteStmt>();
+            stmt->create(state->db, sql);
+            return stmt;
+        };
+
+        std::unique_ptr<SQLiteStmt> fullBatch;
+
+        for (size_t pos = 0; pos < refs.size(); ) {
+            auto rows = std::min(refsPerBatch, refs.size() - pos);
+            std::unique_ptr<SQLiteStmt> remainder;
+            SQLiteStmt * stmt;
+            if (rows == refsPerBatch) {
+                if (!fullBatch) fullBatch = makeBatchStmt(rows);
+                stmt = fullBatch.get();
+            } else {
+                remainder = makeBatchStmt(rows);
+                stmt = remainder.get();
+            }
+            auto use(stmt->use());
+            for (size_t i = 0; i < rows; ++i)
+                use(refs[pos + i].first)(refs[pos + i].second);
+            use.exec();
+            pos += rows;
         }
 
         /* Check that the derivation outputs are correct.  We can't do
@@ -1012,10 +1155,7 @@ void LocalStore::invalidatePath(State & state, const StorePath & path)
     /* Note that the foreign key constraints on the Refs table take
        care of deleting the references entries for `path'. */
 
-    {
-        auto state_(Store::state.lock());
-        state_->pathInfoCache.erase(std::string(path.to_string()));
-    }
+    pathInfoCache.erase(std::string(path.to_string()));
 }
 
 const PublicKeys & LocalStore::getPublicKeys()
@@ -1028,7 +1168,8 @@ const PublicKeys & LocalStore::getPublicKeys()
 
 bool LocalStore::pathInfoIsUntrusted(const ValidPathInfo & info)
 {
-    return config->requireSigs && !info.checkSignatures(*this, getPublicKeys());
+    /* One valid signature suffices here, so don't verify the rest. */
+    return config->requireSigs && !info.checkSignatures(*this, getPublicKeys(), 1);
 }
 
 bool LocalStore::realisationIsUntrusted(const Realisation & realisation)
@@ -1036,6 +1177,26 @@ bool LocalStore::realisationIsUntrusted(const Realisation & realisation)
     return config->requireSigs && !realisation.checkSignatures(getPublicKeys());
 }
 
+/* Make a freshly restored store path durable, honouring the
+   batch-fsync setting: either sync the containing filesystem in one
+   go, or walk the tree fsync'ing each file. */
+static void syncStorePath(const Path & realPath)
+{
+#ifdef __linux__
+    if (settings.batchFsync) {
+        AutoCloseFD fd = toDescriptor(open(realPath.c_str(), O_RDONLY
+#ifndef _WIN32
+            | O_CLOEXEC
+#endif
+            ));
+        if (fd && syncfs(fd.get()) == 0)
+            return;
+        /* Fall through on failure. */
+    }
+#endif
+    recursiveSync(realPath);
+}
+
 void LocalStore::addToStore(const ValidPathInfo & info, Source & source,
     RepairFlag repair, CheckSigsFlag checkSigs)
 {
@@ -1075,26 +1236,33 @@ void LocalStore::addToStore(const ValidPathInfo & info, Source & source,
 
                 deletePath(realPath);
 
-                /* While restoring the path from the NAR, compute the hash
-                of the NAR. */
-                HashSink hashSink(HashAlgorithm::SHA256);
+                narRead = true;
+
+                if (!config->verifyIncomingPaths) {
+                    /* The sender's database attests the hashes;
+                       restore without re-deriving them. */
+                    restorePath(realPath, source, settings.fsyncStorePaths, /*canonicalise=*/true);
+                } else {
+                    /* While restoring the path from the NAR, compute the hash
+                    of the NAR. */
+                    HashSink hashSink(HashAlgorithm::SHA256);
 
-                TeeSource wrapperSource { source, hashSink };
+                    TeeSource wrapperSource { source, hashSink };
 
-                narRead = true;
-                restorePath(realPath, wrapperSource, settings.fsyncStorePaths);
+                    restorePath(realPath, wrapperSource, settings.fsyncStorePaths, /*canonicalise=*/true);
 
-                auto hashResult = hashSink.finish();
+                    auto hashResult = hashSink.finish();
 
-                if (hashResult.first != info.narHash)
-                    throw Error("hash mismatch importing path '%s';\n  specified: %s\n  got:       %s",
-                                printStorePath(info.path), info.narHash.to_string(HashFormat::Nix32, true), hashResult.first.to_string(HashFormat::Nix32, true));
+                    if (hashResult.first != info.narHash)
+                        throw Error("hash mismatch importing path '%s';\n  specified: %s\n  got:       %s",
+                                    printStorePath(info.path), info.narHash.to_string(HashFormat::Nix32, true), hashResult.first.to_string(HashFormat::Nix32, true));
 
-                if (hashResult.second != info.narSize)
-                    throw Error("size mismatch importing path '%s';\n  specified: %s\n  got:       %s",
-                        printStorePath(info.path), info.narSize, hashResult.second);
+                    if (hashResult.second != info.narSize)
+                        throw Error("size mismatch importing path '%s';\n  specified: %s\n  got:       %s",
+                            printStorePath(info.path), info.narSize, hashResult.second);
+                }
 
-                if (info.ca) {
+                if (info.ca && config->verifyIncomingPaths) {
                     auto & specified = *info.ca;
                     auto actualHash = ({
                         auto accessor = getFSAccessor(false);
@@ -1137,7 +1305,7 @@ void LocalStore::addToStore(const ValidPathInfo & info, Source & source,
                 optimisePath(realPath, repair); // FIXME: combine with hashPath()
 
                 if (settings.fsyncStorePaths) {
-                    recursiveSync(realPath);
+                    syncStorePath(realPath);
                     syncParent(realPath);
                 }
 
@@ -1225,7 +1393,7 @@ StorePath LocalStore::addToStoreFromDump(
         delTempDir = std::make_unique<AutoDelete>(tempDir);
         tempPath = tempDir / "x";
 
-        restorePath(tempPath.string(), bothSource, dumpMethod, settings.fsyncStorePaths);
+        restorePath(tempPath.string(), bothSource, dumpMethod, settings.fsyncStorePaths, /*canonicalise=*/true);
 
         dumpBuffer.reset();
         dump = {};
@@ -1272,7 +1440,7 @@ StorePath LocalStore::addToStoreFromDump(
                 switch (fim) {
                 case FileIngestionMethod::Flat:
                 case FileIngestionMethod::NixArchive:
-                    restorePath(realPath, dumpSource, (FileSerialisationMethod) fim, settings.fsyncStorePaths);
+                    restorePath(realPath, dumpSource, (FileSerialisationMethod) fim, settings.fsyncStorePaths, /*canonicalise=*/true);
                     break;
                 case FileIngestionMethod::Git:
                     // doesn't correspond to serialization method, so
@@ -1298,7 +1466,7 @@ StorePath LocalStore::addToStoreFromDump(
             optimisePath(realPath, repair);
 
             if (settings.fsyncStorePaths) {
-                recursiveSync(realPath);
+                syncStorePath(realPath);
                 syncParent(realPath);
             }
 
@@ -1371,88 +1539,148 @@ bool LocalStore::verifyStore(bool checkContents, RepairFlag repair)
     auto fdGCLock = openGCLock();
     FdLock gcLock(fdGCLock.get(), ltRead, true, "waiting for the big garbage collector lock...");
 
-    auto [errors, validPaths] = verifyAllValidPaths(repair);
+    auto [errors_, validPaths] = verifyAllValidPaths(repair);
+
+    std::atomic<bool> errors{errors_};
 
-    /* Optionally, check the content hashes (slow). */
+    /* Optionally, check the content hashes (slow). Hashing is
+       CPU-bound, so check several paths concurrently on a thread
+       pool; repairs are collected and run serially afterwards. */
     if (checkContents) {
 
         printInfo("checking link hashes...");
 
-        for (auto & link : DirectoryIterator{linksDir}) {
-            checkInterrupt();
-            auto name = link.path().filename();
-            printMsg(lvlTalkative, "checking contents of '%s'", name);
-            PosixSourceAccessor accessor;
-            std::string hash = hashPath(
-                PosixSourceAccessor::createAtRoot(link.path()),
-                FileIngestionMethod::NixArchive, HashAlgorithm::SHA256).first.to_string(HashFormat::Nix32, false);
-            if (hash != name.string()) {
-                printError("link '%s' was modified! expected hash '%s', got '%s'",
-                    link.path(), name, hash);
-                if (repair) {
-                    std::filesystem::remove(link.path());
-                    printInfo("removed link '%s'", link.path());
-                } else {
-                    errors = true;
-                }
+        {
+            ThreadPool pool;
+
+            for (auto & link : DirectoryIterator{linksDir}) {
+                checkInterrupt();
+                pool.enqueue([this, path{link.path()}, repair, &errors]() {
+                    auto name = path.filename();
+                    printMsg(lvlTalkative, "checking contents of '%s'", name);
+                    std::string hash = hashPath(
+                        PosixSourceAccessor::createAtRoot(path),
+                        FileIngestionMethod::NixArchive, HashAlgorithm::SHA256).first.to_string(HashFormat::Nix32, false);
+                    if (hash != name.string()) {
+                        printError("link '%s' was modified! expected hash '%s', got '%s'",
+                            path, name, hash);
+                        if (repair) {
+                            std::filesystem::remove(path);
+                            printInfo("removed link '%s'", path);
+                        } else {
+                            errors = true;
+                        }
+                    }
+                });
             }
+
+            pool.process();
         }
 
         printInfo("checking store hashes...");
 
-        Hash nullHash(HashAlgorithm::SHA256);
+        /* Paths verified by an earlier, interrupted pass are
+           recorded in a checkpoint file (one store path basename per
+           line) and skipped, so a multi-hour verification survives a
+           reboot. The file is removed when the pass completes. */
+        auto checkpointFile = dbDir + "/verify-checkpoint";
 
-        for (auto & i : validPaths) {
-            try {
-                auto info = std::const_pointer_cast<ValidPathInfo>(std::shared_ptr<const ValidPathInfo>(queryPathInfo(i)));
+        StringSet alreadyVerified;
+        if (pathExists(checkpointFile))
+            for (auto & line : tokenizeString<Strings>(readFile(checkpointFile), "\n"))
+                alreadyVerified.insert(line);
 
-                /* Check the content hash (optionally - slow). */
-                printMsg(lvlTalkative, "checking contents of '%s'", printStorePath(i));
+        AutoCloseFD checkpointFd = toDescriptor(open(checkpointFile.c_str(),
+            O_CREAT | O_WRONLY | O_APPEND
+#ifndef _WIN32
+            | O_CLOEXEC
+#endif
+            , 0600));
+        if (!checkpointFd) throw SysError("opening '%s'", checkpointFile);
+        Sync<int> checkpointLock{0};
+
+        auto markVerified = [&](const StorePath & path) {
+            auto line = std::string(path.to_string()) + "\n";
+            auto lock(checkpointLock.lock());
+            writeFull(checkpointFd.get(), line);
+        };
 
-                auto hashSink = HashSink(info->narHash.algo);
+        Sync<StorePathSet> toRepair;
 
-                dumpPath(Store::toRealPath(i), hashSink);
-                auto current = hashSink.finish();
+        {
+            ThreadPool pool;
 
-                if (info->narHash != nullHash && info->narHash != current.first) {
-                    printError("path '%s' was modified! expected hash '%s', got '%s'",
-                               printStorePath(i), info->narHash.to_string(HashFormat::Nix32, true), current.first.to_string(HashFormat::Nix32, true));
-                    if (repair) repairPath(i); else errors = true;
-                } else {
+            for (auto & i : validPaths) {
+                if (alreadyVerified.count(std::string(i.to_string())))
+                    continue;
 
-                    bool update = false;
+                pool.enqueue([this, i, repair, &errors, &toRepair, &markVerified]() {
+                    try {
+                        Hash nullHash(HashAlgorithm::SHA256);
 
-                    /* Fill in missing hashes. */
-                    if (info->narHash == nullHash) {
-                        printInfo("fixing missing hash on '%s'", printStorePath(i));
-                        info->narHash = current.first;
-                        update = true;
-                    }
+                        auto info = std::const_pointer_cast<ValidPathInfo>(std::shared_ptr<const ValidPathInfo>(queryPathInfo(i)));
 
-                    /* Fill in missing narSize fields (from old stores). */
-                    if (info->narSize == 0) {
-                        printInfo("updating size field on '%s' to %s", printStorePath(i), current.second);
-                        info->narSize = current.second;
-                        update = true;
-                    }
+                        /* Check the content hash (optionally - slow). */
+                        printMsg(lvlTalkative, "checking contents of '%s'", printStorePath(i));
 
-                    if (update) {
-                        auto state(_state.lock());
-                        updatePathInfo(*state, *info);
-                    }
+                        auto hashSink = HashSink(info->narHash.algo);
 
-                }
+                        dumpPath(Store::toRealPath(i), hashSink);
+                        auto current = hashSink.finish();
 
-            } catch (Error & e) {
-                /* It's possible that the path got GC'ed, so ignore
-                   errors on invalid paths. */
-                if (isValidPath(i))
-                    logError(e.info());
-                else
-                    warn(e.msg());
-                errors = true;
+                        if (info->narHash != nullHash && info->narHash != current.first) {
+                            printError("path '%s' was modified! expected hash '%s', got '%s'",
+                                       printStorePath(i), info->narHash.to_string(HashFormat::Nix32, true), current.first.to_string(HashFormat::Nix32, true));
+                            if (repair) toRepair.lock()->insert(i); else errors = true;
+                        } else {
+
+                            bool update = false;
+
+                            /* Fill in missing hashes. */
+                            if (info->narHash == nullHash) {
+                                printInfo("fixing missing hash on '%s'", printStorePath(i));
+                                info->narHash = current.first;
+                                update = true;
+                            }
+
+                            /* Fill in missing narSize fields (from old stores). */
+                            if (info->narSize == 0) {
+                                printInfo("updating size field on '%s' to %s", printStorePath(i), current.second);
+                                info->narSize = current.second;
+                                update = true;
+                            }
+
+                            if (update) {
+                                auto state(_state.lock());
+                                updatePathInfo(*state, *info);
+                            }
+
+                            markVerified(i);
+                        }
+
+                    } catch (Error & e) {
+                        /* It's possible that the path got GC'ed, so ignore
+                           errors on invalid paths. */
+                        if (isValidPath(i))
+                            logError(e.info());
+                        else
+                            warn(e.msg());
+                        errors = true;
+                    }
+                });
             }
+
+            pool.process();
         }
+
+        /* Repairing substitutes/rebuilds, so it must not run on the
+           hashing pool. */
+        for (auto & i : *toRepair.lock())
+            repairPath(i);
+
+        /* The pass completed; the next one starts from scratch. */
+        checkpointFd.close();
+        deletePath(checkpointFile);
     }
 
     return errors;
@@ -1660,7 +1888,10 @@ void LocalStore::addBuildLog(const StorePath & drvPath, std::string_view log)
 
     auto baseName = drvPath.to_string();
 
-    auto logPath = fmt("%s/%s/%s/%s.bz2", config->logDir, drvsLogDir, baseName.substr(0, 2), baseName.substr(2));
+    bool zstd = settings.logCompression.get() == "zstd";
+
+    auto logPath = fmt("%s/%s/%s/%s%s", config->logDir, drvsLogDir,
+        baseName.substr(0, 2), baseName.substr(2), zstd ? ".zst" : ".bz2");
 
     if (pathExists(logPath)) return;
 
@@ -1668,7 +1899,7 @@ void LocalStore::addBuildLog(const StorePath & drvPath, std::string_view log)
 
     auto tmpFile = fmt("%s.tmp.%d", logPath, getpid());
 
-    writeFile(tmpFile, compress("bzip2", log));
+    writeFile(tmpFile, compress(zstd ? "zstd" : "bzip2", log));
 
     std::filesystem::rename(tmpFile, logPath);
 }
@@ -9,6 +9,7 @@
 #include "nix/store/realisation.hh"
 #include "nix/util/topo-sort.hh"
 #include "nix/util/callback.hh"
+#include "nix/util/signals.hh"
 #include "nix/util/closure.hh"
 #include "nix/store/filetransfer.hh"
 #include "nix/util/strings.hh"
@@ -18,6 +19,56 @@ namespace nix {
 void Store::computeFSClosure(const StorePathSet & startPaths,
     StorePathSet & paths_, bool flipDirection, bool includeOutputs, bool includeDerivers)
 {
+    if (!flipDirection) {
+        /* Forward closure: level-synchronous BFS over the batched
+           path info query, so each level of the closure costs one
+           daemon round trip instead of one per path. */
+        /* Hashed on the path digest; the frontier is rebuilt every
+           level, so cheap insertion matters. */
+        std::unordered_set<StorePath> frontier;
+        for (auto & path : startPaths)
+            if (!paths_.count(path))
+                frontier.insert(path);
+
+        while (!frontier.empty()) {
+            checkInterrupt();
+
+            auto infos = queryPathInfos(StorePathSet(frontier.begin(), frontier.end()));
+
+            std::unordered_set<StorePath> next;
+
+            auto enqueue = [&](const StorePath & path) {
+                if (!paths_.count(path))
+                    next.insert(path);
+            };
+
+            for (auto & path : frontier) {
+                auto i = infos.find(path);
+                if (i == infos.end())
+                    throw InvalidPath("path '%s' is not valid", printStorePath(path));
+                auto & info = i->second;
+
+                paths_.insert(path);
+
+                for (auto & ref : info->references)
+                    if (ref != path)
+                        enqueue(ref);
+
+                if (includeOutputs && path.isDerivation())
+                    for (auto & [_, maybeOutPath] : queryPartialDerivationOutputMap(path))
+                        if (maybeOutPath && isValidPath(*maybeOutPath))
+                            enqueue(*maybeOutPath);
+
+                if (includeDerivers && info->deriver && isValidPath(*info->deriver))
+                    enqueue(*info->deriver);
+            }
+
+            frontier = std::move(next);
+        }
+
+        return;
+    }
+
     std::function<std::set<StorePath>(const StorePath & path, std::future<ref<const ValidPathInfo>> &)> queryDeps;
     if (flipDirection)
         queryDeps = [&](const StorePath& path,
@@ -223,9 +274,9 @@ void Store::queryMissing(const std::vector<DerivedPath> & targets,
 
             auto drv = make_ref<Derivation>(derivationFromPath(drvPath));
             auto parsedDrv = StructuredAttrs::tryParse(drv->env);
-            DerivationOptions drvOptions;
+            std::shared_ptr<const DerivationOptions> drvOptions;
             try {
-                drvOptions = DerivationOptions::fromStructuredAttrs(
+                drvOptions = DerivationOptions::fromStructuredAttrsShared(
                     drv->env,
                     parsedDrv ? &*parsedDrv : nullptr);
             } catch (Error & e) {
@@ -233,7 +284,7 @@ void Store::queryMissing(const std::vector<DerivedPath> & targets,
                 throw;
             }
 
-            if (!knownOutputPaths && settings.useSubstitutes && drvOptions.substitutesAllowed()) {
+            if (!knownOutputPaths && settings.useSubstitutes && drvOptions->substitutesAllowed()) {
                 experimentalFeatureSettings.require(Xp::CaDerivations);
 
                 // If there are unknown output paths, attempt to find if the
@@ -241,29 +292,37 @@ void Store::queryMissing(const std::vector<DerivedPath> & targets,
                 auto outputHashes = staticOutputHashes(*this, *drv);
                 knownOutputPaths = true;
 
-                for (auto [outputName, hash] : outputHashes) {
+                /* Batch the realisation lookups per substituter
+                   rather than issuing one query per output. */
+                std::set<DrvOutput> wantedOutputs;
+                for (auto & [outputName, hash] : outputHashes)
+                    if (bfd.outputs.contains(outputName))
+                        wantedOutputs.insert(DrvOutput { hash, outputName });
+
+                std::map<DrvOutput, Realisation> foundRealisations;
+                for (auto & sub : getDefaultSubstituters()) {
+                    if (wantedOutputs.empty()) break;
+                    for (auto & [id, realisation] : sub->queryRealisations(wantedOutputs)) {
+                        foundRealisations.insert_or_assign(id, realisation);
+                        wantedOutputs.erase(id);
+                    }
+                }
+
+                for (auto & [outputName, hash] : outputHashes) {
                     if (!bfd.outputs.contains(outputName))
                         continue;
-
-                    bool found = false;
-                    for (auto &sub : getDefaultSubstituters()) {
-                        auto realisation = sub->queryRealisation({hash, outputName});
-                        if (!realisation)
-                            continue;
-                        found = true;
-                        if (!isValidPath(realisation->outPath))
-                            invalid.insert(realisation->outPath);
-                        break;
-                    }
-                    if (!found) {
+                    auto i = foundRealisations.find(DrvOutput { hash, outputName });
+                    if (i == foundRealisations.end()) {
                         // Some paths did not have a realisation, this must be built.
                         knownOutputPaths = false;
                         break;
                     }
+                    if (!isValidPath(i->second.outPath))
+                        invalid.insert(i->second.outPath);
                 }
             }
 
-            if (knownOutputPaths && settings.useSubstitutes && drvOptions.substitutesAllowed()) {
+            if (knownOutputPaths && settings.useSubstitutes && drvOptions->substitutesAllowed()) {
                 auto drvState = make_ref<Sync<DrvState>>(DrvState(invalid.size()));
                 for (auto & output : invalid)
                     pool.enqueue(std::bind(checkOutput, drvPath, drv, output, drvState));
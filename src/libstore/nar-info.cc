@@ -16,7 +16,7 @@ NarInfo::NarInfo(const Store & store, const std::string & s, const std::string &
             std::string(reason) + (line > 0 ? " at line " + std::to_string(line) : ""));
     };
 
-    auto parseHashField = [&](const std::string & s) {
+    auto parseHashField = [&](std::string_view s) {
         try {
             return Hash::parseAnyPrefixed(s);
         } catch (BadHash &) {
@@ -33,21 +33,23 @@ NarInfo::NarInfo(const Store & store, const std::string & s, const std::string &
         size_t colon = s.find(':', pos);
         if (colon == s.npos) throw corrupt("expecting ':'");
 
-        std::string name(s, pos, colon - pos);
+        /* Views into the input; only the fields that are kept get
+           copied, which matters at substitution-storm parse rates. */
+        std::string_view name(s.data() + pos, colon - pos);
 
         size_t eol = s.find('\n', colon + 2);
         if (eol == s.npos) throw corrupt("expecting '\\n'");
 
-        std::string value(s, colon + 2, eol - colon - 2);
+        std::string_view value(s.data() + colon + 2, eol - colon - 2);
 
         if (name == "StorePath") {
             path = store.parseStorePath(value);
             havePath = true;
         }
         else if (name == "URL")
-            url = value;
+            url = std::string(value);
         else if (name == "Compression")
-            compression = value;
+            compression = std::string(value);
         else if (name == "FileHash")
             fileHash = parseHashField(value);
         else if (name == "FileSize") {
@@ -55,6 +57,16 @@ NarInfo::NarInfo(const Store & store, const std::string & s, const std::string &
             if (!n) throw corrupt("invalid FileSize");
             fileSize = *n;
         }
+        else if (name == "ClosureNarSize") {
+            auto n = string2Int<decltype(closureNarSize)>(value);
+            if (!n) throw corrupt("invalid ClosureNarSize");
+            closureNarSize = *n;
+        }
+        else if (name == "ClosureFileSize") {
+            auto n = string2Int<decltype(closureFileSize)>(value);
+            if (!n) throw corrupt("invalid ClosureFileSize");
+            closureFileSize = *n;
+        }
         else if (name == "NarHash") {
             narHash = parseHashField(value);
             haveNarHash = true;
@@ -75,7 +87,7 @@ NarInfo::NarInfo(const Store & store, const std::string & s, const std::string &
                 deriver = StorePath(value);
         }
         else if (name == "Sig")
-            sigs.insert(value);
+            sigs.insert(std::string(value));
         else if (name == "CA") {
             if (ca) throw corrupt("extra CA");
             // FIXME: allow blank ca or require skipping field?
@@ -113,6 +125,11 @@ std::string NarInfo::to_string(const Store & store) const
     res += "NarHash: " + narHash.to_string(HashFormat::Nix32, true) + "\n";
     res += "NarSize: " + std::to_string(narSize) + "\n";
 
+    if (closureNarSize)
+        res += "ClosureNarSize: " + std::to_string(closureNarSize) + "\n";
+    if (closureFileSize)
+        res += "ClosureFileSize: " + std::to_string(closureFileSize) + "\n";
+
     res += "References: " + concatStringsSep(" ", shortRefs()) + "\n";
 
     if (deriver)
@@ -145,6 +162,10 @@ nlohmann::json NarInfo::toJSON(
             jsonObject["downloadHash"] = fileHash->to_string(hashFormat, true);
         if (fileSize)
             jsonObject["downloadSize"] = fileSize;
+        if (closureNarSize)
+            jsonObject["closureNarSize"] = closureNarSize;
+        if (closureFileSize)
+            jsonObject["closureDownloadSize"] = closureFileSize;
     }
 
     return jsonObject;
@@ -178,6 +199,12 @@ NarInfo NarInfo::fromJSON(
     if (json.contains("downloadSize"))
         res.fileSize = getUnsigned(valueAt(json, "downloadSize"));
 
+    if (json.contains("closureNarSize"))
+        res.closureNarSize = getUnsigned(valueAt(json, "closureNarSize"));
+
+    if (json.contains("closureDownloadSize"))
+        res.closureFileSize = getUnsigned(valueAt(json, "closureDownloadSize"));
+
     return res;
 }
 
@@ -3,6 +3,7 @@
 #include "nix/util/signals.hh"
 #include "nix/store/posix-fs-canonicalise.hh"
 #include "nix/util/posix-source-accessor.hh"
+#include "nix/util/thread-pool.hh"
 
 #include <cstdlib>
 #include <cstring>
@@ -64,7 +65,7 @@ LocalStore::InodeHash LocalStore::loadInodeHash()
 }
 
 
-Strings LocalStore::readDirectoryIgnoringInodes(const Path & path, const InodeHash & inodeHash)
+Strings LocalStore::readDirectoryIgnoringInodes(const Path & path, InodeHash & inodeHash)
 {
     Strings names;
 
@@ -223,7 +224,8 @@ void LocalStore::optimisePath_(Activity * act, OptimiseStats & stats,
        its timestamp back to 0. */
     MakeReadOnly makeReadOnly(mustToggle ? dirOfPath : "");
 
-    std::filesystem::path tempLink = fmt("%1%/.tmp-link-%2%-%3%", config->realStoreDir, getpid(), rand());
+    static std::atomic<unsigned int> tempLinkCounter{0};
+    std::filesystem::path tempLink = fmt("%1%/.tmp-link-%2%-%3%", config->realStoreDir, getpid(), tempLinkCounter++);
 
     try {
         std::filesystem::create_hard_link(linkPath, tempLink);
@@ -276,20 +278,46 @@ void LocalStore::optimiseStore(OptimiseStats & stats)
     auto paths = queryAllValidPaths();
     InodeHash inodeHash = loadInodeHash();
 
+    /* Paths registered before the previous completed pass have
+       already been optimised: store objects are immutable, so
+       there's no point rehashing them every week. */
+    auto timestampFile = linksDir + "/.last-optimise";
+    time_t lastOptimise = 0;
+    if (pathExists(timestampFile))
+        if (auto t = string2Int<time_t>(trim(readFile(timestampFile))))
+            lastOptimise = *t;
+
+    auto startTime = time(0);
+
     act.progress(0, paths.size());
 
-    uint64_t done = 0;
+    std::atomic<uint64_t> done{0};
+
+    ThreadPool pool;
 
     for (auto & i : paths) {
         addTempRoot(i);
         if (!isValidPath(i)) continue; /* path was GC'ed, probably */
-        {
-            Activity act(*logger, lvlTalkative, actUnknown, fmt("optimising path '%s'", printStorePath(i)));
-            optimisePath_(&act, stats, config->realStoreDir + "/" + std::string(i.to_string()), inodeHash, NoRepair);
+
+        if (lastOptimise) {
+            try {
+                if (queryPathInfo(i)->registrationTime < lastOptimise) {
+                    act.progress(++done, paths.size());
+                    continue;
+                }
+            } catch (InvalidPath &) { continue; }
         }
-        done++;
-        act.progress(done, paths.size());
+
+        pool.enqueue([this, i, &stats, &inodeHash, &act, &done, total{paths.size()}]() {
+            Activity act2(*logger, lvlTalkative, actUnknown, fmt("optimising path '%s'", printStorePath(i)));
+            optimisePath_(&act2, stats, config->realStoreDir + "/" + std::string(i.to_string()), inodeHash, NoRepair);
+            act.progress(++done, total);
+        });
     }
+
+    pool.process();
+
+    writeFile(timestampFile, fmt("%d", startTime));
 }
 
 void LocalStore::optimiseStore()
@@ -300,7 +328,7 @@ void LocalStore::optimiseStore()
 
     printInfo("%s freed by hard-linking %d files",
         showBytes(stats.bytesFreed),
-        stats.filesLinked);
+        stats.filesLinked.load());
 }
 
 void LocalStore::optimisePath(const Path & path, RepairFlag repair)
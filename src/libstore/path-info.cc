@@ -104,14 +104,17 @@ bool ValidPathInfo::isContentAddressed(const Store & store) const
 }
 
 
-size_t ValidPathInfo::checkSignatures(const Store & store, const PublicKeys & publicKeys) const
+size_t ValidPathInfo::checkSignatures(const Store & store, const PublicKeys & publicKeys, size_t enough) const
 {
     if (isContentAddressed(store)) return maxSigs;
 
     size_t good = 0;
     for (auto & sig : sigs)
-        if (checkSignature(store, publicKeys, sig))
+        if (checkSignature(store, publicKeys, sig)) {
             good++;
+            if (good >= enough)
+                break;
+        }
     return good;
 }
 
@@ -1,6 +1,10 @@
 #include <nlohmann/json.hpp>
 #include "nix/store/remote-fs-accessor.hh"
 #include "nix/store/nar-accessor.hh"
+#include "nix/store/binary-cache-store.hh"
+#include "nix/store/nar-info.hh"
+#include "nix/util/users.hh"
+#include "nix/util/util.hh"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -15,12 +19,21 @@ RemoteFSAccessor::RemoteFSAccessor(ref<Store> store, bool requireValidPath, cons
 {
     if (cacheDir != "")
         createDirs(cacheDir);
+
+    listingCacheDir = cacheDir != "" ? cacheDir : getCacheDir() + "/nar-listings";
+    try {
+        createDirs(listingCacheDir);
+    } catch (...) {
+        listingCacheDir.clear();
+        ignoreExceptionExceptInterrupt();
+    }
 }
 
 Path RemoteFSAccessor::makeCacheFile(std::string_view hashPart, const std::string & ext)
 {
-    assert(cacheDir != "");
-    return fmt("%s/%s.%s", cacheDir, hashPart, ext);
+    auto & dir = ext == "ls" ? listingCacheDir : cacheDir;
+    assert(dir != "");
+    return fmt("%s/%s.%s", dir, hashPart, ext);
 }
 
 ref<SourceAccessor> RemoteFSAccessor::addToCache(std::string_view hashPart, std::string && nar)
@@ -37,7 +50,7 @@ ref<SourceAccessor> RemoteFSAccessor::addToCache(std::string_view hashPart, std:
     auto narAccessor = makeNarAccessor(std::move(nar));
     nars.emplace(hashPart, narAccessor);
 
-    if (cacheDir != "") {
+    if (listingCacheDir != "") {
         try {
             nlohmann::json j = listNar(narAccessor, CanonPath::root, true);
             writeFile(makeCacheFile(hashPart, "ls"), j.dump());
@@ -100,6 +113,73 @@ std::pair<ref<SourceAccessor>, CanonPath> RemoteFSAccessor::fetch(const CanonPat
         } catch (SystemError &) { }
     }
 
+    /* If the store is a binary cache that serves this path as an
+       uncompressed NAR and supports ranged reads, read through the
+       NAR listing and fetch only the bytes we need, instead of
+       downloading and unpacking the whole NAR (which can be hundreds
+       of megabytes for a single small file). */
+    if (auto bcStore = store.dynamic_pointer_cast<BinaryCacheStore>()) {
+        if (bcStore->supportsFileRanges()) {
+            try {
+                auto info = std::dynamic_pointer_cast<const NarInfo>(
+                    std::shared_ptr<const ValidPathInfo>(store->queryPathInfo(storePath)));
+                /* Chunked NARs also advertise "none" compression,
+                   but their URL points at the chunk manifest, not a
+                   NAR that byte ranges can be served from. */
+                if (info && info->compression == "none" && !hasSuffix(info->url, ".chunks")) {
+                    if (auto listing = bcStore->getFile(std::string(storePath.hashPart()) + ".ls")) {
+                        /* The published .ls file wraps the listing
+                           in a version envelope. */
+                        auto json = nlohmann::json::parse(*listing);
+                        if (json.at("version") != 1)
+                            throw Error("unsupported NAR listing version in binary cache");
+                        auto url = info->url;
+                        auto narAccessor = makeLazyNarAccessor(json.at("root").dump(),
+                            [bcStore, url](uint64_t offset, uint64_t length) {
+                                return bcStore->getFileRange(url, offset, length);
+                            });
+                        nars.emplace(storePath.hashPart(), narAccessor);
+                        return {narAccessor, restPath};
+                    }
+                }
+            } catch (InvalidPath &) {
+            } catch (NoSuchBinaryCacheFile &) {
+            } catch (std::exception &) {
+                /* E.g. a malformed listing; fall back to fetching
+                   the whole NAR. */
+                ignoreExceptionExceptInterrupt();
+            }
+        }
+    }
+
+    /* A cached listing alone still serves all metadata access
+       (stat, ls) without fetching the NAR; file contents trigger a
+       single in-memory fetch of the whole NAR on first use. */
+    if (listingCacheDir != "") {
+        try {
+            auto listing = nix::readFile(makeCacheFile(storePath.hashPart(), "ls"));
+            auto narCache = std::make_shared<std::optional<std::string>>();
+            auto store2 = store;
+            auto storePath2 = storePath;
+            auto narAccessor = makeLazyNarAccessor(listing,
+                [store2, storePath2, narCache](uint64_t offset, uint64_t length) {
+                    if (!*narCache) {
+                        StringSink sink;
+                        store2->narFromPath(storePath2, sink);
+                        *narCache = std::move(sink.s);
+                    }
+                    if (offset + length > (*narCache)->size())
+                        throw Error("NAR of '%s' is shorter than expected", storePath2.to_string());
+                    return (*narCache)->substr(offset, length);
+                });
+            nars.emplace(storePath.hashPart(), narAccessor);
+            return {narAccessor, restPath};
+        } catch (SystemError &) {
+        } catch (std::exception &) {
+            ignoreExceptionExceptInterrupt();
+        }
+    }
+
     StringSink sink;
     store->narFromPath(storePath, sink);
     return {addToCache(storePath.hashPart(), std::move(sink.s)), restPath};
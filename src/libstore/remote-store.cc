@@ -73,11 +73,14 @@ void RemoteStore::initConnection(Connection & conn)
         StringSink saved;
         TeeSource tee(conn.from, saved);
         try {
+            auto expected = expectedProtoVersion.load();
             auto [protoVersion, features] = WorkerProto::BasicClientConnection::handshake(
                 conn.to, tee, PROTOCOL_VERSION,
-                WorkerProto::allFeatures);
+                WorkerProto::allFeatures,
+                expected ? std::optional(expected) : std::nullopt);
             conn.protoVersion = protoVersion;
             conn.features = features;
+            expectedProtoVersion = protoVersion;
         } catch (SerialisationError & e) {
             /* In case the other side is waiting for our input, close
                it. */
@@ -156,9 +159,31 @@ RemoteStore::ConnectionHandle::~ConnectionHandle()
 void RemoteStore::ConnectionHandle::processStderr(Sink * sink, Source * source, bool flush, bool block)
 {
     handle->processStderr(&daemonException, sink, source, flush, block);
+    /* Non-blocking calls are mid-operation polls (framed sends), not
+       the end of the op. */
+    if (block)
+        noteWorkerOpEnd();
 }
 
 
+RemoteStore::~RemoteStore()
+{
+    maybeDumpWorkerOpStats();
+}
+
+std::optional<std::chrono::microseconds> RemoteStore::ping()
+{
+    auto conn(getConnection());
+    if (GET_PROTOCOL_MINOR(conn->protoVersion) < 39)
+        return std::nullopt;
+    auto start = std::chrono::steady_clock::now();
+    conn->to << WorkerProto::Op::Ping;
+    conn.processStderr();
+    readInt(conn->from);
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+}
+
 RemoteStore::ConnectionHandle RemoteStore::getConnection()
 {
     return ConnectionHandle(connections->get());
@@ -287,6 +312,37 @@ void RemoteStore::queryPathInfoUncached(const StorePath & path,
 }
 
 
+std::map<StorePath, ref<const ValidPathInfo>> RemoteStore::queryPathInfos(const StorePathSet & paths)
+{
+    {
+        auto conn(getConnection());
+
+        if (GET_PROTOCOL_MINOR(conn->protoVersion) >= 39) {
+            conn->to << WorkerProto::Op::QueryPathInfos;
+            WorkerProto::write(*this, *conn, paths);
+            conn.processStderr();
+
+            std::map<StorePath, ref<const ValidPathInfo>> res;
+            auto count = readNum<uint64_t>(conn->from);
+            while (count--) {
+                auto path = parseStorePath(readString(conn->from));
+                auto info = make_ref<ValidPathInfo>(
+                    StorePath{path},
+                    WorkerProto::Serialise<UnkeyedValidPathInfo>::read(*this, *conn));
+                pathInfoCache.upsert(std::string(path.to_string()), PathInfoCacheValue { .value = info.get_ptr() });
+                res.insert_or_assign(std::move(path), std::move(info));
+            }
+            return res;
+        }
+
+        /* Release the connection before falling back, since the
+           per-path queries acquire their own. */
+    }
+
+    return Store::queryPathInfos(paths);
+}
+
+
 void RemoteStore::queryReferrers(const StorePath & path,
     StorePathSet & referrers)
 {
@@ -601,6 +657,49 @@ void RemoteStore::registerDrvOutput(const Realisation & info)
     conn.processStderr();
 }
 
+std::map<DrvOutput, Realisation> RemoteStore::queryRealisations(const std::set<DrvOutput> & ids)
+{
+    {
+        auto conn(getConnection());
+
+        if (GET_PROTOCOL_MINOR(conn->protoVersion) >= 39) {
+            conn->to << WorkerProto::Op::QueryRealisations;
+            conn->to << ids.size();
+            for (auto & id : ids)
+                conn->to << id.to_string();
+            conn.processStderr();
+
+            std::map<DrvOutput, Realisation> res;
+            auto count = readNum<uint64_t>(conn->from);
+            while (count--) {
+                auto realisation = WorkerProto::Serialise<Realisation>::read(*this, *conn);
+                res.insert_or_assign(realisation.id, std::move(realisation));
+            }
+            return res;
+        }
+    }
+
+    /* Old daemons: fall back to per-output queries (after releasing
+       the connection, which they acquire themselves). */
+    return Store::queryRealisations(ids);
+}
+
+nlohmann::json RemoteStore::memoryStats()
+{
+    {
+        auto conn(getConnection());
+
+        if (GET_PROTOCOL_MINOR(conn->protoVersion) >= 39) {
+            conn->to << WorkerProto::Op::QueryMemoryStats;
+            conn.processStderr();
+            return nlohmann::json::parse(readString(conn->from));
+        }
+    }
+
+    /* Old daemons can't report theirs; report this process's. */
+    return Store::memoryStats();
+}
+
 void RemoteStore::queryRealisationUncached(const DrvOutput & id,
     Callback<std::shared_ptr<const Realisation>> callback) noexcept
 {
@@ -821,10 +920,7 @@ void RemoteStore::collectGarbage(const GCOptions & options, GCResults & results)
     results.bytesFreed = readLongLong(conn->from);
     readLongLong(conn->from); // obsolete
 
-    {
-        auto state_(Store::state.lock());
-        state_->pathInfoCache.clear();
-    }
+    pathInfoCache.clear();
 }
 
 
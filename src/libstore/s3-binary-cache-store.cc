@@ -26,6 +26,7 @@
 #include <aws/s3/S3Client.h>
 #include <aws/s3/model/GetObjectRequest.h>
 #include <aws/s3/model/HeadObjectRequest.h>
+#include <aws/s3/model/DeleteObjectRequest.h>
 #include <aws/s3/model/ListObjectsRequest.h>
 #include <aws/s3/model/PutObjectRequest.h>
 #include <aws/transfer/TransferManager.h>
@@ -178,7 +179,8 @@ ref<Aws::Client::ClientConfiguration> S3Helper::makeConfig(
 }
 
 S3Helper::FileTransferResult S3Helper::getObject(
-    const std::string & bucketName, const std::string & key)
+    const std::string & bucketName, const std::string & key,
+    const std::string & range)
 {
     std::string uri = "s3://" + bucketName + "/" + key;
     Activity act(*logger, lvlTalkative, actFileTransfer,
@@ -190,6 +192,9 @@ S3Helper::FileTransferResult S3Helper::getObject(
         .WithBucket(bucketName)
         .WithKey(key);
 
+    if (range != "")
+        request.SetRange(range);
+
     request.SetResponseStreamFactory([&]() {
         return Aws::New<std::stringstream>("STRINGSTREAM");
     });
@@ -379,7 +384,8 @@ struct S3BinaryCacheStoreImpl : virtual S3BinaryCacheStore
         auto size = istream->tellg();
         istream->seekg(0, istream->beg);
 
-        auto maxThreads = std::thread::hardware_concurrency();
+        auto maxThreads =
+            config->uploadThreads ? config->uploadThreads.get() : std::thread::hardware_concurrency();
 
         static std::shared_ptr<Aws::Utils::Threading::PooledThreadExecutor>
             executor = std::make_shared<Aws::Utils::Threading::PooledThreadExecutor>(maxThreads);
@@ -391,6 +397,10 @@ struct S3BinaryCacheStoreImpl : virtual S3BinaryCacheStore
 
                 transferConfig.s3Client = s3Helper.client;
                 transferConfig.bufferSize = config->bufferSize;
+                /* The default heap limit only lets a few parts be in
+                   flight, leaving most of the executor's threads
+                   idle; allow one buffered part per upload thread. */
+                transferConfig.transferBufferMaxHeapSize = maxThreads * config->bufferSize;
 
                 transferConfig.uploadProgressCallback =
                     [](const TransferManager * transferManager,
@@ -538,6 +548,39 @@ struct S3BinaryCacheStoreImpl : virtual S3BinaryCacheStore
             throw NoSuchBinaryCacheFile("file '%s' does not exist in binary cache '%s'", path, getUri());
     }
 
+    bool supportsFileRanges() override
+    { return true; }
+
+    std::string getFileRange(const std::string & path, uint64_t offset, uint64_t length) override
+    {
+        stats.get++;
+
+        auto res = s3Helper.getObject(config->bucketName, path,
+            fmt("bytes=%d-%d", offset, offset + length - 1));
+
+        if (!res.data)
+            throw NoSuchBinaryCacheFile("file '%s' does not exist in binary cache '%s'", path, getUri());
+
+        stats.getBytes += res.data->size();
+        stats.getTimeMs += res.durationMs;
+
+        /* An endpoint that ignores the range returns the whole
+           object. */
+        if (res.data->size() > length)
+            *res.data = res.data->substr(offset, length);
+
+        return std::move(*res.data);
+    }
+
+    void deleteFile(const std::string & path) override
+    {
+        checkAws(fmt("AWS error deleting '%s'", path),
+            s3Helper.client->DeleteObject(
+                Aws::S3::Model::DeleteObjectRequest()
+                .WithBucket(config->bucketName)
+                .WithKey(path)));
+    }
+
     StorePathSet queryAllValidPaths() override
     {
         StorePathSet paths;
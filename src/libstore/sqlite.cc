@@ -93,7 +93,15 @@ SQLite::~SQLite()
 void SQLite::isCache()
 {
     exec("pragma synchronous = off");
-    exec("pragma main.journal_mode = truncate");
+    /* WAL mode lets concurrent processes read the cache while one of
+       them writes, instead of serialising on the rollback journal's
+       exclusive locks. Losing the last few writes in a crash is fine
+       for a cache. */
+    exec("pragma main.journal_mode = wal");
+    /* Read through a shared file mapping, so concurrent processes
+       share one warm image of the cache in the page cache instead of
+       each keeping a private copy of the hot pages. */
+    exec("pragma mmap_size = 268435456");
 }
 
 void SQLite::exec(const std::string & stmt)
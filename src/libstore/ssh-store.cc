@@ -19,6 +19,15 @@ SSHStoreConfig::SSHStoreConfig(
     , RemoteStore::Config{params}
     , CommonSSHStoreConfig{scheme, authority, params}
 {
+    /* Unlike the local daemon case, a single connection here is a
+       single muxed SSH channel, and every operation on it serializes
+       behind that channel's flow-control window. Multiple connections
+       share one SSH master (see the `SSHStore` constructor), so extra
+       connections are cheap channels, not extra handshakes, and let
+       parallel copies to a builder actually fill the link. Connections
+       are load-balanced and health-checked (stream state, age) by the
+       pool in `RemoteStore`. */
+    maxConnections.setDefault(4);
 }
 
 
@@ -94,6 +103,9 @@ MountedSSHStoreConfig::MountedSSHStoreConfig(StringMap params)
     , SSHStoreConfig(params)
     , LocalFSStoreConfig(params)
 {
+    /* This delegation skips the `SSHStoreConfig` constructor body, so
+       repeat its channel-pool default here. */
+    maxConnections.setDefault(4);
 }
 
 MountedSSHStoreConfig::MountedSSHStoreConfig(std::string_view scheme, std::string_view host, StringMap params)
@@ -19,10 +19,23 @@
 #include "nix/store/worker-protocol.hh"
 #include "nix/util/signals.hh"
 #include "nix/util/users.hh"
+#include "nix/util/finally.hh"
 
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <future>
+#include <thread>
 #include <nlohmann/json.hpp>
 
+#include <sqlite3.h>
+#ifdef __GLIBC__
+# include <malloc.h>
+#endif
+#ifdef __linux__
+# include <unistd.h>
+#endif
+
 #include "nix/util/strings.hh"
 
 using json = nlohmann::json;
@@ -211,6 +224,23 @@ StorePath Store::addToStore(
         fsm = FileSerialisationMethod::NixArchive;
         break;
     }
+    /* Early-dedup gate: hashing the source (a read-only pass) is
+       much cheaper than dumping it through the store's write path,
+       so compute the store path first and skip the dump entirely
+       when it's already valid. Unchanged re-imports then do no
+       writes at all. */
+    if (repair == NoRepair) {
+        try {
+            auto [expectedPath, _] = computeStorePath(name, path, method, hashAlgo, references, filter);
+            addTempRoot(expectedPath);
+            if (isValidPath(expectedPath))
+                return expectedPath;
+        } catch (Error &) {
+            /* E.g. an unhashable source; let the dump below report
+               it properly. */
+        }
+    }
+
     std::optional<StorePath> storePath;
     auto sink = sourceToSink([&](Source & source) {
         LengthSource lengthSource(source);
@@ -298,7 +328,10 @@ void Store::addMultipleToStore(
 
             nrDone++;
             showProgress();
-        });
+        },
+
+        /* Respect the destination's transfer profile. */
+        config.maxCopyStreams);
 }
 
 void Store::addMultipleToStore(
@@ -307,6 +340,78 @@ void Store::addMultipleToStore(
     CheckSigsFlag checkSigs)
 {
     auto expected = readNum<uint64_t>(source);
+
+    /* Pipeline the import: this thread deframes the stream (the
+       NAR length is known from the path info), while a consumer
+       thread hashes, unpacks and registers the paths in stream
+       order (the stream is topologically sorted), with a bounded
+       buffer for backpressure. This keeps the socket busy while
+       the store does CPU and disk work. */
+    struct Item
+    {
+        ValidPathInfo info;
+        std::string nar;
+    };
+
+    struct PipeState
+    {
+        std::deque<std::unique_ptr<Item>> queue;
+        uint64_t queuedBytes = 0;
+        /* Whether the consumer is in the middle of adding an item. */
+        bool busy = false;
+        bool done = false;
+        std::exception_ptr exc;
+    };
+
+    constexpr uint64_t maxQueuedBytes = 128 * 1024 * 1024;
+
+    Sync<PipeState> state_;
+    std::condition_variable avail, drain;
+
+    std::thread consumer([&]() {
+        try {
+            while (true) {
+                std::unique_ptr<Item> item;
+                {
+                    auto state(state_.lock());
+                    while (state->queue.empty() && !state->done)
+                        state.wait(avail);
+                    if (state->queue.empty()) return;
+                    item = std::move(state->queue.front());
+                    state->queue.pop_front();
+                    state->queuedBytes -= item->nar.size();
+                    state->busy = true;
+                }
+                drain.notify_one();
+
+                StringSource narSource { item->nar };
+                addToStore(item->info, narSource, repair, checkSigs);
+
+                {
+                    auto state(state_.lock());
+                    state->busy = false;
+                }
+                drain.notify_one();
+            }
+        } catch (...) {
+            auto state(state_.lock());
+            state->exc = std::current_exception();
+            state->done = true;
+            drain.notify_one();
+        }
+    });
+
+    Finally joinConsumer([&]() {
+        if (consumer.joinable()) {
+            {
+                auto state(state_.lock());
+                state->done = true;
+            }
+            avail.notify_all();
+            consumer.join();
+        }
+    });
+
     for (uint64_t i = 0; i < expected; ++i) {
         // FIXME we should not be using the worker protocol here, let
         // alone the worker protocol with a hard-coded version!
@@ -316,7 +421,46 @@ void Store::addMultipleToStore(
                 .version = 16,
             });
         info.ultimate = false;
-        addToStore(info, source, repair, checkSigs);
+
+        /* NARs too large to buffer are streamed straight into the
+           store from this thread. The stream is topologically
+           sorted, so the pipeline must be drained first to keep the
+           dependencies-before-referrers order. */
+        if (info.narSize > maxQueuedBytes) {
+            {
+                auto state(state_.lock());
+                while (!state->done && (!state->queue.empty() || state->busy))
+                    state.wait(drain);
+                if (state->exc) std::rethrow_exception(state->exc);
+            }
+            addToStore(info, source, repair, checkSigs);
+            continue;
+        }
+
+        auto item = std::make_unique<Item>(Item { .info = std::move(info), .nar = {} });
+        item->nar.resize(item->info.narSize);
+        source(item->nar.data(), item->nar.size());
+
+        {
+            auto state(state_.lock());
+            while (!state->done && state->queuedBytes > maxQueuedBytes)
+                state.wait(drain);
+            if (state->exc) std::rethrow_exception(state->exc);
+            state->queuedBytes += item->nar.size();
+            state->queue.push_back(std::move(item));
+        }
+        avail.notify_one();
+    }
+
+    {
+        auto state(state_.lock());
+        state->done = true;
+    }
+    avail.notify_all();
+    consumer.join();
+    {
+        auto state(state_.lock());
+        if (state->exc) std::rethrow_exception(state->exc);
     }
 }
 
@@ -437,7 +581,7 @@ StringSet Store::Config::getDefaultSystemFeatures()
 Store::Store(const Store::Config & config)
     : MixStoreDirMethods{config}
     , config{config}
-    , state({(size_t) config.pathInfoCacheSize})
+    , pathInfoCache((size_t) config.pathInfoCacheSize)
 {
     assertLibStoreInitialized();
 }
@@ -570,8 +714,7 @@ void Store::querySubstitutablePathInfos(const StorePathCAMap & paths, Substituta
 bool Store::isValidPath(const StorePath & storePath)
 {
     {
-        auto state_(state.lock());
-        auto res = state_->pathInfoCache.get(storePath.to_string());
+        auto res = pathInfoCache.get(storePath.to_string());
         if (res && res->isKnownNow()) {
             stats.narInfoReadAverted++;
             return res->didExist();
@@ -582,8 +725,7 @@ bool Store::isValidPath(const StorePath & storePath)
         auto res = diskCache->lookupNarInfo(getUri(), std::string(storePath.hashPart()));
         if (res.first != NarInfoDiskCache::oUnknown) {
             stats.narInfoReadAverted++;
-            auto state_(state.lock());
-            state_->pathInfoCache.upsert(storePath.to_string(),
+            pathInfoCache.upsert(storePath.to_string(),
                 res.first == NarInfoDiskCache::oInvalid ? PathInfoCacheValue{} : PathInfoCacheValue { .value = res.second });
             return res.first == NarInfoDiskCache::oValid;
         }
@@ -612,6 +754,59 @@ bool Store::isValidPathUncached(const StorePath & path)
 }
 
 
+std::map<StorePath, ref<const ValidPathInfo>> Store::queryPathInfos(const StorePathSet & paths)
+{
+    /* Stores with a native batched operation (the daemon protocol)
+       override this. Here the queries are issued through the async
+       interface and awaited together, so stores whose lookups go
+       over the network (binary caches) run them concurrently
+       instead of one round trip at a time. */
+    struct State
+    {
+        size_t left;
+        std::map<StorePath, ref<const ValidPathInfo>> res;
+        std::exception_ptr exc;
+    };
+
+    Sync<State> state_(State{paths.size(), {}, nullptr});
+    std::condition_variable wakeup;
+
+    for (auto & path : paths)
+        queryPathInfo(path, {[&, path](std::future<ref<const ValidPathInfo>> fut) {
+            auto state(state_.lock());
+            state->left--;
+            try {
+                state->res.insert_or_assign(path, fut.get());
+            } catch (InvalidPath &) {
+            } catch (...) {
+                state->exc = std::current_exception();
+            }
+            wakeup.notify_one();
+        }});
+
+    auto state(state_.lock());
+    while (state->left)
+        state.wait(wakeup);
+    if (state->exc)
+        std::rethrow_exception(state->exc);
+    return std::move(state->res);
+}
+
+void Store::forEachValidPath(std::function<void(const StorePath &)> callback)
+{
+    for (auto & path : queryAllValidPaths())
+        callback(path);
+}
+
+std::map<DrvOutput, Realisation> Store::queryRealisations(const std::set<DrvOutput> & ids)
+{
+    std::map<DrvOutput, Realisation> res;
+    for (auto & id : ids)
+        if (auto realisation = queryRealisation(id))
+            res.insert_or_assign(id, *realisation);
+    return res;
+}
+
 ref<const ValidPathInfo> Store::queryPathInfo(const StorePath & storePath)
 {
     std::promise<ref<const ValidPathInfo>> promise;
@@ -642,7 +837,7 @@ std::optional<std::shared_ptr<const ValidPathInfo>> Store::queryPathInfoFromClie
     auto hashPart = std::string(storePath.hashPart());
 
     {
-        auto res = state.lock()->pathInfoCache.get(storePath.to_string());
+        auto res = pathInfoCache.get(storePath.to_string());
         if (res && res->isKnownNow()) {
             stats.narInfoReadAverted++;
             if (res->didExist())
@@ -657,8 +852,7 @@ std::optional<std::shared_ptr<const ValidPathInfo>> Store::queryPathInfoFromClie
         if (res.first != NarInfoDiskCache::oUnknown) {
             stats.narInfoReadAverted++;
             {
-                auto state_(state.lock());
-                state_->pathInfoCache.upsert(storePath.to_string(),
+                pathInfoCache.upsert(storePath.to_string(),
                     res.first == NarInfoDiskCache::oInvalid ? PathInfoCacheValue{} : PathInfoCacheValue{ .value = res.second });
                 if (res.first == NarInfoDiskCache::oInvalid ||
                     !goodStorePath(storePath, res.second->path))
@@ -700,10 +894,7 @@ void Store::queryPathInfo(const StorePath & storePath,
                 if (diskCache)
                     diskCache->upsertNarInfo(getUri(), hashPart, info);
 
-                {
-                    auto state_(state.lock());
-                    state_->pathInfoCache.upsert(storePath.to_string(), PathInfoCacheValue { .value = info });
-                }
+                pathInfoCache.upsert(storePath.to_string(), PathInfoCacheValue { .value = info });
 
                 if (!info || !goodStorePath(storePath, info->path)) {
                     stats.narInfoMissing++;
@@ -933,11 +1124,48 @@ StorePathSet Store::exportReferences(const StorePathSet & storePaths, const Stor
 
 const Store::Stats & Store::getStats()
 {
+    stats.pathInfoCacheSize = pathInfoCache.size();
+    return stats;
+}
+
+
+nlohmann::json Store::memoryStats()
+{
+    nlohmann::json res;
+
+    res["pathInfoCache"] = {
+        {"entries", pathInfoCache.size()},
+        {"capacity", config.pathInfoCacheSize.get()},
+    };
+
+    res["sqlite"] = {
+        {"bytesUsed", sqlite3_memory_used()},
+        {"bytesHighwater", sqlite3_memory_highwater(0)},
+    };
+
+#ifdef __GLIBC__
     {
-        auto state_(state.readLock());
-        stats.pathInfoCacheSize = state_->pathInfoCache.size();
+        auto mi = mallinfo2();
+        res["malloc"] = {
+            {"arenaBytes", mi.arena},
+            {"mmapBytes", mi.hblkhd},
+            {"freeBytes", mi.fordblks},
+        };
     }
-    return stats;
+#endif
+
+#ifdef __linux__
+    /* Resident set size, in bytes. */
+    try {
+        auto statm = tokenizeString<std::vector<std::string>>(readFile("/proc/self/statm"));
+        if (statm.size() > 1)
+            if (auto pages = string2Int<uint64_t>(statm[1]))
+                res["rssBytes"] = *pages * sysconf(_SC_PAGESIZE);
+    } catch (SystemError &) {
+    }
+#endif
+
+    return res;
 }
 
 
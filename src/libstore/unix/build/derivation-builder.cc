@@ -14,6 +14,7 @@
 #include "nix/util/compression.hh"
 #include "nix/store/daemon.hh"
 #include "nix/util/topo-sort.hh"
+#include "nix/util/thread-pool.hh"
 #include "nix/util/callback.hh"
 #include "nix/util/json-utils.hh"
 #include "nix/util/current-process.hh"
@@ -31,6 +32,8 @@
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/resource.h>
+
+#include <thread>
 #include <sys/socket.h>
 
 #include "store-config-private.hh"
@@ -619,7 +622,29 @@ std::variant<std::pair<BuildResult::Status, Error>, SingleDrvOutputs> Derivation
         for (auto & i : redirectedOutputs)
             deletePath(store.Store::toRealPath(i.second));
 
-        /* Delete the chroot (if we were using one). */
+        /* Delete the chroot (if we were using one). Renaming it away
+           and deleting it in the background takes the teardown off
+           the build's critical path, which for storms of tiny builds
+           is a significant fraction of wall time; anything that
+           survives process exit lands in the trash directory that
+           the next GC empties. */
+        if (autoDelChroot) {
+            try {
+                auto trashDir = getLocalStore().config->realStoreDir.get() + "/trash";
+                createDirs(trashDir);
+                Path trashPath = fmt("%s/chroot-%d-%d", trashDir, getpid(), rand());
+                std::filesystem::rename(store.Store::toRealPath(drvPath) + ".chroot", trashPath);
+                autoDelChroot->cancel();
+                std::thread([trashPath]() {
+                    try {
+                        deletePath(trashPath);
+                    } catch (...) {
+                    }
+                }).detach();
+            } catch (...) {
+                /* Fall back to synchronous deletion. */
+            }
+        }
         autoDelChroot.reset(); /* this runs the destructor */
 
         deleteTmpDir(true);
@@ -1850,6 +1875,13 @@ void DerivationBuilderImpl::runChild()
 
         commonChildInit();
 
+        /* Builds run at normal priority even when the connection
+           handler was deprioritised (see
+           daemon-connection-niceness). Best effort: only root can
+           raise the priority back. */
+        if (settings.daemonConnectionNiceness != 0)
+            setpriority(PRIO_PROCESS, 0, 0);
+
         try {
             setupSeccomp();
         } catch (...) {
@@ -2357,6 +2389,14 @@ SingleDrvOutputs DerivationBuilderImpl::registerOutputs()
 {
     std::map<std::string, ValidPathInfo> infos;
 
+    struct ScanJob
+    {
+        std::string outputName;
+        Path path;
+        bool discardReferences;
+    };
+    std::vector<ScanJob> scanJobs;
+
     /* Set of inodes seen during calls to canonicalisePathMetaData()
        for this build's outputs.  This needs to be shared between
        outputs to allow hard links between outputs. */
@@ -2452,21 +2492,41 @@ SingleDrvOutputs DerivationBuilderImpl::registerOutputs()
             discardReferences = *udr;
         }
 
-        StorePathSet references;
-        if (discardReferences)
-            debug("discarding references of output '%s'", outputName);
-        else {
-            debug("scanning for references for output '%s' in temp location '%s'", outputName, actualPath);
+        /* The (expensive) reference scan itself runs in parallel
+           over all outputs below. */
+        scanJobs.push_back(ScanJob { .outputName = outputName, .path = actualPath, .discardReferences = discardReferences });
+        outputStats.insert_or_assign(outputName, std::move(st));
+    }
+
+    /* Scan the outputs for references in parallel: each scan reads
+       an entire output, and multi-output builds otherwise serialize
+       here. */
+    {
+        ThreadPool scanPool;
+        Sync<std::map<std::string, StorePathSet>> scannedRefs;
+
+        for (auto & job : scanJobs) {
+            if (job.discardReferences) {
+                debug("discarding references of output '%s'", job.outputName);
+                scannedRefs.lock()->emplace(job.outputName, StorePathSet());
+                continue;
+            }
+            scanPool.enqueue([&scannedRefs, &referenceablePaths, job]() {
+                debug("scanning for references for output '%s' in temp location '%s'", job.outputName, job.path);
 
-            /* Pass blank Sink as we are not ready to hash data at this stage. */
-            NullSink blank;
-            references = scanForReferences(blank, actualPath, referenceablePaths);
+                /* Pass blank Sink as we are not ready to hash data at this stage. */
+                NullSink blank;
+                auto refs = scanForReferences(blank, job.path, referenceablePaths);
+                scannedRefs.lock()->emplace(job.outputName, std::move(refs));
+            });
         }
 
-        outputReferencesIfUnregistered.insert_or_assign(
-            outputName,
-            PerhapsNeedToRegister { .refs = references });
-        outputStats.insert_or_assign(outputName, std::move(st));
+        scanPool.process();
+
+        for (auto & [outputName, refs] : *scannedRefs.lock())
+            outputReferencesIfUnregistered.insert_or_assign(
+                outputName,
+                PerhapsNeedToRegister { .refs = refs });
     }
 
     auto sortedOutputNames = topoSort(outputsToSort,
@@ -159,9 +159,20 @@ std::tuple<WorkerProto::Version, WorkerProto::FeatureSet> WorkerProto::BasicClie
     BufferedSink & to,
     Source & from,
     WorkerProto::Version localVersion,
-    const WorkerProto::FeatureSet & supportedFeatures)
+    const WorkerProto::FeatureSet & supportedFeatures,
+    std::optional<WorkerProto::Version> expectedVersion)
 {
     to << WORKER_MAGIC_1 << localVersion;
+
+    /* If an earlier connection negotiated a version with feature
+       support, send our features together with the greeting, saving
+       a round trip. */
+    bool sentFeatures = false;
+    if (expectedVersion && GET_PROTOCOL_MINOR(std::min(*expectedVersion, localVersion)) >= 38) {
+        to << supportedFeatures;
+        sentFeatures = true;
+    }
+
     to.flush();
 
     unsigned int magic = readInt(from);
@@ -179,10 +190,15 @@ std::tuple<WorkerProto::Version, WorkerProto::FeatureSet> WorkerProto::BasicClie
     /* Exchange features. */
     WorkerProto::FeatureSet daemonFeatures;
     if (GET_PROTOCOL_MINOR(protoVersion) >= 38) {
-        to << supportedFeatures;
-        to.flush();
+        if (!sentFeatures) {
+            to << supportedFeatures;
+            to.flush();
+        }
         daemonFeatures = readStrings<WorkerProto::FeatureSet>(from);
-    }
+    } else if (sentFeatures)
+        /* We already pushed features onto the wire, which this
+           daemon will misinterpret. */
+        throw Error("Nix daemon protocol version changed unexpectedly");
 
     return {protoVersion, intersectFeatures(daemonFeatures, supportedFeatures)};
 }
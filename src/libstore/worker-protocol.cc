@@ -8,10 +8,62 @@
 #include "nix/store/path-info.hh"
 
 #include <chrono>
+#include <iostream>
 #include <nlohmann/json.hpp>
 
+#include "nix/util/sync.hh"
+#include "nix/util/environment-variables.hh"
+
 namespace nix {
 
+namespace {
+
+struct OpStats
+{
+    uint64_t count = 0;
+    uint64_t totalUs = 0;
+    uint64_t maxUs = 0;
+    /* <1ms, <10ms, <100ms, <1s, >=1s */
+    uint64_t buckets[5] = {0};
+};
+
+Sync<std::map<uint64_t, OpStats>> workerOpStats;
+
+thread_local std::optional<std::pair<uint64_t, std::chrono::steady_clock::time_point>> pendingOp;
+
+}
+
+void noteWorkerOpStart(WorkerProto::Op op)
+{
+    pendingOp = {static_cast<uint64_t>(op), std::chrono::steady_clock::now()};
+}
+
+void noteWorkerOpEnd()
+{
+    if (!pendingOp) return;
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - pendingOp->second).count();
+    auto stats(workerOpStats.lock());
+    auto & s = (*stats)[pendingOp->first];
+    s.count++;
+    s.totalUs += us;
+    s.maxUs = std::max(s.maxUs, (uint64_t) us);
+    s.buckets[us < 1000 ? 0 : us < 10000 ? 1 : us < 100000 ? 2 : us < 1000000 ? 3 : 4]++;
+    pendingOp.reset();
+}
+
+void maybeDumpWorkerOpStats()
+{
+    if (getEnv("NIX_SHOW_DAEMON_STATS").value_or("0") != "1") return;
+    auto stats(workerOpStats.lock());
+    if (stats->empty()) return;
+    std::cerr << "daemon op latencies (op: count / avg / max; <1ms <10ms <100ms <1s >=1s):\n";
+    for (auto & [op, s] : *stats)
+        std::cerr << fmt("  %d: %d / %d us / %d us; %d %d %d %d %d\n",
+            op, s.count, s.count ? s.totalUs / s.count : 0, s.maxUs,
+            s.buckets[0], s.buckets[1], s.buckets[2], s.buckets[3], s.buckets[4]);
+}
+
 /* protocol-specific definitions */
 
 BuildMode WorkerProto::Serialise<BuildMode>::read(const StoreDirConfig & store, WorkerProto::ReadConn conn)
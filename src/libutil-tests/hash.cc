@@ -131,4 +131,25 @@ private:
     TEST(hashFormat, testParseHashFormatOptException) {
         ASSERT_EQ(parseHashFormatOpt("sha0042"), std::nullopt);
     }
+
+    /* ----------------------------------------------------------------------------
+     * nix32 encoding
+     * --------------------------------------------------------------------------*/
+
+    TEST(nix32, testRoundTrip) {
+        auto hash = hashString(HashAlgorithm::SHA256, "unicorn");
+        ASSERT_EQ(Hash::parseAny(hash.to_string(HashFormat::Nix32, true), std::nullopt), hash);
+    }
+
+    TEST(nix32, testRejectsCharactersOutsideAlphabet) {
+        auto hash = hashString(HashAlgorithm::SHA256, "unicorn");
+        auto s = hash.to_string(HashFormat::Nix32, false);
+        /* 'e', 'o', 'u' and 't' are excluded from the nix32
+           alphabet. */
+        for (char c : {'e', 'o', 'u', 't', 'E', '=', '\x80'}) {
+            auto bad = s;
+            bad[5] = c;
+            ASSERT_THROW(Hash::parseAny(bad, HashAlgorithm::SHA256), BadHash);
+        }
+    }
 }
@@ -42,5 +42,39 @@ INSTANTIATE_TEST_CASE_P(
     )
 );
 
+/* Hashes must be 32 characters from the nix32 alphabet. */
+static const string hash1 = "0c4q93bnsif8ym1cyp8vazfhcn20hkm9";
+static const string hash2 = "0c4q93bnrm99dpbk8sqyslll8hyd9kl9";
+
+TEST(RefScanSink, findsReferences) {
+    RefScanSink sink(StringSet{hash1, hash2});
+    sink("stuff /nix/store/" + hash1 + "-foo-1.0 more stuff");
+    ASSERT_EQ(sink.getResult(), StringSet{hash1});
+}
+
+TEST(RefScanSink, findsReferenceSpanningFragments) {
+    RefScanSink sink(StringSet{hash1});
+    auto s = "prefix" + hash1 + "suffix";
+    for (auto & c : s)
+        sink(std::string_view(&c, 1));
+    ASSERT_EQ(sink.getResult(), StringSet{hash1});
+}
+
+TEST(RefScanSink, distinguishesSharedPrefixes) {
+    /* hash1 and hash2 share their first 8 characters, so the prefix
+       pre-filter passes for both; only the one actually present may
+       be reported. */
+    ASSERT_EQ(hash1.substr(0, 8), hash2.substr(0, 8));
+    RefScanSink sink(StringSet{hash1, hash2});
+    sink("stuff " + hash2 + " stuff");
+    ASSERT_EQ(sink.getResult(), StringSet{hash2});
+}
+
+TEST(RefScanSink, ignoresAbsentReferences) {
+    RefScanSink sink(StringSet{hash1});
+    sink("no references here, just ordinary text");
+    ASSERT_EQ(sink.getResult(), StringSet{});
+}
+
 }
 
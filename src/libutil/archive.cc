@@ -5,12 +5,19 @@
 
 #include <strings.h> // for strcasecmp
 
+#ifdef __linux__
+#  include <unistd.h>
+#endif
+
 #include "nix/util/archive.hh"
 #include "nix/util/config-global.hh"
 #include "nix/util/posix-source-accessor.hh"
 #include "nix/util/source-path.hh"
 #include "nix/util/file-system.hh"
 #include "nix/util/signals.hh"
+#include "nix/util/finally.hh"
+
+#include <thread>
 
 namespace nix {
 
@@ -104,6 +111,17 @@ void SourceAccessor::dumpPath(
         sink << ")";
     };
 
+    /* For directory trees, let the accessor warm its caches (e.g.
+       kernel readahead on the underlying files) concurrently with
+       the serial dump, which must produce bytes in canonical
+       order. */
+    std::thread prefetcher;
+    if (auto st = maybeLstat(path); st && st->type == tDirectory)
+        prefetcher = std::thread([this, path]() { prefetchTree(path); });
+    Finally joinPrefetcher([&]() {
+        if (prefetcher.joinable()) prefetcher.join();
+    });
+
     sink << narVersionMagic1;
     dump(path);
 }
@@ -144,6 +162,37 @@ static void parseContents(CreateRegularFileSink & sink, Source & source)
     uint64_t left = size;
     std::array<char, 65536> buf;
 
+#ifdef __linux__
+    /* Fast path: when reading from a file descriptor (e.g. a NAR in
+       a local binary cache) and writing the contents verbatim to
+       another, let the kernel do the copy (which may even be a
+       reflink on btrfs/XFS) instead of shuffling every byte through
+       userspace buffers. Falls through to the generic loop for
+       whatever the kernel won't copy (e.g. a socket source). */
+    if (auto fdSource = dynamic_cast<FdSource *>(&source)) {
+        if (auto toFd = sink.fileDescriptor()) {
+            while (left) {
+                checkInterrupt();
+                if (fdSource->BufferedSource::hasData()) {
+                    /* Drain data already buffered in the source
+                       before copying between the descriptors. */
+                    auto n = buf.size();
+                    if ((uint64_t)n > left) n = left;
+                    source(buf.data(), n);
+                    sink({buf.data(), n});
+                    left -= n;
+                } else {
+                    auto n = copy_file_range(fdSource->fd, nullptr, *toFd, nullptr,
+                        std::min<uint64_t>(left, 1 << 24), 0);
+                    if (n <= 0) break;
+                    fdSource->read += n;
+                    left -= n;
+                }
+            }
+        }
+    }
+#endif
+
     while (left) {
         checkInterrupt();
         auto n = buf.size();
@@ -277,9 +326,10 @@ void parseDump(FileSystemObjectSink & sink, Source & source)
 }
 
 
-void restorePath(const std::filesystem::path & path, Source & source, bool startFsync)
+void restorePath(const std::filesystem::path & path, Source & source, bool startFsync, bool canonicalise)
 {
     RestoreSink sink{startFsync};
+    sink.canonicalise = canonicalise;
     sink.dstPath = path;
     parseDump(sink, source);
 }
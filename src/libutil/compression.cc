@@ -84,6 +84,11 @@ struct ArchiveCompressionSink : CompressionSink
         if (level != COMPRESSION_LEVEL_DEFAULT)
             check(archive_write_set_filter_option(
                 archive, format.c_str(), "compression-level", std::to_string(level).c_str()));
+        if (format == "zstd")
+            /* Long-distance matching helps a lot on NARs (long
+               repeats across files) for a modest window of memory.
+               Best effort: older libarchive/zstd lack the option. */
+            archive_write_set_filter_option(archive, format.c_str(), "long", "27");
         // disable internal buffering
         check(archive_write_set_bytes_per_block(archive, 0));
         // disable output padding
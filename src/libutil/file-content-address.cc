@@ -89,14 +89,15 @@ void restorePath(
     const Path & path,
     Source & source,
     FileSerialisationMethod method,
-    bool startFsync)
+    bool startFsync,
+    bool canonicalise)
 {
     switch (method) {
     case FileSerialisationMethod::Flat:
         writeFile(path, source, 0666, startFsync);
         break;
     case FileSerialisationMethod::NixArchive:
-        restorePath(path, source, startFsync);
+        restorePath(path, source, startFsync, canonicalise);
         break;
     }
 }
@@ -90,9 +90,22 @@ void RestoreSink::createDirectory(const CanonPath & path)
 struct RestoreRegularFile : CreateRegularFileSink {
     AutoCloseFD fd;
     bool startFsync = false;
+    bool canonicalise = false;
+    bool executable = false;
 
     ~RestoreRegularFile()
     {
+#ifndef _WIN32
+        if (fd && canonicalise) {
+            /* Give the file its canonical store metadata right away,
+               so the canonicalisation pass after registration has no
+               per-file fixups left to do. */
+            fchmod(fd.get(), executable ? 0555 : 0444);
+            struct timespec times[2] = {{.tv_sec = 1, .tv_nsec = 0}, {.tv_sec = 1, .tv_nsec = 0}};
+            futimens(fd.get(), times);
+        }
+#endif
+
         /* Initiate an fsync operation without waiting for the
            result. The real fsync should be run before registering a
            store path, but this is a performance optimization to allow
@@ -104,6 +117,11 @@ struct RestoreRegularFile : CreateRegularFileSink {
     void operator () (std::string_view data) override;
     void isExecutable() override;
     void preallocateContents(uint64_t size) override;
+
+    std::optional<Descriptor> fileDescriptor() override
+    {
+        return fd.get();
+    }
 };
 
 void RestoreSink::createRegularFile(const CanonPath & path, std::function<void(CreateRegularFileSink &)> func)
@@ -112,6 +130,7 @@ void RestoreSink::createRegularFile(const CanonPath & path, std::function<void(C
 
     RestoreRegularFile crf;
     crf.startFsync = startFsync;
+    crf.canonicalise = canonicalise;
     crf.fd =
 #ifdef _WIN32
         CreateFileW(p.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL)
@@ -125,6 +144,8 @@ void RestoreSink::createRegularFile(const CanonPath & path, std::function<void(C
 
 void RestoreRegularFile::isExecutable()
 {
+    executable = true;
+
     // Windows doesn't have a notion of executable file permissions we
     // care about here, right?
 #ifndef _WIN32
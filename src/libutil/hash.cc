@@ -1,3 +1,4 @@
+#include <array>
 #include <iostream>
 #include <cstring>
 
@@ -230,12 +231,22 @@ Hash::Hash(std::string_view rest, HashAlgorithm algo, bool isSRI)
 
     else if (!isSRI && rest.size() == base32Len()) {
 
+        /* Byte-indexed inverse of `nix32Chars`; -1 marks characters
+           outside the alphabet. Store paths are parsed through here
+           on nearly every store operation, so this replaces a linear
+           alphabet scan per character. */
+        static const auto nix32Inverse = []() {
+            std::array<int8_t, 256> inv;
+            inv.fill(-1);
+            for (size_t i = 0; i < nix32Chars.size(); ++i)
+                inv[(unsigned char) nix32Chars[i]] = i;
+            return inv;
+        }();
+
         for (unsigned int n = 0; n < rest.size(); ++n) {
             char c = rest[rest.size() - n - 1];
-            unsigned char digit;
-            for (digit = 0; digit < nix32Chars.size(); ++digit) /* !!! slow */
-                if (nix32Chars[digit] == c) break;
-            if (digit >= 32)
+            int8_t digit = nix32Inverse[(unsigned char) c];
+            if (digit < 0)
                 throw BadHash("invalid base-32 hash '%s'", rest);
             unsigned int b = n * 5;
             unsigned int i = b / 8;
@@ -75,7 +75,13 @@ void dumpString(std::string_view s, Sink & sink);
 
 void parseDump(FileSystemObjectSink & sink, Source & source);
 
-void restorePath(const std::filesystem::path & path, Source & source, bool startFsync = false);
+/**
+ * @param canonicalise Give restored regular files canonical store
+ * metadata (mode 444/555, mtime 1) as they are created, so a
+ * subsequent `canonicalisePathMetaData()` pass has no per-file work
+ * left.
+ */
+void restorePath(const std::filesystem::path & path, Source & source, bool startFsync = false, bool canonicalise = false);
 
 /**
  * Read a NAR from 'source' and write it to 'sink'.
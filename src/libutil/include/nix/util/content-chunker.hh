@@ -0,0 +1,71 @@
+#pragma once
+///@file
+
+#include "nix/util/serialise.hh"
+
+#include <array>
+#include <functional>
+#include <random>
+
+namespace nix {
+
+/**
+ * Splits a stream into content-defined chunks using a gear rolling
+ * hash (FastCDC-style), calling `emitChunk` for each chunk. Used for
+ * chunked NAR uploads and closure images, where equal data should
+ * produce equal chunks regardless of its position in the stream.
+ */
+struct ChunkingSink : Sink
+{
+    static constexpr size_t minChunkSize = 256 * 1024;
+    static constexpr uint64_t avgChunkMask = (1 << 20) - 1; /* ~1 MiB average */
+    static constexpr size_t maxChunkSize = 4 * 1024 * 1024;
+
+    std::function<void(std::string_view)> emitChunk;
+    std::string buffer;
+    uint64_t gear = 0;
+
+    static const std::array<uint64_t, 256> & gearTable()
+    {
+        static auto table = []() {
+            /* Fixed seed: chunk boundaries must be stable across
+               runs and versions, or deduplication against earlier
+               data breaks. */
+            std::mt19937_64 prng(0x2b99cdbb7a62d21eULL);
+            std::array<uint64_t, 256> t;
+            for (auto & x : t) x = prng();
+            return t;
+        }();
+        return table;
+    }
+
+    ChunkingSink(std::function<void(std::string_view)> emitChunk)
+        : emitChunk(std::move(emitChunk))
+    { }
+
+    void operator () (std::string_view data) override
+    {
+        auto & table = gearTable();
+        for (char c : data) {
+            buffer += c;
+            gear = (gear << 1) + table[(unsigned char) c];
+            if (buffer.size() >= maxChunkSize
+                || (buffer.size() >= minChunkSize && (gear & avgChunkMask) == 0))
+            {
+                emitChunk(buffer);
+                buffer.clear();
+                gear = 0;
+            }
+        }
+    }
+
+    void finish()
+    {
+        if (!buffer.empty()) {
+            emitChunk(buffer);
+            buffer.clear();
+        }
+    }
+};
+
+}
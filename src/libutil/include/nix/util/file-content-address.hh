@@ -71,7 +71,8 @@ void restorePath(
     const Path & path,
     Source & source,
     FileSerialisationMethod method,
-    bool startFsync = false);
+    bool startFsync = false,
+    bool canonicalise = false);
 
 
 /**
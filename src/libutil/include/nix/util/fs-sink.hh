@@ -20,6 +20,14 @@ struct CreateRegularFileSink : Sink
      * An optimization. By default, do nothing.
      */
     virtual void preallocateContents(uint64_t size) { };
+
+    /**
+     * If this sink writes the contents verbatim to a file
+     * descriptor, return it, so that callers can use kernel-side
+     * copies (e.g. `copy_file_range`) instead of shuffling the data
+     * through userspace buffers. By default, return nothing.
+     */
+    virtual std::optional<Descriptor> fileDescriptor() { return std::nullopt; }
 };
 
 
@@ -80,6 +88,13 @@ struct RestoreSink : FileSystemObjectSink
     std::filesystem::path dstPath;
     bool startFsync = false;
 
+    /**
+     * Create regular files with canonical store metadata (mode
+     * 444/555, mtime 1), so that canonicalisePathMetaData() finds
+     * nothing to fix per file.
+     */
+    bool canonicalise = false;
+
     explicit RestoreSink(bool startFsync)
         : startFsync{startFsync}
     { }
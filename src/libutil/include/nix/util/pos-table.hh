@@ -1,6 +1,8 @@
 #pragma once
 ///@file
 
+#include <atomic>
+
 #include <cstdint>
 #include <vector>
 
@@ -53,17 +55,32 @@ private:
 
     mutable Sync<LinesCache> linesCache;
 
+    /**
+     * The origin of the most recently resolved position. Lookups
+     * cluster heavily in one origin (e.g. while reporting errors
+     * from one file), so this avoids the tree walk for most of them.
+     * Map nodes are stable, so the pointer stays valid.
+     */
+    mutable std::atomic<const Origin *> lastOrigin{nullptr};
+
     const Origin * resolve(PosIdx p) const
     {
         if (p.id == 0)
             return nullptr;
 
         const auto idx = p.id - 1;
+
+        if (auto cached = lastOrigin.load(std::memory_order_relaxed))
+            if (idx >= cached->offset && idx - cached->offset < cached->size)
+                return cached;
+
         /* we want the last key <= idx, so we'll take prev(first key > idx).
             this is guaranteed to never rewind origin.begin because the first
             key is always 0. */
         const auto pastOrigin = origins.upper_bound(idx);
-        return &std::prev(pastOrigin)->second;
+        auto origin = &std::prev(pastOrigin)->second;
+        lastOrigin.store(origin, std::memory_order_relaxed);
+        return origin;
     }
 
 public:
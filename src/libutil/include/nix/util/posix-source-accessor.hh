@@ -79,6 +79,10 @@ private:
     std::optional<struct stat> cachedLstat(const CanonPath & path);
 
     std::filesystem::path makeAbsPath(const CanonPath & path);
+
+public:
+
+    void prefetchTree(const CanonPath & path) override;
 };
 
 }
@@ -3,6 +3,8 @@
 
 #include "nix/util/hash.hh"
 
+#include <unordered_set>
+
 namespace nix {
 
 class RefScanSink : public Sink
@@ -10,12 +12,17 @@ class RefScanSink : public Sink
     StringSet hashes;
     StringSet seen;
 
+    /**
+     * The 64-bit prefixes of `hashes`, used to cheaply reject
+     * candidate windows before doing a full lookup.
+     */
+    std::unordered_set<uint64_t> prefixes;
+
     std::string tail;
 
 public:
 
-    RefScanSink(StringSet && hashes) : hashes(hashes)
-    { }
+    RefScanSink(StringSet && hashes);
 
     StringSet & getResult()
     { return seen; }
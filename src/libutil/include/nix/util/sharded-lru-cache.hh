@@ -0,0 +1,74 @@
+#pragma once
+///@file
+
+#include "nix/util/lru-cache.hh"
+#include "nix/util/sync.hh"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace nix {
+
+/**
+ * A thread-safe `LRUCache` sharded over a number of independently
+ * locked segments, so that concurrent accesses to different keys
+ * mostly don't contend on a single mutex. Each shard holds
+ * `capacity / nrShards` entries, so eviction order is only
+ * approximately LRU across the whole cache.
+ */
+template<typename Key, typename Value>
+class ShardedLRUCache
+{
+    static constexpr size_t nrShards = 16;
+
+    std::vector<std::unique_ptr<Sync<LRUCache<Key, Value>>>> shards;
+
+    Sync<LRUCache<Key, Value>> & shardFor(const Key & key)
+    {
+        return *shards[std::hash<Key>{}(key) % shards.size()];
+    }
+
+public:
+
+    ShardedLRUCache(size_t capacity)
+    {
+        /* Note: a capacity of 0 disables caching, as in LRUCache. */
+        auto shardCapacity = capacity == 0 ? 0 : std::max((size_t) 1, capacity / nrShards);
+        for (size_t n = 0; n < nrShards; ++n)
+            shards.push_back(std::make_unique<Sync<LRUCache<Key, Value>>>(
+                LRUCache<Key, Value>(shardCapacity)));
+    }
+
+    void upsert(const Key & key, const Value & value)
+    {
+        shardFor(key).lock()->upsert(key, value);
+    }
+
+    std::optional<Value> get(const Key & key)
+    {
+        return shardFor(key).lock()->get(key);
+    }
+
+    bool erase(const Key & key)
+    {
+        return shardFor(key).lock()->erase(key);
+    }
+
+    void clear()
+    {
+        for (auto & shard : shards)
+            shard->lock()->clear();
+    }
+
+    size_t size()
+    {
+        size_t res = 0;
+        for (auto & shard : shards)
+            res += shard->lock()->size();
+        return res;
+    }
+};
+
+}
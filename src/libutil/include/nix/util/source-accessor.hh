@@ -133,6 +133,14 @@ struct SourceAccessor : std::enable_shared_from_this<SourceAccessor>
 
     virtual std::string readLink(const CanonPath & path) = 0;
 
+    /**
+     * Hint that the tree below `path` is about to be read in full
+     * (e.g. by `dumpPath`), so the accessor may warm whatever caches
+     * back it. Must be safe to call from another thread than the one
+     * doing the reads. The default does nothing.
+     */
+    virtual void prefetchTree(const CanonPath & path) { }
+
     virtual void dumpPath(
         const CanonPath & path,
         Sink & sink,
@@ -36,7 +36,7 @@ public:
     /**
      * Enqueue a function to be executed by the thread pool.
      */
-    void enqueue(const work_t & t);
+    void enqueue(work_t t);
 
     /**
      * Execute work items until the queue is empty.
@@ -85,7 +85,8 @@ template<typename T>
 void processGraph(
     const std::set<T> & nodes,
     std::function<std::set<T>(const T &)> getEdges,
-    std::function<void(const T &)> processNode)
+    std::function<void(const T &)> processNode,
+    size_t maxThreads = 0)
 {
     struct Graph {
         std::set<T> left;
@@ -98,7 +99,7 @@ void processGraph(
 
     /* Create pool last to ensure threads are stopped before other destructors
      * run */
-    ThreadPool pool;
+    ThreadPool pool(maxThreads);
 
     worker = [&](const T & node) {
 
@@ -10,6 +10,8 @@
 
 #include <atomic>
 #include <sstream>
+#include <chrono>
+#include <optional>
 #include <nlohmann/json.hpp>
 #include <iostream>
 
@@ -270,23 +272,76 @@ struct JSONLogger : Logger {
         write(json);
     }
 
-    void stopActivity(ActivityId act) override
+    /**
+     * Per-activity rate-limiting state for progress results: when
+     * the last record was written, and the most recent update that
+     * was suppressed by the rate limit (so it can be flushed when
+     * the activity stops - the stop record itself carries no
+     * fields, and consumers read the final totals from the last
+     * progress record).
+     */
+    struct ProgressState
+    {
+        std::chrono::steady_clock::time_point lastWritten;
+        std::optional<Fields> suppressed;
+    };
+
+    Sync<std::map<ActivityId, ProgressState>> progressState;
+
+    void writeResult(ActivityId act, ResultType type, const Fields & fields)
     {
         nlohmann::json json;
-        json["action"] = "stop";
+        json["action"] = "result";
         json["id"] = act;
+        json["type"] = type;
+        addFields(json, fields);
         write(json);
     }
 
-    void result(ActivityId act, ResultType type, const Fields & fields) override
+    void stopActivity(ActivityId act) override
     {
+        std::optional<Fields> suppressed;
+        {
+            auto state(progressState.lock());
+            if (auto i = state->find(act); i != state->end()) {
+                suppressed = std::move(i->second.suppressed);
+                state->erase(i);
+            }
+        }
+        /* Flush the final progress state dropped by the rate
+           limiter, so the last record before the stop carries the
+           true totals. */
+        if (suppressed)
+            writeResult(act, resProgress, *suppressed);
+
         nlohmann::json json;
-        json["action"] = "result";
+        json["action"] = "stop";
         json["id"] = act;
-        json["type"] = type;
-        addFields(json, fields);
         write(json);
     }
+
+    void result(ActivityId act, ResultType type, const Fields & fields) override
+    {
+        /* Progress results are idempotent state updates that some
+           activities emit at very high frequency (e.g. per download
+           chunk); serialising each one costs real CPU on 10k-goal
+           builds. Sample them per activity; the last suppressed
+           update is flushed by stopActivity, so the final totals
+           are never lost. */
+        if (type == resProgress) {
+            auto now = std::chrono::steady_clock::now();
+            auto state(progressState.lock());
+            auto & st = (*state)[act];
+            if (now - st.lastWritten < std::chrono::milliseconds(50)) {
+                st.suppressed = fields;
+                return;
+            }
+            st.lastWritten = now;
+            st.suppressed.reset();
+        }
+
+        writeResult(act, type, fields);
+    }
 };
 
 std::unique_ptr<Logger> makeJSONLogger(Descriptor fd)
@@ -205,4 +205,29 @@ ref<SourceAccessor> makeFSSourceAccessor(std::filesystem::path root)
 {
     return make_ref<PosixSourceAccessor>(std::move(root));
 }
+
+void PosixSourceAccessor::prefetchTree(const CanonPath & path)
+{
+#ifdef __linux__
+    /* Ask the kernel to read the tree's file contents ahead of the
+       serial dump. Errors are irrelevant: this is only a hint. */
+    try {
+        std::error_code ec;
+        for (std::filesystem::recursive_directory_iterator
+                 it(makeAbsPath(path), std::filesystem::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end; it.increment(ec))
+        {
+            std::error_code ec2;
+            if (!it->is_regular_file(ec2) || ec2) continue;
+            AutoCloseFD fd = toDescriptor(open(it->path().c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW));
+            if (!fd) continue;
+            posix_fadvise(fd.get(), 0, 0, POSIX_FADV_WILLNEED);
+        }
+    } catch (...) {
+        /* E.g. the tree changing under us; the dump itself reports
+           real errors. */
+    }
+#endif
+}
+
 }
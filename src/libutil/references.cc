@@ -4,6 +4,7 @@
 
 #include <map>
 #include <cstdlib>
+#include <cstring>
 #include <mutex>
 #include <algorithm>
 
@@ -13,11 +14,29 @@ namespace nix {
 
 static size_t refLength = 32; /* characters */
 
+/* The length of the hash prefix used as a pre-filter: candidate
+   windows are only looked up in the hash set when their first 8
+   characters match the prefix of some hash we're looking for. A
+   64-bit load plus a flat hash set probe is much cheaper than a
+   string allocation and an ordered set lookup per candidate, and
+   false positives (distinct hashes sharing a 64-bit prefix) merely
+   cost one extra full lookup. */
+static constexpr size_t refPrefixLength = 8;
+
+static uint64_t refPrefix(const char * s)
+{
+    uint64_t prefix;
+    static_assert(refPrefixLength == sizeof(prefix));
+    memcpy(&prefix, s, sizeof(prefix));
+    return prefix;
+}
+
 
 static void search(
     std::string_view s,
     StringSet & hashes,
-    StringSet & seen)
+    StringSet & seen,
+    const std::unordered_set<uint64_t> & prefixes)
 {
     static std::once_flag initialised;
     static bool isBase32[256];
@@ -37,16 +56,28 @@ static void search(
                 break;
             }
         if (!match) continue;
-        std::string ref(s.substr(i, refLength));
-        if (hashes.erase(ref)) {
-            debug("found reference to '%1%' at offset '%2%'", ref, i);
-            seen.insert(ref);
+        if (prefixes.count(refPrefix(s.data() + i))) {
+            auto ref = s.substr(i, refLength);
+            if (auto h = hashes.find(ref); h != hashes.end()) {
+                debug("found reference to '%1%' at offset '%2%'", ref, i);
+                seen.insert(*h);
+                hashes.erase(h);
+            }
         }
         ++i;
     }
 }
 
 
+RefScanSink::RefScanSink(StringSet && hashes) : hashes(hashes)
+{
+    for (auto & hash : this->hashes) {
+        assert(hash.size() >= refPrefixLength);
+        prefixes.insert(refPrefix(hash.data()));
+    }
+}
+
+
 void RefScanSink::operator () (std::string_view data)
 {
     /* It's possible that a reference spans the previous and current
@@ -55,9 +86,9 @@ void RefScanSink::operator () (std::string_view data)
     auto s = tail;
     auto tailLen = std::min(data.size(), refLength);
     s.append(data.data(), tailLen);
-    search(s, hashes, seen);
+    search(s, hashes, seen, prefixes);
 
-    search(data, hashes, seen);
+    search(data, hashes, seen, prefixes);
 
     auto rest = refLength - tailLen;
     if (rest < tail.size())
@@ -25,9 +25,13 @@ void BufferedSink::operator () (std::string_view data)
     if (!buffer) buffer = decltype(buffer)(new char[bufSize]);
 
     while (!data.empty()) {
-        /* Optimisation: bypass the buffer if the data exceeds the
-           buffer size. */
-        if (bufPos + data.size() >= bufSize) {
+        /* Optimisation: bypass the buffer if the data itself exceeds
+           the buffer size. Note: only for the data itself; a small
+           write that merely doesn't fit into the remaining buffer
+           space should be buffered after a flush, not issued as its
+           own tiny write to the fd. Protocol framing consists of
+           many such small writes. */
+        if (data.size() >= bufSize) {
             flush();
             writeUnbuffered(data);
             break;
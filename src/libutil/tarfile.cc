@@ -5,6 +5,10 @@
 #include "nix/util/serialise.hh"
 #include "nix/util/tarfile.hh"
 #include "nix/util/file-system.hh"
+#include "nix/util/sync.hh"
+
+#include <deque>
+#include <thread>
 
 namespace nix {
 
@@ -43,7 +47,10 @@ void checkLibArchive(archive * archive, int err, const std::string & reason)
         throw Error(reason, archive_error_string(archive));
 }
 
-constexpr auto defaultBufferSize = std::size_t{65536};
+/* Reads from the wrapped Source cross a coroutine boundary when the
+   source is a streaming download (sinkToSource); a larger buffer
+   means correspondingly fewer context switches per gigabyte. */
+constexpr auto defaultBufferSize = std::size_t{1024 * 1024};
 }
 
 void TarArchive::check(int err, const std::string & reason)
@@ -178,6 +185,114 @@ time_t unpackTarfileToSink(TarArchive & archive, ExtendedFileSystemObjectSink &
 {
     time_t lastModified = 0;
 
+    /* Decoding the archive and feeding the sink (which typically
+       hashes and stores the files) are pipelined: this thread
+       decodes entries into a bounded queue, and a consumer thread
+       replays them into the sink in order. */
+    struct Entry
+    {
+        enum { Directory, Regular, Symlink, Hardlink } type;
+        CanonPath path;
+        std::string data; /* contents, or link target */
+        bool executable = false;
+    };
+
+    struct PipeState
+    {
+        std::deque<Entry> queue;
+        size_t queuedBytes = 0;
+        /* Whether the consumer is in the middle of an entry. */
+        bool busy = false;
+        bool done = false;
+        std::exception_ptr exc;
+    };
+
+    constexpr size_t maxQueuedBytes = 64 * 1024 * 1024;
+
+    Sync<PipeState> state_;
+    std::condition_variable avail, drain;
+
+    std::thread consumer([&]() {
+        try {
+            while (true) {
+                Entry entry;
+                {
+                    auto state(state_.lock());
+                    while (state->queue.empty() && !state->done)
+                        state.wait(avail);
+                    if (state->queue.empty()) return;
+                    entry = std::move(state->queue.front());
+                    state->queue.pop_front();
+                    state->queuedBytes -= entry.data.size();
+                    state->busy = true;
+                }
+                drain.notify_one();
+
+                switch (entry.type) {
+                case Entry::Directory:
+                    parseSink.createDirectory(entry.path);
+                    break;
+                case Entry::Regular:
+                    parseSink.createRegularFile(entry.path, [&](auto & crf) {
+                        if (entry.executable)
+                            crf.isExecutable();
+                        crf(entry.data);
+                    });
+                    break;
+                case Entry::Symlink:
+                    parseSink.createSymlink(entry.path, entry.data);
+                    break;
+                case Entry::Hardlink:
+                    parseSink.createHardlink(entry.path, CanonPath(entry.data));
+                    break;
+                }
+
+                {
+                    auto state(state_.lock());
+                    state->busy = false;
+                }
+                drain.notify_one();
+            }
+        } catch (...) {
+            auto state(state_.lock());
+            state->exc = std::current_exception();
+            state->done = true;
+            drain.notify_one();
+        }
+    });
+
+    /* On unwinding, just stop and join the consumer; its exception
+       (if any) must not be thrown from a destructor. */
+    Finally joinConsumer([&]() {
+        if (consumer.joinable()) {
+            {
+                auto state(state_.lock());
+                state->done = true;
+            }
+            avail.notify_all();
+            consumer.join();
+        }
+    });
+
+    auto enqueue = [&](Entry && entry) {
+        auto state(state_.lock());
+        while (!state->done && state->queuedBytes > maxQueuedBytes)
+            state.wait(drain);
+        if (state->exc) std::rethrow_exception(state->exc);
+        state->queuedBytes += entry.data.size();
+        state->queue.push_back(std::move(entry));
+        avail.notify_one();
+    };
+
+    /* Wait until the consumer has replayed everything, so an entry
+       handled on this thread keeps its place in the archive order. */
+    auto drainQueue = [&]() {
+        auto state(state_.lock());
+        while (!state->done && (!state->queue.empty() || state->busy))
+            state.wait(drain);
+        if (state->exc) std::rethrow_exception(state->exc);
+    };
+
     /* Only allocate the buffer once. Use the heap because 131 KiB is a bit too
        much for the stack. */
     std::vector<unsigned char> buf(128 * 1024);
@@ -200,33 +315,55 @@ time_t unpackTarfileToSink(TarArchive & archive, ExtendedFileSystemObjectSink &
         lastModified = std::max(lastModified, archive_entry_mtime(entry));
 
         if (auto target = archive_entry_hardlink(entry)) {
-            parseSink.createHardlink(cpath, CanonPath(target));
+            enqueue({ .type = Entry::Hardlink, .path = cpath, .data = target });
             continue;
         }
 
         switch (auto type = archive_entry_filetype(entry)) {
 
         case AE_IFDIR:
-            parseSink.createDirectory(cpath);
+            enqueue({ .type = Entry::Directory, .path = cpath });
             break;
 
         case AE_IFREG: {
-            parseSink.createRegularFile(cpath, [&](auto & crf) {
-                if (archive_entry_mode(entry) & S_IXUSR)
-                    crf.isExecutable();
-
-                while (true) {
-                    auto n = archive_read_data(archive.archive, buf.data(), buf.size());
-                    if (n < 0)
-                        checkLibArchive(archive.archive, n, "cannot read file from tarball: %s");
-                    if (n == 0)
-                        break;
-                    crf(std::string_view{
-                        (const char *) buf.data(),
-                        (size_t) n,
-                    });
-                }
-            });
+            bool executable = archive_entry_mode(entry) & S_IXUSR;
+
+            /* Files too large to buffer (or of unknown size) are
+               streamed straight into the sink from this thread in
+               the old chunked fashion, after draining the queue to
+               preserve the entry order. */
+            if (!archive_entry_size_is_set(entry)
+                || (uint64_t) archive_entry_size(entry) > maxQueuedBytes)
+            {
+                drainQueue();
+                parseSink.createRegularFile(cpath, [&](auto & crf) {
+                    if (executable)
+                        crf.isExecutable();
+                    while (true) {
+                        auto n = archive_read_data(archive.archive, buf.data(), buf.size());
+                        if (n < 0)
+                            checkLibArchive(archive.archive, n, "cannot read file from tarball: %s");
+                        if (n == 0)
+                            break;
+                        crf({(const char *) buf.data(), (size_t) n});
+                    }
+                });
+                break;
+            }
+
+            Entry fileEntry { .type = Entry::Regular, .path = cpath };
+            fileEntry.executable = executable;
+
+            while (true) {
+                auto n = archive_read_data(archive.archive, buf.data(), buf.size());
+                if (n < 0)
+                    checkLibArchive(archive.archive, n, "cannot read file from tarball: %s");
+                if (n == 0)
+                    break;
+                fileEntry.data.append((const char *) buf.data(), (size_t) n);
+            }
+
+            enqueue(std::move(fileEntry));
 
             break;
         }
@@ -234,7 +371,7 @@ time_t unpackTarfileToSink(TarArchive & archive, ExtendedFileSystemObjectSink &
         case AE_IFLNK: {
             auto target = archive_entry_symlink(entry);
 
-            parseSink.createSymlink(cpath, target);
+            enqueue({ .type = Entry::Symlink, .path = cpath, .data = target });
 
             break;
         }
@@ -244,6 +381,19 @@ time_t unpackTarfileToSink(TarArchive & archive, ExtendedFileSystemObjectSink &
         }
     }
 
+    /* Wait for the consumer to finish feeding the sink, and
+       propagate any error it hit. */
+    {
+        auto state(state_.lock());
+        state->done = true;
+    }
+    avail.notify_all();
+    consumer.join();
+    {
+        auto state(state_.lock());
+        if (state->exc) std::rethrow_exception(state->exc);
+    }
+
     return lastModified;
 }
 
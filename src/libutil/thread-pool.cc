@@ -39,15 +39,19 @@ void ThreadPool::shutdown()
         thr.join();
 }
 
-void ThreadPool::enqueue(const work_t & t)
+void ThreadPool::enqueue(work_t t)
 {
-    auto state(state_.lock());
-    if (quit)
-        throw ThreadPoolShutDown("cannot enqueue a work item while the thread pool is shutting down");
-    state->pending.push(t);
-    /* Note: process() also executes items, so count it as a worker. */
-    if (state->pending.size() > state->workers.size() + 1 && state->workers.size() + 1 < maxThreads)
-        state->workers.emplace_back(&ThreadPool::doWork, this, false);
+    {
+        auto state(state_.lock());
+        if (quit)
+            throw ThreadPoolShutDown("cannot enqueue a work item while the thread pool is shutting down");
+        state->pending.push(std::move(t));
+        /* Note: process() also executes items, so count it as a worker. */
+        if (state->pending.size() > state->workers.size() + 1 && state->workers.size() + 1 < maxThreads)
+            state->workers.emplace_back(&ThreadPool::doWork, this, false);
+    }
+    /* Notify after unlocking, so the woken worker doesn't
+       immediately block on the mutex we still hold. */
     work.notify_one();
 }
 
@@ -4,6 +4,8 @@
 #include "nix/util/signals.hh"
 
 #include <array>
+#include <cstring>
+#include <unordered_map>
 #include <cctype>
 #include <iostream>
 #include <regex>
@@ -88,6 +90,53 @@ std::string replaceStrings(
 
 std::string rewriteStrings(std::string s, const StringMap & rewrites)
 {
+    if (rewrites.empty()) return s;
+
+    /* Single-pass rewriting for the hash-rewrite case (content
+       addressing): many patterns, all of the same length, each
+       replaced by a string of equal length. One traversal with a
+       first-byte filter and a 64-bit prefix table replaces a full
+       buffer scan per pattern, which explodes on multi-gigabyte
+       outputs with dozens of self-references. */
+    auto len = rewrites.begin()->first.size();
+    bool uniform = len >= 8;
+    for (auto & [from, to] : rewrites)
+        if (from.size() != len || to.size() != len) {
+            uniform = false;
+            break;
+        }
+
+    if (uniform && rewrites.size() >= 4) {
+        bool firstByte[256] = {};
+        std::unordered_map<uint64_t, std::vector<const StringMap::value_type *>> byPrefix;
+        for (auto & rewrite : rewrites) {
+            if (rewrite.first == rewrite.second) continue;
+            firstByte[(unsigned char) rewrite.first[0]] = true;
+            uint64_t prefix;
+            memcpy(&prefix, rewrite.first.data(), sizeof(prefix));
+            byPrefix[prefix].push_back(&rewrite);
+        }
+
+        if (byPrefix.empty()) return s;
+
+        for (size_t j = 0; j + len <= s.size(); ++j) {
+            if (!firstByte[(unsigned char) s[j]]) continue;
+            uint64_t prefix;
+            memcpy(&prefix, s.data() + j, sizeof(prefix));
+            auto it = byPrefix.find(prefix);
+            if (it == byPrefix.end()) continue;
+            for (auto * rewrite : it->second) {
+                if (s.compare(j, len, rewrite->first) == 0) {
+                    s.replace(j, len, rewrite->second);
+                    j += len - 1;
+                    break;
+                }
+            }
+        }
+
+        return s;
+    }
+
     for (auto & i : rewrites) {
         if (i.first == i.second) continue;
         size_t j = 0;
@@ -989,6 +989,17 @@ static void opServe(Strings opFlags, Strings opArgs)
                 break;
             }
 
+            case ServeProto::Command::QueryLoad: {
+                uint64_t load = 0;
+#ifndef _WIN32
+                double loadavg[1];
+                if (getloadavg(loadavg, 1) == 1)
+                    load = (uint64_t) (loadavg[0] * 1000);
+#endif
+                out << load;
+                break;
+            }
+
             case ServeProto::Command::QueryClosure: {
                 bool includeOutputs = readInt(in);
                 StorePathSet closure;
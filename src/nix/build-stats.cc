@@ -0,0 +1,71 @@
+#include "nix/cmd/command.hh"
+#include "nix/main/common-args.hh"
+#include "nix/main/shared.hh"
+#include "nix/store/store-api.hh"
+#include "nix/store/globals.hh"
+#include "nix/util/util.hh"
+
+#include <nlohmann/json.hpp>
+
+using namespace nix;
+
+struct CmdStoreBuildStats : StoreCommand, MixJSON
+{
+    std::string drvName;
+
+    CmdStoreBuildStats()
+    {
+        expectArg("name", &drvName, true);
+    }
+
+    std::string description() override
+    {
+        return "show recorded metrics of past builds";
+    }
+
+    std::string doc() override
+    {
+        return
+          #include "build-stats.md"
+          ;
+    }
+
+    void run(ref<Store> store) override
+    {
+        auto metricsFile = settings.nixStateDir + "/build-metrics";
+
+        if (!pathExists(metricsFile))
+            throw Error("no build metrics have been recorded yet (missing '%s')", metricsFile);
+
+        for (auto & line : tokenizeString<Strings>(readFile(metricsFile), "\n")) {
+            nlohmann::json record;
+            try {
+                record = nlohmann::json::parse(line);
+            } catch (std::exception &) {
+                continue;
+            }
+
+            if (!drvName.empty()) {
+                auto name = record.value("name", "");
+                auto drvPath = record.value("drvPath", "");
+                if (name.find(drvName) == std::string::npos
+                    && drvPath.find(drvName) == std::string::npos)
+                    continue;
+            }
+
+            if (json)
+                logger->cout(record.dump());
+            else {
+                auto cpu = record.contains("cpuUserMs")
+                    ? fmt(", %.1fs user CPU", record["cpuUserMs"].get<uint64_t>() / 1000.0)
+                    : "";
+                logger->cout("%s: %ds%s",
+                    record.value("drvPath", "?"),
+                    record.value("duration", 0),
+                    cpu);
+            }
+        }
+    }
+};
+
+static auto rCmdStoreBuildStats = registerCommand2<CmdStoreBuildStats>({"store", "build-stats"});
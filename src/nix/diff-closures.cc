@@ -6,6 +6,8 @@
 
 #include <regex>
 
+#include <nlohmann/json.hpp>
+
 #include "nix/util/strings.hh"
 
 namespace nix {
@@ -13,6 +15,9 @@ namespace nix {
 struct Info
 {
     std::string outputName;
+    uint64_t narSize = 0;
+
+    bool operator==(const Info &) const = default;
 };
 
 // name -> version -> store paths
@@ -23,6 +28,10 @@ GroupedPaths getClosureInfo(ref<Store> store, const StorePath & toplevel)
     StorePathSet closure;
     store->computeFSClosure({toplevel}, closure);
 
+    /* One batched query for the whole closure, instead of one
+       round trip per path when the sizes are added up below. */
+    auto infos = store->queryPathInfos(closure);
+
     GroupedPaths groupedPaths;
 
     for (auto const & path : closure) {
@@ -41,7 +50,11 @@ GroupedPaths getClosureInfo(ref<Store> store, const StorePath & toplevel)
         }
 
         DrvName drvName(name);
-        groupedPaths[drvName.name][drvName.version].emplace(path, Info { .outputName = outputName });
+        auto info = infos.find(path);
+        groupedPaths[drvName.name][drvName.version].emplace(path, Info {
+            .outputName = outputName,
+            .narSize = info != infos.end() ? info->second->narSize : 0,
+        });
     }
 
     return groupedPaths;
@@ -56,6 +69,69 @@ std::string showVersions(const StringSet & versions)
     return concatStringsSep(", ", versions2);
 }
 
+/* Emit the diff as a JSON object keyed by package name, streamed
+   entry by entry so dashboards consuming large diffs don't wait for
+   the whole document. */
+void printClosureDiffJSON(
+    ref<Store> store,
+    const StorePath & beforePath,
+    const StorePath & afterPath)
+{
+    auto beforeClosure = getClosureInfo(store, beforePath);
+    auto afterClosure = getClosureInfo(store, afterPath);
+
+    StringSet allNames;
+    for (auto & [name, _] : beforeClosure) allNames.insert(name);
+    for (auto & [name, _] : afterClosure) allNames.insert(name);
+
+    bool first = true;
+    logger->writeToStdout("{");
+
+    for (auto & name : allNames) {
+        auto & beforeVersions = beforeClosure[name];
+        auto & afterVersions = afterClosure[name];
+
+        auto totalSize = [&](const std::map<std::string, std::map<StorePath, Info>> & versions)
+        {
+            uint64_t sum = 0;
+            for (auto & [_, paths] : versions)
+                for (auto & [path, info] : paths)
+                    sum += info.narSize;
+            return sum;
+        };
+
+        auto beforeSize = totalSize(beforeVersions);
+        auto afterSize = totalSize(afterVersions);
+
+        auto versionsOf = [](const std::map<std::string, std::map<StorePath, Info>> & versions)
+        {
+            auto res = nlohmann::json::array();
+            for (auto & [version, _] : versions)
+                res.push_back(version);
+            return res;
+        };
+
+        if (beforeVersions == afterVersions)
+            continue;
+
+        nlohmann::json entry{
+            {"beforeVersions", versionsOf(beforeVersions)},
+            {"afterVersions", versionsOf(afterVersions)},
+            {"beforeSize", beforeSize},
+            {"afterSize", afterSize},
+            {"sizeDelta", (int64_t) afterSize - (int64_t) beforeSize},
+        };
+
+        logger->writeToStdout(fmt("%s%s:%s",
+            first ? "" : ",",
+            nlohmann::json(name).dump(),
+            entry.dump()));
+        first = false;
+    }
+
+    logger->writeToStdout("}");
+}
+
 void printClosureDiff(
     ref<Store> store,
     const StorePath & beforePath,
@@ -77,8 +153,8 @@ void printClosureDiff(
         {
             uint64_t sum = 0;
             for (auto & [_, paths] : versions)
-                for (auto & [path, _] : paths)
-                    sum += store->queryPathInfo(path)->narSize;
+                for (auto & [path, info] : paths)
+                    sum += info.narSize;
             return sum;
         };
 
@@ -110,7 +186,7 @@ void printClosureDiff(
 
 using namespace nix;
 
-struct CmdDiffClosures : SourceExprCommand, MixOperateOnOptions
+struct CmdDiffClosures : SourceExprCommand, MixOperateOnOptions, MixJSON
 {
     std::string _before, _after;
 
@@ -138,7 +214,10 @@ struct CmdDiffClosures : SourceExprCommand, MixOperateOnOptions
         auto beforePath = Installable::toStorePath(getEvalStore(), store, Realise::Outputs, operateOn, before);
         auto after = parseInstallable(store, _after);
         auto afterPath = Installable::toStorePath(getEvalStore(), store, Realise::Outputs, operateOn, after);
-        printClosureDiff(store, beforePath, afterPath, "");
+        if (json)
+            printClosureDiffJSON(store, beforePath, afterPath);
+        else
+            printClosureDiff(store, beforePath, afterPath, "");
     }
 };
 
@@ -1,11 +1,18 @@
 #include "nix/cmd/command-installable-value.hh"
+#include "nix/cmd/common-eval-args.hh"
+#include "nix/cmd/installable-flake.hh"
+#include "nix/fetchers/input-cache.hh"
 #include "nix/main/common-args.hh"
 #include "nix/main/shared.hh"
 #include "nix/store/store-api.hh"
 #include "nix/expr/eval.hh"
+#include "nix/util/signals.hh"
+#include "nix/util/file-system.hh"
 #include "nix/expr/eval-inline.hh"
 #include "nix/expr/value-to-json.hh"
 
+#include <thread>
+#include <sys/stat.h>
 #include <nlohmann/json.hpp>
 
 using namespace nix;
@@ -15,6 +22,7 @@ namespace nix::fs { using namespace std::filesystem; }
 struct CmdEval : MixJSON, InstallableValueCommand, MixReadOnlyOption
 {
     bool raw = false;
+    bool watch = false;
     std::optional<std::string> apply;
     std::optional<std::filesystem::path> writeTo;
 
@@ -33,6 +41,21 @@ struct CmdEval : MixJSON, InstallableValueCommand, MixReadOnlyOption
             .handler = {&apply},
         });
 
+        addFlag({
+            .longName = "watch",
+            .description = "Keep the evaluator running and re-evaluate whenever a source file changes.",
+            .handler = {&watch, true},
+        });
+
+        addFlag({
+            .longName = "profile",
+            .description = "Write a profile of the evaluation to *path*, in the speedscope JSON format.",
+            .labels = {"path"},
+            .handler = {[](std::string path) {
+                evalSettings.evalProfile.override(path);
+            }},
+        });
+
         addFlag({
             .longName = "write-to",
             .description = "Write a string or attrset of strings to *path*.",
@@ -59,7 +82,106 @@ struct CmdEval : MixJSON, InstallableValueCommand, MixReadOnlyOption
     {
         if (raw && json)
             throw UsageError("--raw and --json are mutually exclusive");
+        if (watch && writeTo)
+            throw UsageError("--watch and --write-to are mutually exclusive");
 
+        if (!watch) {
+            evalAndPrint(installable);
+            return;
+        }
+
+        /* Watch mode: keep the evaluator resident, and re-evaluate
+           whenever one of the files parsed during the previous
+           evaluation changes. */
+        auto state = getEvalState();
+
+        auto flakeInstallable = installable.dynamic_pointer_cast<InstallableFlake>();
+
+        while (true) {
+            try {
+                evalAndPrint(installable);
+            } catch (EvalError & e) {
+                logError(e.info());
+            }
+
+            /* For flake installables the parsed files are the
+               flake's immutable store copies, whose mtimes never
+               change; map each input's store copy back to its
+               original source tree (when it has one) so edits there
+               are seen. */
+            std::map<Path, Path> sourcePrefixes;
+            if (flakeInstallable) {
+                auto addPrefix = [&](const SourcePath & storeCopy, const fetchers::Input & input) {
+                    auto orig = input.getSourcePath();
+                    if (!orig) return;
+                    try {
+                        auto [storePath, _] = store->toStorePath(storeCopy.path.abs());
+                        sourcePrefixes.insert_or_assign(store->printStorePath(storePath), orig->string());
+                    } catch (Error &) { }
+                };
+                if (auto lockedFlake = flakeInstallable->getLockedFlake()) {
+                    addPrefix(lockedFlake->flake.path, lockedFlake->flake.lockedRef.input);
+                    for (auto & [node, storeCopy] : lockedFlake->nodePaths)
+                        if (auto lockedNode = dynamic_cast<const flake::LockedNode *>(&*node))
+                            addPrefix(storeCopy, lockedNode->lockedRef.input);
+                }
+            }
+
+            /* Collect the files the evaluation depended on, with
+               their current modification times. */
+            std::map<Path, time_t> files;
+            for (auto & path : state->getParsedFiles()) {
+                if (path.accessor != state->rootFS) continue;
+                auto p = path.path.abs();
+                if (store->isInStore(p)) {
+                    /* Rewrite to the original source file, or skip:
+                       a store copy itself cannot change. */
+                    auto [storePath, rest] = store->toStorePath(p);
+                    auto i = sourcePrefixes.find(store->printStorePath(storePath));
+                    if (i == sourcePrefixes.end()) continue;
+                    p = i->second + rest;
+                }
+                try {
+                    files.insert_or_assign(p, lstat(p).st_mtime);
+                } catch (SysError &) { }
+            }
+
+            if (files.empty())
+                throw Error(
+                    "'--watch' has nothing to watch: all files of this evaluation "
+                    "are immutable store copies (e.g. a remote flake), so no "
+                    "local change can ever trigger a re-evaluation");
+
+            notice("watching %d files for changes...", files.size());
+
+            bool changed = false;
+            while (!changed) {
+                checkInterrupt();
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                for (auto & [file, mtime] : files) {
+                    struct stat st;
+                    if (::stat(file.c_str(), &st) ? true : st.st_mtime != mtime) {
+                        notice("'%s' changed, re-evaluating...", file);
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+
+            state->resetFileCache();
+
+            /* Make the next iteration re-fetch and re-lock the
+               flake, so the changed source is copied to the store
+               afresh instead of replayed from the caches. */
+            if (flakeInstallable) {
+                flakeInstallable->_lockedFlake = nullptr;
+                state->inputCache->clear();
+            }
+        }
+    }
+
+    void evalAndPrint(ref<InstallableValue> installable)
+    {
         auto state = getEvalState();
 
         auto [v, pos] = installable->toValue(*state);
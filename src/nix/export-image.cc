@@ -0,0 +1,298 @@
+#include "nix/cmd/command.hh"
+#include "nix/main/common-args.hh"
+#include "nix/main/shared.hh"
+#include "nix/store/store-api.hh"
+#include "nix/util/archive.hh"
+#include "nix/util/content-chunker.hh"
+#include "nix/util/file-descriptor.hh"
+#include "nix/util/thread-pool.hh"
+#include "nix/util/topo-sort.hh"
+#include "nix/util/util.hh"
+#include "nix/util/serialise.hh"
+
+#include <atomic>
+#include <mutex>
+
+#include <fcntl.h>
+#ifndef _WIN32
+# include <unistd.h>
+#endif
+
+#include <nlohmann/json.hpp>
+
+using namespace nix;
+
+/* A closure image is a single seekable file:
+
+     "NIXIMAGE1\n"
+     <uint64 LE header length>
+     <header: JSON>
+     <chunk data>
+
+   The header lists every path (in dependency order) with its
+   metadata and its sequence of content-defined chunks, each chunk
+   given by hash, offset into the chunk data section and size.
+   Chunks shared between paths (or repeated within one) are stored
+   once, which is what makes fleet images much smaller than the sum
+   of their NARs. */
+
+static const std::string imageMagic = "NIXIMAGE1\n";
+
+struct CmdStoreExportImage : StorePathsCommand
+{
+    Path outFile;
+
+    CmdStoreExportImage()
+    {
+        addFlag({
+            .longName = "out",
+            .shortName = 'o',
+            .description = "Write the image to *path*.",
+            .labels = {"path"},
+            .handler = {&outFile},
+        });
+        realiseMode = Realise::Outputs;
+    }
+
+    std::string description() override
+    {
+        return "export a closure as a single deduplicated, seekable image";
+    }
+
+    std::string doc() override
+    {
+        return
+          #include "export-image.md"
+          ;
+    }
+
+    void run(ref<Store> store, StorePaths && storePaths) override
+    {
+        if (outFile.empty())
+            throw UsageError("'--out' is required");
+
+        StorePathSet paths(storePaths.begin(), storePaths.end());
+
+        auto sorted = topoSort(paths,
+            {[&](const StorePath & path) {
+                StorePathSet refs;
+                for (auto & ref : store->queryPathInfo(path)->references)
+                    if (ref != path && paths.count(ref))
+                        refs.insert(ref);
+                return refs;
+            }},
+            {[&](const StorePath & path, const StorePath & parent) {
+                return Error("cycle in closure of '%s'", store->printStorePath(path));
+            }});
+
+        /* Chunk data is accumulated in a temp file while the header
+           is built, then both are concatenated. */
+        auto [chunksFd, chunksPath] = createTempFile("nix-image");
+        AutoDelete delChunks(chunksPath);
+
+        std::map<std::string, std::pair<uint64_t, uint64_t>> chunkTable;
+        uint64_t dataOffset = 0;
+
+        auto pathsJson = nlohmann::json::array();
+
+        /* Dependencies first. */
+        for (auto i = sorted.rbegin(); i != sorted.rend(); ++i) {
+            auto info = store->queryPathInfo(*i);
+
+            auto chunksJson = nlohmann::json::array();
+
+            ChunkingSink chunker([&](std::string_view chunk) {
+                auto hash = hashString(HashAlgorithm::SHA256, chunk).to_string(HashFormat::Nix32, false);
+                auto [it, inserted] = chunkTable.emplace(hash, std::pair(dataOffset, chunk.size()));
+                if (inserted) {
+                    writeFull(chunksFd.get(), chunk);
+                    dataOffset += chunk.size();
+                }
+                chunksJson.push_back({
+                    {"hash", hash},
+                    {"offset", it->second.first},
+                    {"size", it->second.second},
+                });
+            });
+
+            store->narFromPath(*i, chunker);
+            chunker.finish();
+
+            auto refs = nlohmann::json::array();
+            for (auto & ref : info->references)
+                refs.push_back(store->printStorePath(ref));
+
+            pathsJson.push_back({
+                {"path", store->printStorePath(*i)},
+                {"narHash", info->narHash.to_string(HashFormat::SRI, true)},
+                {"narSize", info->narSize},
+                {"references", refs},
+                {"ca", renderContentAddress(info->ca)},
+                {"chunks", std::move(chunksJson)},
+            });
+        }
+
+        auto header = nlohmann::json{
+            {"version", 1},
+            {"paths", std::move(pathsJson)},
+        }.dump();
+
+        AutoCloseFD out = toDescriptor(open(outFile.c_str(), O_CREAT | O_TRUNC | O_WRONLY
+#ifndef _WIN32
+            | O_CLOEXEC
+#endif
+            , 0666));
+        if (!out) throw SysError("creating '%s'", outFile);
+
+        writeFull(out.get(), imageMagic);
+        unsigned char lenBuf[8];
+        for (int n = 0; n < 8; ++n)
+            lenBuf[n] = (header.size() >> (8 * n)) & 0xff;
+        writeFull(out.get(), {(char *) lenBuf, 8});
+        writeFull(out.get(), header);
+
+        /* Append the chunk data. */
+        if (lseek(chunksFd.get(), 0, SEEK_SET) == -1)
+            throw SysError("seeking in '%s'", chunksPath);
+        LambdaSink outSink([&](std::string_view data) { writeFull(out.get(), data); });
+        drainFD(chunksFd.get(), outSink);
+
+        printInfo("wrote %d paths, %d unique chunks (%s of data)",
+            sorted.size(), chunkTable.size(), renderSize(dataOffset));
+    }
+};
+
+struct CmdStoreImportImage : StoreCommand
+{
+    Path imageFile;
+
+    CmdStoreImportImage()
+    {
+        expectArg("file", &imageFile);
+    }
+
+    std::string description() override
+    {
+        return "import store paths from a closure image";
+    }
+
+    std::string doc() override
+    {
+        return
+          #include "import-image.md"
+          ;
+    }
+
+    void run(ref<Store> store) override
+    {
+        AutoCloseFD fd = toDescriptor(open(imageFile.c_str(), O_RDONLY
+#ifndef _WIN32
+            | O_CLOEXEC
+#endif
+            ));
+        if (!fd) throw SysError("opening '%s'", imageFile);
+
+        std::string magic(imageMagic.size(), 0);
+        readFull(fd.get(), magic.data(), magic.size());
+        if (magic != imageMagic)
+            throw Error("'%s' is not a Nix closure image", imageFile);
+
+        unsigned char lenBuf[8];
+        readFull(fd.get(), (char *) lenBuf, 8);
+        uint64_t headerLen = 0;
+        for (int n = 0; n < 8; ++n)
+            headerLen |= (uint64_t) lenBuf[n] << (8 * n);
+
+        std::string headerS(headerLen, 0);
+        readFull(fd.get(), headerS.data(), headerLen);
+        auto header = nlohmann::json::parse(headerS);
+        if (header.at("version") != 1)
+            throw Error("unsupported closure image version in '%s'", imageFile);
+
+        uint64_t dataStart = imageMagic.size() + 8 + headerLen;
+
+        std::map<StorePath, const nlohmann::json *> pathInfos;
+        for (auto & pathJson : header.at("paths"))
+            pathInfos.emplace(store->parseStorePath(pathJson.at("path").get<std::string>()), &pathJson);
+
+        std::set<StorePath> nodes;
+        for (auto & [path, _] : pathInfos)
+            nodes.insert(path);
+
+        std::atomic<size_t> imported{0}, present{0};
+
+        /* Positioned read shared by the workers. Windows has no
+           pread(), so reads are serialised there. */
+#ifdef _WIN32
+        std::mutex readLock;
+#endif
+        auto readAt = [&](char * data, size_t len, uint64_t offset) -> size_t {
+#ifndef _WIN32
+            auto got = pread(fd.get(), data, len, offset);
+            if (got == -1)
+                throw SysError("reading from '%s'", imageFile);
+            return got;
+#else
+            std::lock_guard<std::mutex> lock(readLock);
+            if (lseek(fd.get(), offset, SEEK_SET) == -1)
+                throw SysError("seeking in '%s'", imageFile);
+            readFull(fd.get(), data, len);
+            return len;
+#endif
+        };
+
+        /* Unpack and register in dependency-respecting parallel
+           order: the image is seekable and chunks are read with
+           pread(), so workers share the one descriptor. */
+        processGraph<StorePath>(
+            nodes,
+            [&](const StorePath & path) {
+                std::set<StorePath> refs;
+                for (auto & ref : pathInfos.at(path)->at("references"))
+                    if (auto r = store->parseStorePath(ref.get<std::string>()); r != path && nodes.count(r))
+                        refs.insert(r);
+                return refs;
+            },
+            [&](const StorePath & path) {
+                auto & pathJson = *pathInfos.at(path);
+
+                if (store->isValidPath(path)) {
+                    present++;
+                    return;
+                }
+
+                ValidPathInfo info{path, Hash::parseAny(pathJson.at("narHash").get<std::string>(), HashAlgorithm::SHA256)};
+                info.narSize = pathJson.at("narSize").get<uint64_t>();
+                for (auto & ref : pathJson.at("references"))
+                    info.references.insert(store->parseStorePath(ref.get<std::string>()));
+                if (auto ca = pathJson.at("ca").get<std::string>(); ca != "")
+                    info.ca = ContentAddress::parse(ca);
+
+                /* Reassemble the NAR from the (shared) chunks. */
+                auto source = sinkToSource([&](Sink & sink) {
+                    std::vector<char> buf(64 * 1024);
+                    for (auto & chunk : pathJson.at("chunks")) {
+                        uint64_t offset = dataStart + chunk.at("offset").get<uint64_t>();
+                        uint64_t left = chunk.at("size").get<uint64_t>();
+                        while (left) {
+                            auto n = std::min<uint64_t>(left, buf.size());
+                            auto got = readAt(buf.data(), n, offset);
+                            if (got == 0)
+                                throw Error("unexpected end of file in '%s'", imageFile);
+                            sink({buf.data(), (size_t) got});
+                            left -= got;
+                            offset += got;
+                        }
+                    }
+                });
+
+                store->addToStore(info, *source, NoRepair, NoCheckSigs);
+                imported++;
+            });
+
+        printInfo("imported %d paths (%d already present)", imported.load(), present.load());
+    }
+};
+
+static auto rCmdStoreExportImage = registerCommand2<CmdStoreExportImage>({"store", "export-image"});
+static auto rCmdStoreImportImage = registerCommand2<CmdStoreImportImage>({"store", "import-image"});
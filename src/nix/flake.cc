@@ -17,6 +17,7 @@
 #include "nix/expr/eval-cache.hh"
 #include "nix/cmd/markdown.hh"
 #include "nix/util/users.hh"
+#include "nix/util/file-system.hh"
 #include "nix/fetchers/fetch-to-store.hh"
 #include "nix/store/local-fs-store.hh"
 
@@ -198,6 +199,17 @@ static void enumerateOutputs(EvalState & state, Value & vFlake,
 
 struct CmdFlakeMetadata : FlakeCommand, MixJSON
 {
+    bool offlineStrict = false;
+
+    CmdFlakeMetadata()
+    {
+        addFlag({
+            .longName = "offline-strict",
+            .description = "Answer entirely from `flake.lock`, without fetching or locking anything. Fields that require the flake itself (description, fingerprint, store path) are omitted.",
+            .handler = {&offlineStrict, true},
+        });
+    }
+
     std::string description() override
     {
         return "show flake metadata";
@@ -210,8 +222,86 @@ struct CmdFlakeMetadata : FlakeCommand, MixJSON
           ;
     }
 
+    void printInputs(const LockFile & lockFile)
+    {
+        if (!lockFile.root->inputs.empty())
+            logger->cout(ANSI_BOLD "Inputs:" ANSI_NORMAL);
+
+        std::set<ref<Node>> visited;
+
+        std::function<void(const Node & node, const std::string & prefix)> recurse;
+
+        recurse = [&](const Node & node, const std::string & prefix)
+        {
+            for (const auto & [i, input] : enumerate(node.inputs)) {
+                bool last = i + 1 == node.inputs.size();
+
+                if (auto lockedNode = std::get_if<0>(&input.second)) {
+                    std::string lastModifiedStr = "";
+                    if (auto lastModified = (*lockedNode)->lockedRef.input.getLastModified())
+                        lastModifiedStr = fmt(" (%s)", std::put_time(std::gmtime(&*lastModified), "%F %T"));
+                    logger->cout("%s" ANSI_BOLD "%s" ANSI_NORMAL ": %s%s",
+                        prefix + (last ? treeLast : treeConn), input.first,
+                        (*lockedNode)->lockedRef,
+                        lastModifiedStr);
+
+                    bool firstVisit = visited.insert(*lockedNode).second;
+
+                    if (firstVisit) recurse(**lockedNode, prefix + (last ? treeNull : treeLine));
+                } else if (auto follows = std::get_if<1>(&input.second)) {
+                    logger->cout("%s" ANSI_BOLD "%s" ANSI_NORMAL " follows input '%s'",
+                        prefix + (last ? treeLast : treeConn), input.first,
+                        printInputAttrPath(*follows));
+                }
+            }
+        };
+
+        visited.insert(lockFile.root);
+        recurse(*lockFile.root, "");
+    }
+
+    /* Answer from the lock file alone: no fetching, no store
+       copies, no registry. For tooling that polls metadata this is
+       the difference between microseconds and hundreds of
+       milliseconds. */
+    void runOfflineStrict()
+    {
+        auto flakeRef = getFlakeRef();
+
+        auto sourcePath = flakeRef.input.getSourcePath();
+        if (!sourcePath)
+            throw Error("'--offline-strict' requires a flake in the local filesystem, but '%s' is not", flakeRef.to_string());
+
+        auto lockFilePath = *sourcePath;
+        if (flakeRef.subdir != "") lockFilePath /= flakeRef.subdir;
+        lockFilePath /= "flake.lock";
+
+        if (!pathExists(lockFilePath.string()))
+            throw Error("flake '%s' has no lock file", flakeRef.to_string());
+
+        LockFile lockFile(fetchSettings, readFile(lockFilePath.string()), lockFilePath.string());
+
+        if (json) {
+            nlohmann::json j;
+            j["originalUrl"] = flakeRef.to_string();
+            j["original"] = fetchers::attrsToJSON(flakeRef.toAttrs());
+            j["locks"] = lockFile.toJSON().first;
+            printJSON(j);
+        } else {
+            logger->cout(
+                ANSI_BOLD "Original URL:" ANSI_NORMAL "  %s",
+                flakeRef.to_string());
+            printInputs(lockFile);
+        }
+    }
+
     void run(nix::ref<nix::Store> store) override
     {
+        if (offlineStrict) {
+            runOfflineStrict();
+            return;
+        }
+
         auto lockedFlake = lockFlake();
         auto & flake = lockedFlake.flake;
 
@@ -279,40 +369,7 @@ struct CmdFlakeMetadata : FlakeCommand, MixJSON
                     ANSI_BOLD "Fingerprint:" ANSI_NORMAL "   %s",
                     fingerprint->to_string(HashFormat::Base16, false));
 
-            if (!lockedFlake.lockFile.root->inputs.empty())
-                logger->cout(ANSI_BOLD "Inputs:" ANSI_NORMAL);
-
-            std::set<ref<Node>> visited;
-
-            std::function<void(const Node & node, const std::string & prefix)> recurse;
-
-            recurse = [&](const Node & node, const std::string & prefix)
-            {
-                for (const auto & [i, input] : enumerate(node.inputs)) {
-                    bool last = i + 1 == node.inputs.size();
-
-                    if (auto lockedNode = std::get_if<0>(&input.second)) {
-                        std::string lastModifiedStr = "";
-                        if (auto lastModified = (*lockedNode)->lockedRef.input.getLastModified())
-                            lastModifiedStr = fmt(" (%s)", std::put_time(std::gmtime(&*lastModified), "%F %T"));
-                        logger->cout("%s" ANSI_BOLD "%s" ANSI_NORMAL ": %s%s",
-                            prefix + (last ? treeLast : treeConn), input.first,
-                            (*lockedNode)->lockedRef,
-                            lastModifiedStr);
-
-                        bool firstVisit = visited.insert(*lockedNode).second;
-
-                        if (firstVisit) recurse(**lockedNode, prefix + (last ? treeNull : treeLine));
-                    } else if (auto follows = std::get_if<1>(&input.second)) {
-                        logger->cout("%s" ANSI_BOLD "%s" ANSI_NORMAL " follows input '%s'",
-                            prefix + (last ? treeLast : treeConn), input.first,
-                            printInputAttrPath(*follows));
-                    }
-                }
-            };
-
-            visited.insert(lockedFlake.lockFile.root);
-            recurse(*lockedFlake.lockFile.root, "");
+            printInputs(lockedFlake.lockFile);
         }
     }
 };
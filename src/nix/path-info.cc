@@ -36,12 +36,20 @@ static uint64_t getStoreObjectsTotalSize(Store & store, const StorePathSet & clo
  * @param showClosureSize If true, the closure size of each path is
  * included.
  */
-static json pathInfoToJSON(
+static void printPathInfosJSON(
     Store & store,
     const StorePathSet & storePaths,
-    bool showClosureSize)
+    bool showClosureSize,
+    bool pretty)
 {
-    json::object_t jsonAllObjects = json::object();
+    /* Stream one store object at a time, rather than building the
+       entire document in memory, so that memory use stays flat
+       regardless of the closure size. */
+    auto suspension = logger->suspend();
+
+    logger->writeToStdout("{");
+
+    bool first = true;
 
     for (auto & storePath : storePaths) {
         json jsonObject;
@@ -82,9 +90,15 @@ static json pathInfoToJSON(
             jsonObject = nullptr;
         }
 
-        jsonAllObjects[printedStorePath] = std::move(jsonObject);
+        logger->writeToStdout(
+            (first ? "" : ",")
+            + json(printedStorePath).dump()
+            + ":"
+            + (pretty ? jsonObject.dump(2) : jsonObject.dump()));
+        first = false;
     }
-    return jsonAllObjects;
+
+    logger->writeToStdout("}");
 }
 
 
@@ -154,11 +168,12 @@ struct CmdPathInfo : StorePathsCommand, MixJSON
             pathLen = std::max(pathLen, store->printStorePath(storePath).size());
 
         if (json) {
-            printJSON(pathInfoToJSON(
+            printPathInfosJSON(
                 *store,
                 // FIXME: preserve order?
                 StorePathSet(storePaths.begin(), storePaths.end()),
-                showClosureSize));
+                showClosureSize,
+                outputPretty);
         }
 
         else {
@@ -123,6 +123,38 @@ struct ProfileManifest
     ProfileManifest() { }
 
     ProfileManifest(EvalState & state, const std::filesystem::path & profile)
+    {
+        if (readManifestJson(*state.store, profile))
+            return;
+
+        if (std::filesystem::exists(profile / "manifest.nix")) {
+            // FIXME: needed because of pure mode; ugly.
+            state.allowPath(state.store->followLinksToStore(profile.string()));
+            state.allowPath(state.store->followLinksToStore((profile / "manifest.nix").string()));
+
+            auto packageInfos = queryInstalled(state, state.store->followLinksToStore(profile.string()));
+
+            for (auto & packageInfo : packageInfos) {
+                ProfileElement element;
+                element.storePaths = {packageInfo.queryOutPath()};
+                addElement(std::move(element));
+            }
+        }
+    }
+
+    /**
+     * Read a manifest.json profile. Unlike the legacy manifest.nix
+     * format, this doesn't require an evaluator.
+     */
+    ProfileManifest(Store & store, const std::filesystem::path & profile)
+    {
+        readManifestJson(store, profile);
+    }
+
+    /**
+     * Returns false if the profile has no manifest.json.
+     */
+    bool readManifestJson(Store & store, const std::filesystem::path & profile)
     {
         auto manifestPath = profile / "manifest.json";
 
@@ -151,7 +183,7 @@ struct ProfileManifest
                 auto & e = elem.value();
                 ProfileElement element;
                 for (auto & p : e["storePaths"])
-                    element.storePaths.insert(state.store->parseStorePath((std::string) p));
+                    element.storePaths.insert(store.parseStorePath((std::string) p));
                 element.active = e["active"];
                 if(e.contains("priority")) {
                     element.priority = e["priority"];
@@ -174,21 +206,11 @@ struct ProfileManifest
 
                 addElement(name, std::move(element));
             }
-        }
-
-        else if (std::filesystem::exists(profile / "manifest.nix")) {
-            // FIXME: needed because of pure mode; ugly.
-            state.allowPath(state.store->followLinksToStore(profile.string()));
-            state.allowPath(state.store->followLinksToStore((profile / "manifest.nix").string()));
 
-            auto packageInfos = queryInstalled(state, state.store->followLinksToStore(profile.string()));
-
-            for (auto & packageInfo : packageInfos) {
-                ProfileElement element;
-                element.storePaths = {packageInfo.queryOutPath()};
-                addElement(std::move(element));
-            }
+            return true;
         }
+
+        return false;
     }
 
     void addElement(std::string_view nameCandidate, ProfileElement element)
@@ -797,7 +819,11 @@ struct CmdProfileList : virtual EvalCommand, virtual StoreCommand, MixDefaultPro
 
     void run(ref<Store> store) override
     {
-        ProfileManifest manifest(*getEvalState(), *profile);
+        /* Listing doesn't need an evaluator unless the profile is in
+           the legacy manifest.nix format. */
+        auto manifest = std::filesystem::exists(*profile / "manifest.json")
+            ? ProfileManifest(*store, *profile)
+            : ProfileManifest(*getEvalState(), *profile);
 
         if (json) {
             printJSON(manifest.toJSON(*store));
@@ -1,4 +1,7 @@
 #include "nix/cmd/command-installable-value.hh"
+#include "nix/cmd/installable-flake.hh"
+#include "nix/cmd/common-eval-args.hh"
+#include "nix/util/users.hh"
 #include "nix/store/globals.hh"
 #include "nix/expr/eval.hh"
 #include "nix/expr/eval-inline.hh"
@@ -12,11 +15,13 @@
 #include "nix/util/hilite.hh"
 #include "nix/util/strings-inline.hh"
 
+#include <array>
 #include <regex>
 #include <fstream>
 #include <nlohmann/json.hpp>
 
 #include "nix/util/strings.hh"
+#include "nix/util/util.hh"
 
 using namespace nix;
 using json = nlohmann::json;
@@ -87,11 +92,112 @@ struct CmdSearch : InstallableValueCommand, MixJSON
 
         auto state = getEvalState();
 
-        std::optional<nlohmann::json> jsonOut;
-        if (json) jsonOut = json::object();
+        /* In JSON mode, results are streamed one object at a time, so
+           memory use doesn't scale with the number of matches. */
+        std::optional<Logger::Suspension> loggerSuspension;
+        if (json) {
+            loggerSuspension = logger->suspend();
+            logger->writeToStdout("{");
+        }
 
         uint64_t results = 0;
 
+        /* Match a package against the regexes and print it. Shared
+           between the evaluating traversal and index replay. */
+        auto processPackage = [&](const std::string & attrPath2, const std::string & pname,
+            const std::string & version, const std::string & description)
+        {
+            std::vector<std::smatch> attrPathMatches;
+            std::vector<std::smatch> descriptionMatches;
+            std::vector<std::smatch> nameMatches;
+            bool found = false;
+
+            for (auto & regex : excludeRegexes) {
+                if (
+                    std::regex_search(attrPath2, regex)
+                    || std::regex_search(pname, regex)
+                    || std::regex_search(description, regex))
+                    return;
+            }
+
+            for (auto & regex : regexes) {
+                found = false;
+                auto addAll = [&found](std::sregex_iterator it, std::vector<std::smatch> & vec) {
+                    const auto end = std::sregex_iterator();
+                    while (it != end) {
+                        vec.push_back(*it++);
+                        found = true;
+                    }
+                };
+
+                addAll(std::sregex_iterator(attrPath2.begin(), attrPath2.end(), regex), attrPathMatches);
+                addAll(std::sregex_iterator(pname.begin(), pname.end(), regex), nameMatches);
+                addAll(std::sregex_iterator(description.begin(), description.end(), regex), descriptionMatches);
+
+                if (!found)
+                    break;
+            }
+
+            if (found)
+            {
+                results++;
+                if (json) {
+                    nlohmann::json entry = {
+                        {"pname", pname},
+                        {"version", version},
+                        {"description", description},
+                    };
+                    logger->writeToStdout(
+                        (results > 1 ? "," : "")
+                        + nlohmann::json(attrPath2).dump()
+                        + ":"
+                        + entry.dump());
+                } else {
+                    if (results > 1) logger->cout("");
+                    logger->cout(
+                        "* %s%s",
+                        wrap("\e[0;1m", hiliteMatches(attrPath2, attrPathMatches, ANSI_GREEN, "\e[0;1m")),
+                        version != "" ? " (" + version + ")" : "");
+                    if (description != "")
+                        logger->cout(
+                            "  %s", hiliteMatches(description, descriptionMatches, ANSI_GREEN, ANSI_NORMAL));
+                }
+            }
+        };
+
+        /* A package index derived from a previous full traversal of
+           the same locked flake (and same attribute scope), so
+           repeat searches need no evaluation at all. */
+        std::optional<Path> indexPath;
+        if (auto installableFlake = dynamic_cast<InstallableFlake *>(&*installable)) {
+            if (auto fingerprint = installableFlake->getLockedFlake()->getFingerprint(store, fetchSettings))
+                indexPath = getCacheDir() + "/search-index-v1/"
+                    + hashString(HashAlgorithm::SHA256,
+                        fingerprint->to_string(HashFormat::Nix32, false) + ";" + installable->what())
+                        .to_string(HashFormat::Nix32, false)
+                    + ".json";
+        }
+
+        bool usedIndex = false;
+
+        if (indexPath && pathExists(*indexPath)) {
+            try {
+                auto index = nlohmann::json::parse(readFile(*indexPath));
+                for (auto & record : index)
+                    processPackage(
+                        record.at(0).get<std::string>(),
+                        record.at(1).get<std::string>(),
+                        record.at(2).get<std::string>(),
+                        record.at(3).get<std::string>());
+                usedIndex = true;
+            } catch (std::exception &) {
+                /* Corrupt index; re-evaluate (and rewrite it). */
+                results = 0;
+            }
+        }
+
+        std::vector<std::array<std::string, 4>> indexRecords;
+
         std::function<void(eval_cache::AttrCursor & cursor, const std::vector<Symbol> & attrPath, bool initialRecurse)> visit;
 
         visit = [&](eval_cache::AttrCursor & cursor, const std::vector<Symbol> & attrPath, bool initialRecurse)
@@ -120,57 +226,10 @@ struct CmdSearch : InstallableValueCommand, MixJSON
                     std::replace(description.begin(), description.end(), '\n', ' ');
                     auto attrPath2 = concatStringsSep(".", attrPathS);
 
-                    std::vector<std::smatch> attrPathMatches;
-                    std::vector<std::smatch> descriptionMatches;
-                    std::vector<std::smatch> nameMatches;
-                    bool found = false;
-
-                    for (auto & regex : excludeRegexes) {
-                        if (
-                            std::regex_search(attrPath2, regex)
-                            || std::regex_search(name.name, regex)
-                            || std::regex_search(description, regex))
-                            return;
-                    }
-
-                    for (auto & regex : regexes) {
-                        found = false;
-                        auto addAll = [&found](std::sregex_iterator it, std::vector<std::smatch> & vec) {
-                            const auto end = std::sregex_iterator();
-                            while (it != end) {
-                                vec.push_back(*it++);
-                                found = true;
-                            }
-                        };
-
-                        addAll(std::sregex_iterator(attrPath2.begin(), attrPath2.end(), regex), attrPathMatches);
-                        addAll(std::sregex_iterator(name.name.begin(), name.name.end(), regex), nameMatches);
-                        addAll(std::sregex_iterator(description.begin(), description.end(), regex), descriptionMatches);
-
-                        if (!found)
-                            break;
-                    }
+                    if (indexPath)
+                        indexRecords.push_back({attrPath2, name.name, name.version, description});
 
-                    if (found)
-                    {
-                        results++;
-                        if (json) {
-                            (*jsonOut)[attrPath2] = {
-                                {"pname", name.name},
-                                {"version", name.version},
-                                {"description", description},
-                            };
-                        } else {
-                            if (results > 1) logger->cout("");
-                            logger->cout(
-                                "* %s%s",
-                                wrap("\e[0;1m", hiliteMatches(attrPath2, attrPathMatches, ANSI_GREEN, "\e[0;1m")),
-                                name.version != "" ? " (" + name.version + ")" : "");
-                            if (description != "")
-                                logger->cout(
-                                    "  %s", hiliteMatches(description, descriptionMatches, ANSI_GREEN, ANSI_NORMAL));
-                        }
-                    }
+                    processPackage(attrPath2, name.name, name.version, description);
                 }
 
                 else if (
@@ -194,11 +253,22 @@ struct CmdSearch : InstallableValueCommand, MixJSON
             }
         };
 
-        for (auto & cursor : installable->getCursors(*state))
-            visit(*cursor, cursor->getAttrPath(), true);
+        if (!usedIndex) {
+            for (auto & cursor : installable->getCursors(*state))
+                visit(*cursor, cursor->getAttrPath(), true);
+
+            if (indexPath) {
+                try {
+                    createDirs(dirOf(*indexPath));
+                    writeFile(*indexPath, nlohmann::json(indexRecords).dump());
+                } catch (Error &) {
+                    ignoreExceptionExceptInterrupt();
+                }
+            }
+        }
 
         if (json)
-            printJSON(*jsonOut);
+            logger->writeToStdout("}");
 
         if (!json && !results)
             throw Error("no results for the given search term(s)!");
@@ -0,0 +1,133 @@
+#include "nix/cmd/command.hh"
+#include "nix/main/common-args.hh"
+#include "nix/main/shared.hh"
+#include "nix/store/store-api.hh"
+#include "nix/util/file-system.hh"
+#include "nix/util/posix-source-accessor.hh"
+
+#include <chrono>
+#include <random>
+
+#include <nlohmann/json.hpp>
+
+using namespace nix;
+
+/* Drives the real store code paths against a synthetic, reproducible
+   corpus, so storage changes can be quantified on actual hardware.
+   See store-bench.md. */
+struct CmdStoreBench : StoreCommand
+{
+    uint64_t nrFiles = 1000;
+    uint64_t fileSize = 16 * 1024;
+    uint64_t nrQueries = 10000;
+    uint64_t seed = 0;
+
+    CmdStoreBench()
+    {
+        addFlag({
+            .longName = "files",
+            .description = "Number of files in the synthetic corpus.",
+            .labels = {"n"},
+            .handler = {&nrFiles},
+        });
+        addFlag({
+            .longName = "file-size",
+            .description = "Size of each file in bytes.",
+            .labels = {"bytes"},
+            .handler = {&fileSize},
+        });
+        addFlag({
+            .longName = "queries",
+            .description = "Number of path info queries in the query storm phase.",
+            .labels = {"n"},
+            .handler = {&nrQueries},
+        });
+        addFlag({
+            .longName = "seed",
+            .description = "Seed for the corpus generator, for reproducible corpora.",
+            .labels = {"n"},
+            .handler = {&seed},
+        });
+    }
+
+    std::string description() override
+    {
+        return "benchmark the store's hot code paths against a synthetic corpus";
+    }
+
+    std::string doc() override
+    {
+        return
+          #include "store-bench.md"
+          ;
+    }
+
+    void run(ref<Store> store) override
+    {
+        nlohmann::json results;
+
+        auto time = [&](const std::string & phase, auto f) {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            results[phase]["ms"] = ms;
+            return ms;
+        };
+
+        /* Generate the corpus. Deterministic in (seed, files,
+           file-size), so runs are comparable across machines. */
+        Path corpusDir = createTempDir();
+        AutoDelete delCorpus(corpusDir, true);
+
+        time("generate", [&]() {
+            std::mt19937_64 prng(seed);
+            std::string buf;
+            for (uint64_t n = 0; n < nrFiles; ++n) {
+                buf.clear();
+                buf.reserve(fileSize);
+                while (buf.size() < fileSize) {
+                    auto word = prng();
+                    buf.append((char *) &word, std::min<size_t>(sizeof(word), fileSize - buf.size()));
+                }
+                auto dir = corpusDir + "/" + std::to_string(n % 256);
+                if (n < 256) createDirs(dir);
+                writeFile(dir + "/f" + std::to_string(n), buf);
+            }
+        });
+
+        /* Ingestion. */
+        std::optional<StorePath> storePath;
+        auto ingestMs = time("ingest", [&]() {
+            storePath = store->addToStore(
+                fmt("bench-corpus-%d-%d-%d", seed, nrFiles, fileSize),
+                PosixSourceAccessor::createAtRoot(corpusDir));
+        });
+        results["ingest"]["bytes"] = nrFiles * fileSize;
+        if (ingestMs)
+            results["ingest"]["MBps"] = (double) (nrFiles * fileSize) / 1e6 / ((double) ingestMs / 1000);
+
+        /* Query storm: repeated metadata lookups, flushing the
+           client cache between rounds so the store is actually
+           exercised. */
+        time("queries", [&]() {
+            for (uint64_t n = 0; n < nrQueries; ++n) {
+                if (n % 64 == 0)
+                    store->clearPathInfoCache();
+                store->queryPathInfo(*storePath);
+            }
+        });
+
+        /* Serialisation: dump the path as a NAR into a null sink. */
+        auto dumpMs = time("dump", [&]() {
+            NullSink sink;
+            store->narFromPath(*storePath, sink);
+        });
+        if (dumpMs)
+            results["dump"]["MBps"] = (double) (nrFiles * fileSize) / 1e6 / ((double) dumpMs / 1000);
+
+        logger->cout(results.dump(2));
+    }
+};
+
+static auto rCmdStoreBench = registerCommand2<CmdStoreBench>({"store", "bench"});
@@ -1,6 +1,7 @@
 #include "nix/cmd/command.hh"
 #include "nix/main/shared.hh"
 #include "nix/store/store-api.hh"
+#include "nix/store/remote-store.hh"
 #include "nix/util/finally.hh"
 
 #include <nlohmann/json.hpp>
@@ -30,6 +31,9 @@ struct CmdInfoStore : StoreCommand, MixJSON
                 notice("Version: %s", *version);
             if (auto trusted = store->isTrustedClient())
                 notice("Trusted: %s", *trusted);
+            if (auto remote = store.dynamic_pointer_cast<RemoteStore>())
+                if (auto latency = remote->ping())
+                    notice("Latency: %d us", latency->count());
         } else {
             nlohmann::json res;
             Finally printRes([&]() {
@@ -42,6 +46,10 @@ struct CmdInfoStore : StoreCommand, MixJSON
                 res["version"] = *version;
             if (auto trusted = store->isTrustedClient())
                 res["trusted"] = *trusted;
+            res["memory"] = store->memoryStats();
+            if (auto remote = store.dynamic_pointer_cast<RemoteStore>())
+                if (auto latency = remote->ping())
+                    res["pingUs"] = latency->count();
         }
     }
 };
@@ -0,0 +1,100 @@
+#include "nix/cmd/command.hh"
+#include "nix/main/common-args.hh"
+#include "nix/main/shared.hh"
+#include "nix/store/store-api.hh"
+#include "nix/store/store-cast.hh"
+#include "nix/store/binary-cache-store.hh"
+#include "nix/store/nar-info.hh"
+#include "nix/util/thread-pool.hh"
+#include "nix/util/util.hh"
+#include "nix/util/signals.hh"
+
+using namespace nix;
+
+struct CmdStorePrune : StorePathsCommand, MixDryRun
+{
+    std::string description() override
+    {
+        return "delete everything from a binary cache except the closures of the specified paths";
+    }
+
+    std::string doc() override
+    {
+        return
+          #include "store-prune.md"
+          ;
+    }
+
+    void run(ref<Store> store, StorePaths && storePaths) override
+    {
+        auto & bcStore = require<BinaryCacheStore>(*store);
+
+        /* Compute the closure to keep from the cache's own
+           narinfos. */
+        StorePathSet keep;
+        store->computeFSClosure(StorePathSet(storePaths.begin(), storePaths.end()), keep);
+
+        printInfo("keeping the closure of %d roots (%d paths)...", storePaths.size(), keep.size());
+
+        auto all = store->queryAllValidPaths();
+
+        std::atomic<size_t> deleted{0};
+
+        ThreadPool pool(25);
+
+        for (auto & path : all) {
+            if (keep.count(path)) continue;
+
+            pool.enqueue([&, path]() {
+                checkInterrupt();
+
+                if (dryRun) {
+                    notice("would delete '%s'", store->printStorePath(path));
+                    return;
+                }
+
+                /* Find the NAR file before deleting the narinfo. */
+                std::optional<std::string> narUrl;
+                try {
+                    if (auto info = std::dynamic_pointer_cast<const NarInfo>(
+                            std::shared_ptr<const ValidPathInfo>(store->queryPathInfo(path))))
+                        narUrl = info->url;
+                } catch (InvalidPath &) {
+                    return;
+                }
+
+                notice("deleting '%s'", store->printStorePath(path));
+
+                bcStore.deleteFile(std::string(path.hashPart()) + ".narinfo");
+
+                /* Note: chunked NARs (.chunks manifests) share their
+                   chunk objects with other paths, so only the
+                   manifest is deleted; orphaned chunks need a
+                   separate sweep. */
+                if (narUrl) {
+                    try {
+                        bcStore.deleteFile(*narUrl);
+                    } catch (Error &) {
+                        ignoreExceptionExceptInterrupt();
+                    }
+                }
+
+                try {
+                    bcStore.deleteFile(std::string(path.hashPart()) + ".ls");
+                } catch (Error &) {
+                    ignoreExceptionExceptInterrupt();
+                }
+
+                deleted++;
+            });
+        }
+
+        pool.process();
+
+        printInfo(dryRun
+            ? fmt("%d paths would be deleted", all.size() - keep.size())
+            : fmt("deleted %d paths", deleted.load()));
+    }
+};
+
+static auto rCmdStorePrune = registerCommand2<CmdStorePrune>({"store", "prune"});
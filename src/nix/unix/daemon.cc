@@ -27,6 +27,7 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/select.h>
@@ -387,6 +388,12 @@ static void daemonLoop(std::optional<TrustedFlag> forceTrustClientOpt)
                 if (setsid() == -1)
                     throw SysError("creating a new session");
 
+                /* Optionally deprioritise this connection's query
+                   handling relative to builds (see
+                   daemon-connection-niceness). Best effort. */
+                if (settings.daemonConnectionNiceness != 0)
+                    setpriority(PRIO_PROCESS, 0, settings.daemonConnectionNiceness);
+
                 //  Restore normal handling of SIGCHLD.
                 setSigChldAction(false);
 
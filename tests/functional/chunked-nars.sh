@@ -0,0 +1,41 @@
+#!/usr/bin/env bash
+
+source common.sh
+
+TODO_NixOS
+
+needLocalStore "'--no-require-sigs' can’t be used with the daemon"
+
+clearStore
+clearCache
+
+outPath=$(nix-build dependencies.nix --no-out-link)
+
+# Copy to a cache that stores NARs as content-defined chunks.
+nix copy --to "file://$cacheDir?chunked-nars=true" "$outPath"
+
+# The cache should contain chunk objects and per-path chunk
+# manifests instead of .nar files.
+[ -d "$cacheDir/chunks" ]
+[ -n "$(ls "$cacheDir"/nar/*.nar.chunks)" ]
+grep -q '"chunks"' "$cacheDir"/nar/*.nar.chunks
+
+narinfo=$cacheDir/$(basename "$outPath" | cut -c1-32).narinfo
+grep -q 'URL: nar/.*\.nar\.chunks' "$narinfo"
+grep -q 'Compression: none' "$narinfo"
+
+# Substituting from the chunked cache must reassemble the original
+# contents.
+clearStore
+clearCacheCache
+
+nix-store --substituters "file://$cacheDir" --no-require-sigs -r "$outPath"
+
+[ -x "$outPath/program" ]
+
+# Uploading the same path again must not duplicate chunks.
+nrChunks=$(ls "$cacheDir/chunks" | wc -l)
+clearStore
+nix-build dependencies.nix --no-out-link
+nix copy --to "file://$cacheDir?chunked-nars=true" "$outPath"
+[ "$(ls "$cacheDir/chunks" | wc -l)" -eq "$nrChunks" ]
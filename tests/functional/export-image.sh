@@ -0,0 +1,34 @@
+#!/usr/bin/env bash
+
+source common.sh
+
+TODO_NixOS
+
+clearStore
+
+outPath=$(nix-build dependencies.nix --no-out-link)
+
+img=$TEST_ROOT/closure.img
+
+# Exporting requires --out.
+expect 1 nix store export-image "$outPath" 2>&1 | grep "'--out' is required"
+
+nix store export-image --out "$img" "$outPath"
+
+# The image starts with the format magic.
+[ "$(head -c 9 "$img")" = NIXIMAGE1 ]
+
+# A fresh store materialises the whole closure from the image.
+clearStore
+
+nix store import-image "$img" 2>&1 | grep 'imported 3 paths (0 already present)'
+
+nix path-info "$outPath"
+[ -x "$outPath/program" ]
+
+# Importing again is a no-op.
+nix store import-image "$img" 2>&1 | grep 'imported 0 paths (3 already present)'
+
+# A truncated image is rejected.
+head -c 100 "$img" > "$img.truncated"
+expect 1 nix store import-image "$img.truncated"
@@ -24,6 +24,23 @@ else
     nix store info --json | jq -e 'has("trusted") | not'
 fi
 
+if isDaemonNewer "2.30.0"; then
+    # New daemons answer the Ping and QueryMemoryStats ops.
+    nix store info --json | jq -e '.pingUs >= 0'
+    nix store info --json | jq -e '.memory.pathInfoCache.entries >= 0'
+else
+    # Old daemons: no ping; memory stats fall back to the client
+    # process and are still present.
+    nix store info --json | jq -e 'has("pingUs") | not'
+    nix store info --json | jq -e 'has("memory")'
+fi
+
+# Batched path info queries go through QueryPathInfos on new
+# daemons and fall back to per-path queries on old ones; the
+# result must be the same either way.
+outPath=$(nix-build dependencies.nix --no-out-link)
+[[ $(nix path-info -r "$outPath" | wc -l) -eq 3 ]]
+
 # Test import-from-derivation through the daemon.
 [[ $(nix eval --impure --raw --file ./ifd.nix) = hi ]]
 